@@ -0,0 +1,295 @@
+/*
+ * after (voir after.h).
+ *
+ * Le handler SIGCHLD ne fait que compter : quand un job en attente
+ * n'attend plus personne, son jid entre dans la file ready[] et on écrit
+ * dans l'eventfd. after_tick, appelée par timers_run hors du handler,
+ * vide la file : parse et fork n'ont rien à faire dans un handler.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <stdint.h>
+#include <sys/wait.h>
+#include <sys/eventfd.h>
+#include "csapp.h"
+#include "exec.h"
+#include "jobs.h"
+#include "timers.h"
+#include "after.h"
+
+static int efd = -1;
+static pid_t owner = 0;         /* un sous-shell repart de zéro */
+
+/* les jobs prêts à partir : chacun n'y passe qu'une fois */
+static int ready[MAXJOBS];
+static int rhead = 0, nready = 0;
+
+static void push_ready(int jid) {
+    uint64_t one = 1;
+
+    ready[(rhead + nready++) % MAXJOBS] = jid;
+    if (write(efd, &one, sizeof(one)) < 0) {
+        /* le compteur est déjà lisible : le shell sera réveillé */
+    }
+}
+
+void after_job_done(job_t *j, int code) {
+    struct edge e = j->dependents;
+
+    j->dependents.jid = 0;
+    while (e.jid) {
+        job_t *p = get_job_by_jid(e.jid);
+        struct edge next = p->next_edge[e.k];
+
+        p->deps[e.k] = 0;
+        if (code != 0) p->dep_failed = 1;
+        if (--p->nwaiting == 0) push_ready(p->jid);
+        e = next;
+    }
+}
+
+/* --ok et un job attendu a échoué : p ne part pas (SIGCHLD bloqué) */
+static void cancel(job_t *p) {
+    free(p->pending);
+    p->pending = NULL;
+    after_job_done(p, AFTER_CANCELLED);
+
+    /* wait l'attend : il prend son code, comme un job fini */
+    if (p->waited) {
+        p->state = DONE;
+        p->status = W_EXITCODE(AFTER_CANCELLED, 0);
+        return;
+    }
+    if (exec_interactive) {
+        printf("\n[%d] Cancelled %s\n", p->jid, p->cmd);
+        printf("shell> ");
+        fflush(stdout);
+    }
+    delete_job_by_jid(p->jid);
+}
+
+/* lance p : un sous-shell, qui expanse la commande lui-même. le job lancé
+   prend la place de p (son jid, les jobs qui l'attendent) */
+static void start(job_t *p) {
+    struct node *root;
+    char *err;
+    int jid = -1;
+
+    if (ast_parse(p->pending, &root, &err) == AST_OK && root) {
+        jid = launch_node(root, -1, RUNNING);
+        ast_free(root);
+    }
+    if (jid < 0) {
+        cancel(p);
+        return;
+    }
+
+    job_t *j = get_job_by_jid(jid);
+    j->dependents = p->dependents;
+    j->waited = p->waited;
+    jid = p->jid;
+    free(p->pending);
+    p->pending = NULL;
+    delete_job_by_jid(jid);
+    renumber_job(j, jid);
+}
+
+static void after_tick(void) {
+    uint64_t n;
+
+    if (read(efd, &n, sizeof(n)) != sizeof(n)) {
+        /* déjà lu (un tick dans un tick) : la file est quand même vidée */
+    }
+
+    sigset_t prev;
+    block_sigchld(&prev);
+
+    /* cancel peut en ajouter : on continue jusqu'à ce qu'elle soit vide */
+    while (nready > 0) {
+        job_t *p = get_job_by_jid(ready[rhead]);
+        rhead = (rhead + 1) % MAXJOBS;
+        nready--;
+
+        if (!p || p->state != PENDING) continue;
+        if (p->ok_only && p->dep_failed) cancel(p);
+        else start(p);
+    }
+
+    unblock_sigchld(&prev);
+}
+
+int is_after(struct cmdline *raw) {
+    return raw->seq[0] && raw->seq[0][0] &&
+           strcmp(raw->seq[0][0], "after") == 0;
+}
+
+/* ajoute s à la fin de *buf (de taille *size) */
+static void append(char **buf, size_t *size, const char *s) {
+    size_t len = *buf ? strlen(*buf) : 0, n = strlen(s);
+
+    if (len + n + 1 > *size) {
+        *size = 2 * (len + n + 1);
+        *buf = Realloc(*buf, *size);
+        if (len == 0) (*buf)[0] = '\0';
+    }
+    memcpy(*buf + len, s, n + 1);
+}
+
+/* le texte de la ligne brute raw à partir du mot first : il sera parsé
+   de nouveau au départ */
+static char *line_text(struct cmdline *raw, int first) {
+    char *buf = NULL;
+    size_t size = 0;
+
+    for (int i = 0; raw->seq[i]; i++) {
+        if (i > 0) append(&buf, &size, " | ");
+        for (int k = i == 0 ? first : 0; raw->seq[i][k]; k++) {
+            if (k > (i == 0 ? first : 0)) append(&buf, &size, " ");
+            append(&buf, &size, raw->seq[i][k]);
+        }
+    }
+    if (raw->in) {
+        append(&buf, &size, " < ");
+        append(&buf, &size, raw->in);
+    }
+    if (raw->out) {
+        append(&buf, &size, " > ");
+        append(&buf, &size, raw->out);
+    }
+    return buf;
+}
+
+static int usage(void) {
+    fprintf(stderr, "usage: after %%n... [--ok] cmd\n");
+    return -1;
+}
+
+int launch_after(struct cmdline *raw) {
+    char **argv = raw->seq[0];
+    int deps[MAXDEPS], ndeps = 0, ok = 0, i = 1;
+
+    sigset_t prev;
+    block_sigchld(&prev);
+
+    /* les jobs attendus et --ok, avant la commande */
+    for (; argv[i]; i++) {
+        if (strcmp(argv[i], "--ok") == 0) {
+            ok = 1;
+        } else if (argv[i][0] == '%') {
+            job_t *d = get_job_by_id_str(argv[i]);
+            if (!d) {
+                fprintf(stderr, "after: job introuvable : %s\n", argv[i]);
+                unblock_sigchld(&prev);
+                return -1;
+            }
+            if (ndeps == MAXDEPS) {
+                fprintf(stderr, "after: %d jobs au plus\n", MAXDEPS);
+                unblock_sigchld(&prev);
+                return -1;
+            }
+            deps[ndeps++] = d->jid;
+        } else {
+            break;
+        }
+    }
+    if (ndeps == 0 || !argv[i]) {
+        unblock_sigchld(&prev);
+        return usage();
+    }
+
+    if (owner != getpid()) {
+        /* l'eventfd et la file sont ceux du père (timers_forget a fermé
+           notre copie) */
+        efd = -1;
+        rhead = nready = 0;
+        owner = getpid();
+    }
+    if (efd < 0) {
+        efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (efd >= 0 && timers_add(efd, after_tick) < 0) {
+            close(efd);
+            efd = -1;
+        }
+        if (efd < 0) {
+            perror("after");
+            unblock_sigchld(&prev);
+            return -1;
+        }
+    }
+
+    char *text = line_text(raw, i);
+    int jid = add_job(0, 0, PENDING, text);
+    if (jid < 0) {
+        free(text);
+        unblock_sigchld(&prev);
+        return -1;
+    }
+
+    job_t *p = get_job_by_jid(jid);
+    p->nprocs = 0;
+    p->pending = text;
+    p->ok_only = ok;
+    p->ndeps = ndeps;
+
+    /* une arête par job attendu, en tête de sa liste. un job déjà fini
+       (gardé pour wait) donne tout de suite son code */
+    for (int k = 0; k < ndeps; k++) {
+        job_t *d = get_job_by_jid(deps[k]);
+
+        if (d->state == DONE) {
+            if (job_code(d) != 0) p->dep_failed = 1;
+            p->deps[k] = 0;
+            continue;
+        }
+        p->deps[k] = d->jid;
+        p->next_edge[k] = d->dependents;
+        d->dependents.jid = jid;
+        d->dependents.k = k;
+        p->nwaiting++;
+    }
+    if (p->nwaiting == 0) push_ready(jid);
+
+    unblock_sigchld(&prev);
+    return jid;
+}
+
+int after_pending(void) {
+    if (owner != getpid()) return 0;
+
+    sigset_t prev;
+    block_sigchld(&prev);
+    int n = 0;
+    for (job_t *j = first_job(); j && !n; j = next_job(j))
+        n = j->state == PENDING;
+    unblock_sigchld(&prev);
+    return n;
+}
+
+void after_print_dag(void) {
+    static int out[MAXJOBS];
+
+    sigset_t prev;
+    block_sigchld(&prev);
+
+    for (job_t *j = first_job(); j; j = next_job(j)) {
+        if (!j->dependents.jid) continue;
+
+        /* la liste est dans l'ordre inverse des after */
+        int n = 0;
+        for (struct edge e = j->dependents; e.jid;
+             e = get_job_by_jid(e.jid)->next_edge[e.k])
+            if (n < MAXJOBS) out[n++] = e.jid;
+
+        printf("%%%d ->", j->jid);
+        while (n-- > 0)
+            printf(" %%%d%s", out[n],
+                   get_job_by_jid(out[n])->ok_only ? "(ok)" : "");
+        printf("\n");
+    }
+
+    unblock_sigchld(&prev);
+}
@@ -0,0 +1,46 @@
+#ifndef __AFTER_H__
+#define __AFTER_H__
+
+#include "readcmd.h"
+#include "jobs.h"
+
+/* ── after %n... [--ok] cmd ──
+   Enregistre cmd comme un job en attente (état Pending, pas encore de
+   processus) qui part quand tous les jobs donnés sont finis, ou avec
+   --ok seulement s’ils ont tous réussi : sinon il est annulé, et compte
+   lui-même comme un échec pour les jobs qui l’attendent. On peut
+   attendre un job en attente : les after forment un graphe (jobs -d en
+   montre les arêtes). Sans &, le shell attend que cmd ait tourné.
+
+   cmd est expansée quand elle part, comme si on la tapait à ce moment.
+   Le job lancé garde le numéro du job en attente.
+
+   Chaque job tient la liste des arêtes vers les jobs qui l’attendent,
+   chaînée dans ces jobs eux-mêmes (next_edge) : à la fin d’un job, le
+   handler SIGCHLD ne parcourt que cette liste, sans allocation. Les jobs
+   prêts sont mis en file et un eventfd (un timer pour timers.h) réveille
+   le shell, qui les lance hors du handler. Un script (ou un -c) qui
+   finit attend que ses jobs en attente soient partis ou annulés, et sa
+   dernière commande n’est pas lancée par exec à sa place. */
+
+#define AFTER_CANCELLED 125     /* code d’un job annulé (--ok) */
+
+/* Vrai si la ligne brute raw est un appel à after */
+int  is_after(struct cmdline *raw);
+
+/* Enregistre le job en attente de la ligne brute raw → jid, -1 si
+   erreur (message déjà affiché) */
+int  launch_after(struct cmdline *raw);
+
+/* Le job j vient de finir avec le code code : les jobs qui l’attendent
+   en sont avertis (SIGCHLD bloqué ou dans le handler) */
+void after_job_done(job_t *j, int code);
+
+/* Vrai s’il reste un job en attente : c’est le shell qui le lancera
+   (voir wait_shell_duties, exec.h) */
+int  after_pending(void);
+
+/* jobs -d : "%1 -> %3 %4(ok)", une ligne par job attendu */
+void after_print_dag(void);
+
+#endif
@@ -0,0 +1,537 @@
+/*
+ * Analyse des listes, conditions et boucles.
+ *
+ * La ligne est découpée par split_in_words(), puis on descend la grammaire :
+ *
+ *   liste    : et_ou ((';' | '&' | '&@' | '&pin' | '&batch' | '&low' | '&>>')
+ *              et_ou)*
+ *   et_ou    : commande (('&&' | '||') commande)*
+ *   commande : '(' liste ')' | '{' liste '}' | if | while | for | pipeline
+ *
+ * Un pipeline simple (mots, '<', '>', '|') est transformé en struct cmdline
+ * par cmdline_from_words() : c’est la feuille de l’arbre.
+ */
+
+#include "ast.h"
+#include "csapp.h"
+#include "jobs.h"
+
+#define AST_CACHE_SIZE 64   /* nombre de lignes gardées dans le cache */
+
+struct parser {
+    char **tok;    /* tokens de split_in_words(), NULL une fois consommés */
+    int    ntok;
+    int    pos;
+    int    more;   /* fin des tokens au milieu d’une construction */
+    char  *err;
+};
+
+static char errbuf[128];
+
+static char *peek(struct parser *p)
+{
+    return p->pos < p->ntok ? p->tok[p->pos] : NULL;
+}
+
+/* on prend le token courant : il n’appartient plus au parser */
+static char *take(struct parser *p)
+{
+    char *w = p->tok[p->pos];
+    p->tok[p->pos++] = NULL;
+    return w;
+}
+
+static int is_op(const char *w, const char *op)
+{
+    return w && is_operator_word(w) && strcmp(w, op) == 0;
+}
+
+/* '&', '&pin', '&low'... : tout ce qui met en arrière-plan, sauf &@ */
+static int is_background_op(const char *w)
+{
+    return w && is_operator_word(w) && w[0] == '&' &&
+           w[1] != '&' && w[1] != '@';
+}
+
+/* les mots réservés ne sont reconnus qu’en début de commande */
+static int is_kw(const char *w, const char *kw)
+{
+    return w && !is_operator_word(w) && strcmp(w, kw) == 0;
+}
+
+static int is_end_kw(const char *w)
+{
+    return is_kw(w, "then") || is_kw(w, "elif") || is_kw(w, "else") ||
+           is_kw(w, "fi")   || is_kw(w, "do")   || is_kw(w, "done") ||
+           is_kw(w, "}");
+}
+
+static void syntax_error(struct parser *p, const char *w)
+{
+    if (p->err || p->more) return;
+    snprintf(errbuf, sizeof(errbuf), "syntax error near '%s'", w);
+    p->err = errbuf;
+}
+
+static int failed(struct parser *p)
+{
+    return p->err || p->more;
+}
+
+static struct node *new_node(node_type type)
+{
+    struct node *n = Calloc(1, sizeof(struct node));
+    n->type = type;
+    return n;
+}
+
+static struct node *new_pair(node_type type, struct node *a, struct node *b)
+{
+    struct node *n = new_node(type);
+    n->a = a;
+    n->b = b;
+    return n;
+}
+
+void ast_free(struct node *n)
+{
+    if (!n) return;
+    if (n->cmd) freecmdline(n->cmd);
+    ast_free(n->a);
+    ast_free(n->b);
+    ast_free(n->c);
+    free(n->var);
+    if (n->words) {
+        for (int i = 0; n->words[i]; i++) free(n->words[i]);
+        free(n->words);
+    }
+    free(n);
+}
+
+/* le mot attendu doit être là : sinon il manque la suite, ou c’est une
+   erreur */
+static int expect_kw(struct parser *p, const char *kw)
+{
+    char *w = peek(p);
+
+    if (failed(p)) return 0;
+    if (!w) { p->more = 1; return 0; }
+    if (!is_kw(w, kw)) { syntax_error(p, w); return 0; }
+    free(take(p));
+    return 1;
+}
+
+static void skip_separators(struct parser *p)
+{
+    while (is_op(peek(p), ";")) p->pos++;
+}
+
+static struct node *parse_list(struct parser *p);
+
+/* liste qui ne doit pas être vide (corps d’un if, d’une boucle...) */
+static struct node *parse_body(struct parser *p)
+{
+    struct node *n = parse_list(p);
+
+    if (!n && !failed(p)) {
+        if (peek(p)) syntax_error(p, peek(p));
+        else p->more = 1;
+    }
+    return n;
+}
+
+/* pipeline simple : tout jusqu’au prochain ; & && || ( ) */
+static struct node *parse_simple(struct parser *p)
+{
+    int start = p->pos, n = 0;
+    char *w;
+
+    while ((w = peek(p)) && !is_op(w, ";") && !is_background_op(w) &&
+           !is_op(w, "&@") && !is_op(w, "&&") && !is_op(w, "||") &&
+           !is_op(w, "(") && !is_op(w, ")"))
+        p->pos++;
+
+    char **words = Malloc((p->pos - start + 1) * sizeof(char *));
+    for (int i = start; i < p->pos; i++) {
+        words[n++] = p->tok[i];
+        p->tok[i] = NULL;
+    }
+    words[n] = NULL;
+
+    struct cmdline *cmd = cmdline_from_words(words);
+    if (cmd->err) {
+        p->err = cmd->err;
+        freecmdline(cmd);
+        return NULL;
+    }
+    struct node *node = new_node(N_CMD);
+    node->cmd = cmd;
+    return node;
+}
+
+/* if ou elif : la condition, then, puis elif / else / fi */
+static struct node *parse_if(struct parser *p)
+{
+    struct node *n = new_node(N_IF);
+
+    free(take(p));                  /* if ou elif */
+    n->a = parse_body(p);
+    if (!expect_kw(p, "then")) goto fail;
+    n->b = parse_body(p);
+    if (failed(p)) goto fail;
+
+    char *w = peek(p);
+    if (is_kw(w, "elif")) {
+        n->c = parse_if(p);
+    } else if (is_kw(w, "else")) {
+        free(take(p));
+        n->c = parse_body(p);
+        expect_kw(p, "fi");
+    } else {
+        expect_kw(p, "fi");
+    }
+    if (failed(p)) goto fail;
+    return n;
+fail:
+    ast_free(n);
+    return NULL;
+}
+
+static struct node *parse_while(struct parser *p)
+{
+    struct node *n = new_node(N_WHILE);
+
+    free(take(p));
+    n->a = parse_body(p);
+    if (!expect_kw(p, "do")) goto fail;
+    n->b = parse_body(p);
+    if (!expect_kw(p, "done")) goto fail;
+    return n;
+fail:
+    ast_free(n);
+    return NULL;
+}
+
+static struct node *parse_for(struct parser *p)
+{
+    struct node *n = new_node(N_FOR);
+    int nw = 0;
+    char *w;
+
+    free(take(p));
+    w = peek(p);
+    if (!w) { p->more = 1; goto fail; }
+    if (is_operator_word(w)) { syntax_error(p, w); goto fail; }
+    n->var = take(p);
+    if (!expect_kw(p, "in")) goto fail;
+
+    /* la liste va jusqu’au ';' (ou la fin de ligne) */
+    n->words = Malloc(sizeof(char *));
+    n->words[0] = NULL;
+    while ((w = peek(p)) && !is_op(w, ";")) {
+        if (is_operator_word(w)) { syntax_error(p, w); goto fail; }
+        n->words = Realloc(n->words, (nw + 2) * sizeof(char *));
+        n->words[nw++] = take(p);
+        n->words[nw] = NULL;
+    }
+    skip_separators(p);
+    if (!expect_kw(p, "do")) goto fail;
+    n->b = parse_body(p);
+    if (!expect_kw(p, "done")) goto fail;
+    return n;
+fail:
+    ast_free(n);
+    return NULL;
+}
+
+/* ( liste ) ou { liste } */
+static struct node *parse_group(struct parser *p, node_type type)
+{
+    struct node *n = new_node(type);
+
+    char *w = take(p);
+    if (type == N_GROUP) free(w);       /* '{' est un mot, '(' un opérateur */
+    n->a = parse_body(p);
+    if (failed(p)) goto fail;
+    if (type == N_GROUP) {
+        if (!expect_kw(p, "}")) goto fail;
+    } else {
+        w = peek(p);
+        if (!w) { p->more = 1; goto fail; }
+        if (!is_op(w, ")")) { syntax_error(p, w); goto fail; }
+        p->pos++;
+    }
+    return n;
+fail:
+    ast_free(n);
+    return NULL;
+}
+
+static struct node *parse_command(struct parser *p)
+{
+    char *w = peek(p);
+
+    if (!w) { p->more = 1; return NULL; }
+    if (is_op(w, "("))      return parse_group(p, N_SUBSHELL);
+    if (is_kw(w, "{"))      return parse_group(p, N_GROUP);
+    if (is_kw(w, "if"))     return parse_if(p);
+    if (is_kw(w, "while"))  return parse_while(p);
+    if (is_kw(w, "for"))    return parse_for(p);
+    if (is_end_kw(w) || is_op(w, ")") || is_op(w, ";") || is_op(w, "&") ||
+        is_op(w, "&&") || is_op(w, "||")) {
+        syntax_error(p, w);
+        return NULL;
+    }
+    return parse_simple(p);
+}
+
+static struct node *parse_and_or(struct parser *p)
+{
+    struct node *n = parse_command(p);
+    char *w;
+
+    while (n && ((w = peek(p)) && (is_op(w, "&&") || is_op(w, "||")))) {
+        node_type type = is_op(w, "&&") ? N_AND : N_OR;
+        p->pos++;
+        skip_separators(p);         /* a &&<retour à la ligne> b */
+        struct node *r = parse_command(p);
+        if (!r) { ast_free(n); return NULL; }
+        n = new_pair(type, n, r);
+    }
+    return n;
+}
+
+/* a & : pour une commande simple c’est le '&' habituel, sinon le noeud
+   entier part en arrière-plan dans un fils. &pin, &low... ajoutent
+   leurs options */
+static void set_background(struct node *n, const char *op)
+{
+    if (n->type == N_CMD) {
+        n->cmd->background = 1;
+        background_flags(op, &n->cmd->pin, &n->cmd->prio, &n->cmd->capture);
+    } else {
+        n->background = 1;
+        background_flags(op, &n->pin, &n->prio, &n->capture);
+    }
+}
+
+static struct node *parse_list(struct parser *p)
+{
+    struct node *list = NULL;
+    char *w;
+
+    for (;;) {
+        skip_separators(p);
+        w = peek(p);
+        if (!w || is_op(w, ")") || is_end_kw(w)) break;
+
+        struct node *n = parse_and_or(p);
+        if (!n) { ast_free(list); return NULL; }
+
+        w = peek(p);
+        if (is_background_op(w)) {
+            set_background(n, w);
+            p->pos++;
+        } else if (is_op(w, "&@")) {
+            /* a &@ : le texte de a part chez un agent (voir remote.h) */
+            n->background = 1;
+            n->remote = 1;
+            p->pos++;
+        } else if (w && !is_op(w, ";") && !is_op(w, ")") && !is_end_kw(w)) {
+            syntax_error(p, w);
+            ast_free(n);
+            ast_free(list);
+            return NULL;
+        }
+        list = list ? new_pair(N_SEQ, list, n) : n;
+    }
+    return list;
+}
+
+int ast_parse(char *text, struct node **root, char **err)
+{
+    struct parser p;
+    char *split_err = NULL;
+
+    *root = NULL;
+    memset(&p, 0, sizeof(p));
+    p.tok = split_in_words(text, &split_err);
+    while (p.tok[p.ntok]) p.ntok++;
+
+    if (split_err) {
+        /* quote ou $( ouverte : la suite est sur la ligne suivante */
+        p.more = 1;
+    } else {
+        *root = parse_list(&p);
+        if (!failed(&p) && p.pos < p.ntok)
+            syntax_error(&p, p.tok[p.pos]);
+    }
+
+    for (int i = 0; i < p.ntok; i++)
+        if (p.tok[i] && !is_operator_word(p.tok[i])) free(p.tok[i]);
+    free(p.tok);
+
+    if (failed(&p)) {
+        ast_free(*root);
+        *root = NULL;
+        *err = p.err;
+        return p.more ? AST_MORE : AST_ERROR;
+    }
+    return AST_OK;
+}
+
+
+/* Cache des lignes analysées : table à accès direct indexée par le hash
+   de la ligne. Les corps de boucle, les lignes d’un script relancées et
+   les $(...) répétés ne sont analysés qu’une fois. */
+
+static struct {
+    unsigned long hash;
+    char         *text;
+    struct node  *root;
+} cache[AST_CACHE_SIZE];
+
+/* FNV-1a */
+static unsigned long hash_text(const char *s)
+{
+    unsigned long h = 1469598103934665603UL;
+    for (; *s; s++) {
+        h ^= (unsigned char)*s;
+        h *= 1099511628211UL;
+    }
+    return h;
+}
+
+void ast_release(struct node *root)
+{
+    if (root && --root->refs == 0)
+        ast_free(root);
+}
+
+int ast_parse_cached(char *text, struct node **root, char **err)
+{
+    unsigned long h = hash_text(text);
+    int slot = h % AST_CACHE_SIZE;
+
+    if (cache[slot].text && cache[slot].hash == h &&
+        strcmp(cache[slot].text, text) == 0) {
+        *root = cache[slot].root;
+        if (*root) (*root)->refs++;
+        return AST_OK;
+    }
+
+    int r = ast_parse(text, root, err);
+    if (r != AST_OK) return r;
+
+    /* on remplace l’ancienne ligne : elle n’est libérée que quand plus
+       personne ne l’exécute */
+    ast_release(cache[slot].root);
+    free(cache[slot].text);
+    cache[slot].hash = h;
+    cache[slot].text = strdup(text);
+    cache[slot].root = *root;
+    if (*root) (*root)->refs = 2;   /* le cache + l’appelant */
+    return AST_OK;
+}
+
+
+/* ── affichage ── */
+
+static void put(char *buf, int buflen, const char *s)
+{
+    int len = strlen(buf);
+    if (len < buflen - 1)
+        strncat(buf, s, buflen - len - 1);
+}
+
+/* l’opérateur qui a mis en arrière-plan */
+static const char *background_str(int pin, int prio, int capture)
+{
+    if (capture) return " &>>";
+    if (pin) return " &pin";
+    if (prio == CLASS_LOW) return " &low";
+    if (prio == CLASS_BATCH) return " &batch";
+    return " &";
+}
+
+static void format_rec(struct node *n, char *buf, int buflen)
+{
+    if (!n) return;
+
+    switch (n->type) {
+    case N_CMD:
+        for (int i = 0; n->cmd->seq[i]; i++) {
+            if (i > 0) put(buf, buflen, " | ");
+            for (int j = 0; n->cmd->seq[i][j]; j++) {
+                if (j > 0) put(buf, buflen, " ");
+                put(buf, buflen, n->cmd->seq[i][j]);
+            }
+        }
+        if (n->cmd->in)  { put(buf, buflen, " < "); put(buf, buflen, n->cmd->in); }
+        if (n->cmd->out) { put(buf, buflen, " > "); put(buf, buflen, n->cmd->out); }
+        if (n->cmd->background)
+            put(buf, buflen, background_str(n->cmd->pin, n->cmd->prio,
+                                           n->cmd->capture));
+        break;
+    case N_SEQ:
+        format_rec(n->a, buf, buflen);
+        put(buf, buflen, "; ");
+        format_rec(n->b, buf, buflen);
+        break;
+    case N_AND:
+    case N_OR:
+        format_rec(n->a, buf, buflen);
+        put(buf, buflen, n->type == N_AND ? " && " : " || ");
+        format_rec(n->b, buf, buflen);
+        break;
+    case N_GROUP:
+        put(buf, buflen, "{ ");
+        format_rec(n->a, buf, buflen);
+        put(buf, buflen, "; }");
+        break;
+    case N_SUBSHELL:
+        put(buf, buflen, "( ");
+        format_rec(n->a, buf, buflen);
+        put(buf, buflen, " )");
+        break;
+    case N_IF:
+        put(buf, buflen, "if ");
+        format_rec(n->a, buf, buflen);
+        put(buf, buflen, "; then ");
+        format_rec(n->b, buf, buflen);
+        if (n->c) {
+            put(buf, buflen, "; else ");
+            format_rec(n->c, buf, buflen);
+        }
+        put(buf, buflen, "; fi");
+        break;
+    case N_WHILE:
+        put(buf, buflen, "while ");
+        format_rec(n->a, buf, buflen);
+        put(buf, buflen, "; do ");
+        format_rec(n->b, buf, buflen);
+        put(buf, buflen, "; done");
+        break;
+    case N_FOR:
+        put(buf, buflen, "for ");
+        put(buf, buflen, n->var);
+        put(buf, buflen, " in");
+        for (int i = 0; n->words[i]; i++) {
+            put(buf, buflen, " ");
+            put(buf, buflen, n->words[i]);
+        }
+        put(buf, buflen, "; do ");
+        format_rec(n->b, buf, buflen);
+        put(buf, buflen, "; done");
+        break;
+    }
+    if (n->remote) put(buf, buflen, " &@");
+    else if (n->background)
+        put(buf, buflen, background_str(n->pin, n->prio, n->capture));
+}
+
+void ast_format(struct node *n, char *buf, int buflen)
+{
+    buf[0] = '\0';
+    format_rec(n, buf, buflen);
+}
@@ -0,0 +1,54 @@
+#ifndef __AST_H__
+#define __AST_H__
+
+#include "readcmd.h"
+
+/* ── Arbre d’une ligne de commande ──
+   Les feuilles sont des struct cmdline (un pipeline simple, mots pas encore
+   expansés) : on les lance avec le code habituel. Le reste décrit les
+   listes, les && / ||, les groupes et les boucles. */
+
+typedef enum {
+    N_CMD,       /* pipeline simple : cmd */
+    N_SEQ,       /* a ; b */
+    N_AND,       /* a && b */
+    N_OR,        /* a || b */
+    N_GROUP,     /* { a; } */
+    N_SUBSHELL,  /* ( a ) : exécuté dans un fils */
+    N_IF,        /* if a; then b; else c; fi (elif = un N_IF dans c) */
+    N_WHILE,     /* while a; do b; done */
+    N_FOR        /* for var in words; do b; done */
+} node_type;
+
+struct node {
+    node_type       type;
+    struct cmdline *cmd;         /* N_CMD */
+    struct node    *a, *b, *c;   /* fils, selon le type (voir plus haut) */
+    char           *var;         /* N_FOR : nom de la variable */
+    char          **words;       /* N_FOR : liste, mots non expansés */
+    int             background;  /* noeud composé suivi de '&' */
+    int             remote;      /* suivi de '&@' : lancé chez un agent */
+    int             pin;         /* suivi de '&pin' (voir cpumap.h) */
+    int             prio;        /* '&batch', '&low' (voir prio.h) */
+    int             capture;     /* '&>>' : sortie gardée (voir capture.h) */
+    int             refs;        /* racine : références (cache compris) */
+};
+
+/* Résultats de ast_parse() */
+#define AST_OK     0   /* *root rempli (NULL pour une ligne vide) */
+#define AST_MORE   1   /* ligne incomplète : il faut lire la suite */
+#define AST_ERROR  2   /* erreur de syntaxe, message dans *err */
+
+/* Analyse text (qui n’est pas modifié) */
+int  ast_parse(char *text, struct node **root, char **err);
+void ast_free(struct node *n);
+
+/* Pareil, mais en passant par le cache des lignes déjà analysées.
+   Avec AST_OK, *root est réservé : le rendre avec ast_release() */
+int  ast_parse_cached(char *text, struct node **root, char **err);
+void ast_release(struct node *root);
+
+/* Texte lisible du noeud (pour jobs) */
+void ast_format(struct node *n, char *buf, int buflen);
+
+#endif
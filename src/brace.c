@@ -0,0 +1,307 @@
+/*
+ * Expansion des accolades {a,b} et {1..N} sous forme de générateur.
+ *
+ * Un mot est découpé en morceaux : du texte, des listes {a,b,c} et des
+ * intervalles {x..y..pas}. Le générateur est un compteur : chaque morceau
+ * a sa position courante, on avance le dernier et on propage la retenue
+ * vers la gauche. Seules les listes sont stockées (elles sont tapées à la
+ * main, donc petites) ; un intervalle n’est que ses bornes et sa valeur
+ * courante.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <limits.h>
+#include "csapp.h"
+#include "readcmd.h"
+#include "brace.h"
+
+typedef enum { P_TEXT, P_LIST, P_RANGE } part_kind;
+
+struct brace_part {
+    part_kind kind;
+
+    /* P_TEXT */
+    char  *text;
+    size_t len;
+
+    /* P_LIST : alternatives déjà développées (accolades imbriquées) */
+    char **alts;
+    int    nalts;
+    int    idx;
+
+    /* P_RANGE */
+    long   from, to, step, cur;
+    int    width;       /* {01..10} : on complète avec des zéros */
+    int    letters;     /* {a..z} */
+};
+
+/* saute le caractère ou la zone protégée qui commence en s
+   → NULL si une quote ou une substitution n’est pas fermée */
+static const char *skip(const char *s) {
+    if (*s == '\\' || *s == '\'' || *s == '"' || *s == '`' ||
+        (*s == '$' && s[1] == '('))
+        return skip_span((char *)s);
+    if (*s == '$' && s[1] == '{') {
+        const char *e = strchr(s, '}');
+        return e ? e + 1 : NULL;
+    }
+    return s + 1;
+}
+
+/* accolade fermante qui correspond au '{' en s, NULL si aucune */
+static const char *match_brace(const char *s) {
+    int depth = 0;
+
+    while (s && *s) {
+        if (*s == '{') depth++;
+        else if (*s == '}' && --depth == 0) return s;
+        s = skip(s);
+    }
+    return NULL;
+}
+
+/* position de la première virgule au premier niveau de [s, end), ou NULL */
+static const char *top_comma(const char *s, const char *end) {
+    int depth = 0;
+
+    while (s && s < end) {
+        if (*s == '{') depth++;
+        else if (*s == '}') depth--;
+        else if (*s == ',' && depth == 0) return s;
+        s = skip(s);
+    }
+    return NULL;
+}
+
+/* lit un entier signé sur [s, end) → pointeur après, NULL si pas un entier
+   ou s'il ne tient pas dans un long */
+static const char *parse_long(const char *s, const char *end, long *v) {
+    const char *p = s;
+    if (p < end && *p == '-') p++;
+    if (p >= end || !isdigit((unsigned char)*p)) return NULL;
+    while (p < end && isdigit((unsigned char)*p)) p++;
+    errno = 0;
+    *v = strtol(s, NULL, 10);
+    if (errno == ERANGE) return NULL;
+    return p;
+}
+
+/* {x..y} ou {x..y..pas} sur [s, end) → 1 et *part rempli, 0 sinon */
+static int parse_range(const char *s, const char *end, struct brace_part *part) {
+    const char *p;
+    long step = 1;
+
+    memset(part, 0, sizeof(*part));
+    part->kind = P_RANGE;
+
+    if (end - s >= 4 && isalpha((unsigned char)s[0]) &&
+        s[1] == '.' && s[2] == '.' && isalpha((unsigned char)s[3])) {
+        part->letters = 1;
+        part->from = s[0];
+        part->to = s[3];
+        p = s + 4;
+    } else {
+        const char *mid = parse_long(s, end, &part->from);
+        if (!mid || end - mid < 3 || mid[0] != '.' || mid[1] != '.') return 0;
+        p = parse_long(mid + 2, end, &part->to);
+        if (!p) return 0;
+
+        /* un zéro en tête : largeur fixe, celle de la plus longue borne */
+        const char *a = (*s == '-') ? s + 1 : s;
+        const char *b = (mid[2] == '-') ? mid + 3 : mid + 2;
+        if ((a[0] == '0' && a + 1 < mid) || (b[0] == '0' && b + 1 < p)) {
+            int wa = mid - s, wb = p - (mid + 2);
+            part->width = wa > wb ? wa : wb;
+        }
+    }
+
+    if (p < end) {
+        if (end - p < 3 || p[0] != '.' || p[1] != '.') return 0;
+        p = parse_long(p + 2, end, &step);
+        if (!p || step == 0 || step == LONG_MIN) return 0;
+        if (step < 0) step = -step;
+    }
+    if (p != end) return 0;
+
+    part->step = (part->from <= part->to) ? step : -step;
+    part->cur = part->from;
+    return 1;
+}
+
+static void add_part(struct brace_gen *g, struct brace_part *part) {
+    g->parts = Realloc(g->parts, (g->nparts + 1) * sizeof(struct brace_part));
+    g->parts[g->nparts++] = *part;
+}
+
+static void add_text(struct brace_gen *g, const char *s, size_t len) {
+    struct brace_part part;
+
+    if (len == 0) return;
+    memset(&part, 0, sizeof(part));
+    part.kind = P_TEXT;
+    part.text = Malloc(len);
+    memcpy(part.text, s, len);
+    part.len = len;
+    add_part(g, &part);
+}
+
+/* {a,b,c} sur [s, end) : chaque alternative est développée à son tour */
+static void add_list(struct brace_gen *g, const char *s, const char *end) {
+    struct brace_part part;
+
+    memset(&part, 0, sizeof(part));
+    part.kind = P_LIST;
+
+    for (;;) {
+        const char *comma = top_comma(s, end);
+        const char *stop = comma ? comma : end;
+        char *alt = strndup(s, stop - s);
+        struct brace_gen sub;
+        const char *w;
+
+        brace_open(&sub, alt);
+        while ((w = brace_next(&sub)) != NULL) {
+            part.alts = Realloc(part.alts, (part.nalts + 1) * sizeof(char *));
+            part.alts[part.nalts++] = strdup(w);
+        }
+        brace_close(&sub);
+        free(alt);
+
+        if (!comma) break;
+        s = comma + 1;
+    }
+    add_part(g, &part);
+}
+
+/* cherche la prochaine accolade à développer à partir de s.
+   → son '{' (et *close sur le '}'), NULL s’il n’y en a plus */
+static const char *find_brace(const char *s, const char **close,
+                              struct brace_part *range, int *is_range) {
+    while (s && *s) {
+        if (*s == '{') {
+            const char *e = match_brace(s);
+            if (!e) return NULL;
+            if (top_comma(s + 1, e)) {
+                *is_range = 0;
+                *close = e;
+                return s;
+            }
+            if (parse_range(s + 1, e, range)) {
+                *is_range = 1;
+                *close = e;
+                return s;
+            }
+            s++;                    /* {} ou {abc} : rien à faire */
+            continue;
+        }
+        s = skip(s);
+    }
+    return NULL;
+}
+
+int brace_has(const char *raw) {
+    const char *close;
+    struct brace_part range;
+    int is_range;
+
+    return strchr(raw, '{') && find_brace(raw, &close, &range, &is_range);
+}
+
+void brace_open(struct brace_gen *g, const char *raw) {
+    const char *s = raw, *open, *close;
+    struct brace_part range;
+    int is_range;
+
+    memset(g, 0, sizeof(*g));
+
+    while ((open = find_brace(s, &close, &range, &is_range)) != NULL) {
+        add_text(g, s, open - s);
+        if (is_range) add_part(g, &range);
+        else add_list(g, open + 1, close);
+        s = close + 1;
+    }
+    add_text(g, s, strlen(s));      /* sans morceau : un mot vide */
+}
+
+/* ajoute n octets à la fin du mot courant */
+static void put(struct brace_gen *g, size_t *len, const char *s, size_t n) {
+    if (*len + n + 1 > g->size) {
+        g->size = (*len + n + 1) * 2;
+        g->buf = Realloc(g->buf, g->size);
+    }
+    memcpy(g->buf + *len, s, n);
+    *len += n;
+}
+
+const char *brace_next(struct brace_gen *g) {
+    size_t len = 0;
+    char num[32];
+
+    if (g->done) return NULL;
+
+    /* le mot courant */
+    put(g, &len, "", 0);
+    for (int i = 0; i < g->nparts; i++) {
+        struct brace_part *p = &g->parts[i];
+        switch (p->kind) {
+        case P_TEXT:
+            put(g, &len, p->text, p->len);
+            break;
+        case P_LIST:
+            put(g, &len, p->alts[p->idx], strlen(p->alts[p->idx]));
+            break;
+        case P_RANGE:
+            if (p->letters) {
+                num[0] = (char)p->cur;
+                put(g, &len, num, 1);
+            } else {
+                int n = snprintf(num, sizeof(num), "%0*ld", p->width, p->cur);
+                put(g, &len, num, n);
+            }
+            break;
+        }
+    }
+    g->buf[len] = '\0';
+
+    /* on avance le compteur, le dernier morceau varie le plus vite */
+    int i;
+    for (i = g->nparts - 1; i >= 0; i--) {
+        struct brace_part *p = &g->parts[i];
+        if (p->kind == P_LIST) {
+            if (++p->idx < p->nalts) break;
+            p->idx = 0;
+        } else if (p->kind == P_RANGE) {
+            /* encore un pas avant la borne ? (en non signé : l'écart
+               entre cur et to peut dépasser LONG_MAX) */
+            unsigned long left = p->step > 0
+                ? (unsigned long)p->to - (unsigned long)p->cur
+                : (unsigned long)p->cur - (unsigned long)p->to;
+            unsigned long step = p->step > 0 ? (unsigned long)p->step
+                                             : -(unsigned long)p->step;
+            if (left >= step) {
+                p->cur += p->step;
+                break;
+            }
+            p->cur = p->from;
+        }
+    }
+    if (i < 0) g->done = 1;
+
+    return g->buf;
+}
+
+void brace_close(struct brace_gen *g) {
+    for (int i = 0; i < g->nparts; i++) {
+        struct brace_part *p = &g->parts[i];
+        free(p->text);
+        for (int k = 0; k < p->nalts; k++) free(p->alts[k]);
+        free(p->alts);
+    }
+    free(g->parts);
+    free(g->buf);
+    memset(g, 0, sizeof(*g));
+}
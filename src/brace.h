@@ -0,0 +1,40 @@
+#ifndef __BRACE_H__
+#define __BRACE_H__
+
+#include <stddef.h>
+
+/* ── Expansion des accolades ──
+   pre{a,b,c}post, {1..N}, {N..1}, {1..100..5}, {01..10}, {a..z}.
+   Plusieurs accolades dans un mot donnent le produit (la dernière varie
+   le plus vite) : {a,b}{1,2} → a1 a2 b1 b2.
+
+   C’est un générateur : les intervalles ne sont jamais matérialisés,
+   brace_next() fabrique le mot suivant dans un tampon réutilisé. Un
+   for i in {1..10000000} tourne donc en mémoire constante.
+   Les mots produits sont encore bruts (quotes, $x...) : l’expansion
+   habituelle passe après. Ce qui est entre quotes ou dans ${...}, $(...)
+   n’est pas touché. */
+
+struct brace_part;
+
+struct brace_gen {
+    struct brace_part *parts;
+    int                nparts;
+    char              *buf;      /* mot courant */
+    size_t             size;
+    int                done;
+};
+
+/* Prépare le générateur pour le mot brut raw (copié).
+   Sans accolade à développer, il ne produit que raw lui-même */
+void        brace_open(struct brace_gen *g, const char *raw);
+
+/* Mot suivant (valable jusqu’au prochain appel), NULL à la fin */
+const char *brace_next(struct brace_gen *g);
+
+void        brace_close(struct brace_gen *g);
+
+/* Vrai si raw contient des accolades à développer */
+int         brace_has(const char *raw);
+
+#endif
@@ -0,0 +1,549 @@
+/*
+ * Commandes internes du shell : elles agissent sur le shell lui-même
+ * (table des jobs, sortie) et ne passent donc pas par fork/exec.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <dlfcn.h>
+#include "csapp.h"
+#include "builtins.h"
+#include "exec.h"
+#include "jobs.h"
+#include "after.h"
+#include "capture.h"
+#include "vars.h"
+#include "prio.h"
+#include "gang.h"
+#include "waitjob.h"
+#include "history.h"
+
+/* quit ou q pour quitter */
+static int builtin_quit(char **argv) {
+    (void)argv;
+    printf("exit prog shell\n");
+    exit(0);
+}
+
+/* exit [n] : sort avec le code n (par défaut celui de la dernière
+   commande), utile surtout dans un sous-shell */
+static int builtin_exit(char **argv) {
+    shell_exit(argv[1] ? atoi(argv[1]) : last_status);
+    return 0;
+}
+
+/* affiche tous les jobs, ou avec -d les arêtes des after */
+static int builtin_jobs(char **argv) {
+    if (argv[1] && strcmp(argv[1], "-d") == 0) {
+        after_print_dag();
+    } else {
+        sigset_t prev;
+        block_sigchld(&prev);
+        list_jobs();
+        unblock_sigchld(&prev);
+    }
+    return 0;
+}
+
+/* met un job en foreground */
+static int builtin_fg(char **argv) {
+    const char *id_str = argv[1];
+    if (!id_str) { fprintf(stderr, "fg: argument manquant\n"); return 1; }
+
+    sigset_t prev;
+    block_sigchld(&prev);
+
+    job_t *j = get_job_by_id_str(id_str);
+    if (!j || j->state == DONE) {      // fini : il n'attend plus que wait
+        fprintf(stderr, "fg: job introuvable : %s\n", id_str);
+        unblock_sigchld(&prev);
+        return 1;
+    }
+    if (j->state == PENDING) {         // pas encore de processus (after)
+        fprintf(stderr, "fg: job pas encore lancé : %s\n", id_str);
+        unblock_sigchld(&prev);
+        return 1;
+    }
+
+    printf("%s\n", j->cmd);
+    fflush(stdout);        // avant que le job n'écrive à son tour
+    set_fg_job(j);
+
+    unblock_sigchld(&prev);
+
+    kill(-(j->pgid), SIGCONT);
+    return wait_fg_job();
+}
+
+/* met un job en background */
+static int builtin_bg(char **argv) {
+    const char *id_str = argv[1];
+    if (!id_str) { fprintf(stderr, "bg: argument manquant\n"); return 1; }
+
+    sigset_t prev;
+    block_sigchld(&prev);
+
+    job_t *j = get_job_by_id_str(id_str);
+    if (!j || j->state == DONE) {      // fini : il n'attend plus que wait
+        fprintf(stderr, "bg: job introuvable : %s\n", id_str);
+        unblock_sigchld(&prev);
+        return 1;
+    }
+    if (j->state == PENDING) {         // pas encore de processus (after)
+        fprintf(stderr, "bg: job pas encore lancé : %s\n", id_str);
+        unblock_sigchld(&prev);
+        return 1;
+    }
+
+    j->state = RUNNING;
+    printf("[%d] %d %s\n", j->jid, (int)j->pid, j->cmd);
+
+    unblock_sigchld(&prev);
+
+    kill(-(j->pgid), SIGCONT);
+    return 0;
+}
+
+/* stop un job */
+static int builtin_stop(char **argv) {
+    const char *id_str = argv[1];
+    if (!id_str) { fprintf(stderr, "stop: argument manquant\n"); return 1; }
+
+    sigset_t prev;
+    block_sigchld(&prev);
+
+    job_t *j = get_job_by_id_str(id_str);
+    if (!j || j->state == DONE) {      // fini : il n'attend plus que wait
+        fprintf(stderr, "stop: job introuvable : %s\n", id_str);
+        unblock_sigchld(&prev);
+        return 1;
+    }
+    if (j->state == PENDING) {         // pas encore de processus (after)
+        fprintf(stderr, "stop: job pas encore lancé : %s\n", id_str);
+        unblock_sigchld(&prev);
+        return 1;
+    }
+
+    /* déjà suspendu par gang : il n'y aura pas de nouvel arrêt à voir
+       pour le handler, on change l'état ici */
+    if (j->state == PAUSED) {
+        j->state = STOPPED;
+        printf("[%d] %d Stopped %s\n", j->jid, (int)j->pid, j->cmd);
+        unblock_sigchld(&prev);
+        return 0;
+    }
+
+    unblock_sigchld(&prev);
+    kill(-(j->pgid), SIGTSTP);
+    return 0;
+}
+
+/* wait [-n] [-t secondes] [%n|pid ...] : attend la fin des jobs, ou
+   du premier avec -n (voir waitjob.h) */
+static int builtin_wait(char **argv) {
+    int jids[MAXJOBS], n = 0, any = 0, status = 0;
+    long timeout_ms = -1;
+
+    for (int i = 1; argv[i]; i++) {
+        if (strcmp(argv[i], "-n") == 0) {
+            any = 1;
+        } else if (strcmp(argv[i], "-t") == 0) {
+            char *end;
+            double t = argv[i + 1] ? strtod(argv[i + 1], &end) : -1;
+            if (t < 0 || end == argv[i + 1] || *end) {
+                fprintf(stderr, "wait: usage : wait [-n] [-t secondes] "
+                                "[%%n|pid ...]\n");
+                return 2;
+            }
+            timeout_ms = (long)(t * 1000);
+            i++;
+        } else {
+            sigset_t prev;
+            block_sigchld(&prev);
+            job_t *j = get_job_by_id_str(argv[i]);
+            int jid = j ? j->jid : 0;
+            unblock_sigchld(&prev);
+
+            if (!jid) {
+                fprintf(stderr, "wait: job introuvable : %s\n", argv[i]);
+                status = WAIT_NOJOB;
+            } else if (n < MAXJOBS) {
+                jids[n++] = jid;
+            }
+        }
+    }
+
+    /* que des jobs inconnus : rien à attendre */
+    if (status && n == 0) return status;
+    return wait_jobs(jids, n, any, timeout_ms);
+}
+
+/* output [%n [-f]] : la sortie gardée du job n (&>>, voir capture.h),
+   -f pour suivre ce qui arrive. sans argument, les jobs qui en ont une */
+static int builtin_output(char **argv) {
+    const char *id = NULL;
+    int follow = 0;
+
+    if (!argv[1]) {
+        capture_list();
+        return 0;
+    }
+    for (int i = 1; argv[i]; i++) {
+        if (strcmp(argv[i], "-f") == 0) follow = 1;
+        else id = argv[i];
+    }
+    if (!id || id[0] != '%' || atoi(id + 1) <= 0) {
+        fprintf(stderr, "output: usage : output [%%n [-f]]\n");
+        return 2;
+    }
+    if (capture_print(atoi(id + 1), follow)) {
+        fprintf(stderr, "output: rien de gardé pour %s\n", id);
+        return 1;
+    }
+    return 0;
+}
+
+/* history [N] : les N dernières commandes. history -s motif : celles qui
+   contiennent motif (voir history.h) */
+static int builtin_history(char **argv) {
+    if (argv[1] && strcmp(argv[1], "-s") == 0) {
+        if (!argv[2] || argv[3]) {
+            fprintf(stderr, "history: usage : history -s motif\n");
+            return 2;
+        }
+        return history_search(argv[2]) > 0 ? 0 : 1;
+    }
+    if (argv[1] && (atoi(argv[1]) <= 0 || argv[2])) {
+        fprintf(stderr, "history: usage : history [N] | history -s motif\n");
+        return 2;
+    }
+    history_list(argv[1] ? atoi(argv[1]) : 0);
+    return 0;
+}
+
+/* export NAME[=valeur]... : la variable passe dans l'environnement des
+   commandes. sans argument, affiche les variables exportées */
+static int builtin_export(char **argv) {
+    int nl;
+
+    if (!argv[1]) {
+        vars_print_exported();
+        return 0;
+    }
+    for (int i = 1; argv[i]; i++) {
+        if (var_is_assign(argv[i], &nl)) {
+            argv[i][nl] = '\0';
+            var_set(argv[i], argv[i] + nl + 1, 1);
+        } else {
+            var_export(argv[i]);
+        }
+    }
+    return 0;
+}
+
+/* unset NAME... */
+static int builtin_unset(char **argv) {
+    for (int i = 1; argv[i]; i++) var_unset(argv[i]);
+    return 0;
+}
+
+/* set : options du shell, set opt pour la mettre, set noopt pour
+   l'enlever. sans argument, affiche les options.
+   autopin : les jobs en arrière-plan sont épinglés sur des cœurs libres
+   (voir cpumap.h)
+   autolow : ils sont baissés pendant une commande au premier plan (voir
+   prio.h)
+   capture : leur sortie est gardée, comme avec &>> (voir capture.h) */
+static const struct {
+    const char *name;
+    int        *value;
+} options[] = {
+    { "autopin", &exec_autopin },
+    { "autolow", &exec_autolow },
+    { "capture", &exec_capture },
+};
+
+static int builtin_set(char **argv) {
+    const size_t nopt = sizeof(options) / sizeof(options[0]);
+
+    if (!argv[1]) {
+        for (size_t k = 0; k < nopt; k++)
+            printf("%s\t%s\n", options[k].name, *options[k].value ? "on" : "off");
+        return 0;
+    }
+    for (int i = 1; argv[i]; i++) {
+        int on = strncmp(argv[i], "no", 2) != 0;
+        const char *name = on ? argv[i] : argv[i] + 2;
+        size_t k = 0;
+
+        while (k < nopt && strcmp(options[k].name, name) != 0) k++;
+        if (k < nopt) *options[k].value = on;
+        else {
+            fprintf(stderr, "set: option inconnue : %s\n", argv[i]);
+            return 2;
+        }
+    }
+    return 0;
+}
+
+/* renice %n classe : change la classe de priorité du job, pour tous
+   ses processus (voir prio.h) */
+static int builtin_renice(char **argv) {
+    if (!argv[1] || !argv[2]) {
+        fprintf(stderr, "renice: usage : renice %%n normal|batch|low\n");
+        return 2;
+    }
+    int cls = str_to_class(argv[2]);
+    if (cls < 0) {
+        fprintf(stderr, "renice: classe inconnue : %s\n", argv[2]);
+        return 2;
+    }
+
+    sigset_t prev;
+    block_sigchld(&prev);
+
+    job_t *j = get_job_by_id_str(argv[1]);
+    if (!j || j->state == DONE) {      // fini : il n'attend plus que wait
+        fprintf(stderr, "renice: job introuvable : %s\n", argv[1]);
+        unblock_sigchld(&prev);
+        return 1;
+    }
+    if (j->state == PENDING) {         // pas de groupe : pgid vaut 0
+        fprintf(stderr, "renice: job pas encore lancé : %s\n", argv[1]);
+        unblock_sigchld(&prev);
+        return 1;
+    }
+    j->cls = cls;
+    j->dimmed = 0;
+    pid_t pgid = j->pgid;
+
+    unblock_sigchld(&prev);
+
+    if (prio_set_pgrp(pgid, cls) < 0) {
+        fprintf(stderr, "renice: %s\n", strerror(errno));
+        return 1;
+    }
+    return 0;
+}
+
+/* gang K [quantum_ms] : au plus K jobs en arrière-plan tournent à la
+   fois, à tour de rôle (voir gang.h)
+   gang off            : tous tournent
+   gang -w W %n        : le job n a un poids W (sa part du processeur)
+   gang                : affiche les réglages */
+static int builtin_gang(char **argv) {
+    if (!argv[1]) {
+        gang_print();
+        return 0;
+    }
+    if (strcmp(argv[1], "off") == 0) {
+        gang_stop();
+        return 0;
+    }
+
+    if (strcmp(argv[1], "-w") == 0) {
+        int w = argv[2] ? atoi(argv[2]) : 0;
+        if (w < 1 || !argv[3]) {
+            fprintf(stderr, "gang: usage : gang -w poids %%n\n");
+            return 2;
+        }
+        sigset_t prev;
+        block_sigchld(&prev);
+        job_t *j = get_job_by_id_str(argv[3]);
+        if (j) j->weight = w;
+        unblock_sigchld(&prev);
+        if (!j) {
+            fprintf(stderr, "gang: job introuvable : %s\n", argv[3]);
+            return 1;
+        }
+        return 0;
+    }
+
+    int k = atoi(argv[1]);
+    int quantum = argv[2] ? atoi(argv[2]) : GANG_QUANTUM;
+    if (k < 1 || quantum < 1) {
+        fprintf(stderr, "gang: usage : gang K [quantum_ms] | gang off\n");
+        return 2;
+    }
+    if (gang_start(k, quantum) < 0) {
+        fprintf(stderr, "gang: %s\n", strerror(errno));
+        return 1;
+    }
+    return 0;
+}
+
+/* ── commandes chargées par enable -f (voir shell_plugin.h) ── */
+
+struct loaded {
+    char            *name;
+    shell_builtin_fn run;
+    void            *handle;
+};
+static struct loaded *loaded = NULL;
+static int nloaded = 0;
+
+shell_builtin_fn find_loaded_builtin(const char *name) {
+    for (int i = 0; i < nloaded; i++)
+        if (strcmp(loaded[i].name, name) == 0) return loaded[i].run;
+    return NULL;
+}
+
+/* charge la commande name depuis lib → 0, 1 si erreur */
+static int load_builtin(const char *lib, const char *name) {
+    void *handle = dlopen(lib, RTLD_NOW | RTLD_LOCAL);
+    if (!handle) {
+        fprintf(stderr, "enable: %s\n", dlerror());
+        return 1;
+    }
+
+    char sym[strlen(name) + sizeof(SHELL_BUILTIN_SUFFIX)];
+    snprintf(sym, sizeof(sym), "%s%s", name, SHELL_BUILTIN_SUFFIX);
+    shell_builtin_fn run = (shell_builtin_fn)dlsym(handle, sym);
+    if (!run) {
+        fprintf(stderr, "enable: %s: pas de fonction %s\n", lib, sym);
+        dlclose(handle);
+        return 1;
+    }
+
+    /* recharger remplace l'ancienne version */
+    for (int i = 0; i < nloaded; i++) {
+        if (strcmp(loaded[i].name, name) == 0) {
+            dlclose(loaded[i].handle);
+            loaded[i].run = run;
+            loaded[i].handle = handle;
+            return 0;
+        }
+    }
+    loaded = Realloc(loaded, (nloaded + 1) * sizeof(struct loaded));
+    loaded[nloaded].name = strdup(name);
+    loaded[nloaded].run = run;
+    loaded[nloaded].handle = handle;
+    nloaded++;
+    return 0;
+}
+
+/* enable -f lib.so nom... : charge des commandes
+   enable -d nom...        : les retire
+   enable                  : liste les commandes chargées */
+static int builtin_enable(char **argv) {
+    int status = 0;
+
+    if (!argv[1]) {
+        for (int i = 0; i < nloaded; i++)
+            printf("enable %s\n", loaded[i].name);
+        return 0;
+    }
+
+    if (strcmp(argv[1], "-f") == 0) {
+        if (!argv[2] || !argv[3]) {
+            fprintf(stderr, "enable: usage : enable -f lib.so nom...\n");
+            return 2;
+        }
+        for (int i = 3; argv[i]; i++)
+            status |= load_builtin(argv[2], argv[i]);
+        return status;
+    }
+
+    if (strcmp(argv[1], "-d") == 0) {
+        for (int i = 2; argv[i]; i++) {
+            int k = 0;
+            while (k < nloaded && strcmp(loaded[k].name, argv[i]) != 0) k++;
+            if (k == nloaded) {
+                fprintf(stderr, "enable: %s: pas chargée\n", argv[i]);
+                status = 1;
+                continue;
+            }
+            dlclose(loaded[k].handle);
+            free(loaded[k].name);
+            loaded[k] = loaded[--nloaded];
+        }
+        return status;
+    }
+
+    fprintf(stderr, "enable: option inconnue : %s\n", argv[1]);
+    return 2;
+}
+
+/* une commande chargée, seule : dans le shell, sans fork. les
+   redirections sont ouvertes ici et refermées après */
+static int run_loaded(struct cmdline *l, shell_builtin_fn run) {
+    int in = STDIN_FILENO, out = STDOUT_FILENO, status;
+
+    if (l->in && (in = open(l->in, O_RDONLY | O_CLOEXEC)) < 0) {
+        fprintf(stderr, "%s: %s\n", l->in, strerror(errno));
+        return 1;
+    }
+    if (l->out && (out = open(l->out, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                              0644)) < 0) {
+        fprintf(stderr, "%s: %s\n", l->out, strerror(errno));
+        if (in != STDIN_FILENO) close(in);
+        return 1;
+    }
+
+    int argc = 0;
+    while (l->seq[0][argc]) argc++;
+
+    fflush(stdout);         // la commande écrit directement sur out
+    status = run(argc, l->seq[0], in, out);
+
+    if (in != STDIN_FILENO) close(in);
+    if (out != STDOUT_FILENO) close(out);
+    return status;
+}
+
+/* table des commandes internes */
+static const struct {
+    const char *name;
+    int (*run)(char **argv);
+} builtins[] = {
+    { "quit", builtin_quit },
+    { "q",    builtin_quit },
+    { "exit", builtin_exit },
+    { "jobs", builtin_jobs },
+    { "fg",   builtin_fg   },
+    { "bg",   builtin_bg   },
+    { "stop", builtin_stop },
+    { "wait", builtin_wait },
+    { "output", builtin_output },
+    { "history", builtin_history },
+    { "export", builtin_export },
+    { "unset",  builtin_unset  },
+    { "set",    builtin_set    },
+    { "renice", builtin_renice },
+    { "gang",   builtin_gang   },
+    { "enable", builtin_enable },
+};
+
+const char *builtin_name(int i) {
+    if (i < 0 || (size_t)i >= sizeof(builtins) / sizeof(builtins[0]))
+        return NULL;
+    return builtins[i].name;
+}
+
+/* check si c'est une commande builtin */
+int handle_builtins(struct cmdline *l, int *status) {
+    if (!l->seq || !l->seq[0] || !l->seq[0][0]) return 0;
+
+    char *cmd = l->seq[0][0];
+
+    for (size_t i = 0; i < sizeof(builtins) / sizeof(builtins[0]); i++) {
+        if (strcmp(cmd, builtins[i].name) == 0) {
+            *status = builtins[i].run(l->seq[0]);
+            return 1;
+        }
+    }
+
+    /* dans un pipeline ou en arrière-plan, c'est le fils qui l'appelle
+       (voir spawn_pipeline) */
+    shell_builtin_fn run = find_loaded_builtin(cmd);
+    if (run && !l->seq[1] && !l->background && !l->nprocsub) {
+        *status = run_loaded(l, run);
+        return 1;
+    }
+    return 0;
+}
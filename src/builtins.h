@@ -0,0 +1,19 @@
+#ifndef __BUILTINS_H__
+#define __BUILTINS_H__
+
+#include "readcmd.h"
+#include "shell_plugin.h"
+
+/* Si l->seq[0] est une commande interne (jobs, fg, bg, stop, quit,
+   export, unset, enable) ou une commande chargée par enable -f seule,
+   on l’exécute dans le shell et on met son code de retour dans *status
+   → 1 si c’était une commande interne, 0 sinon */
+int handle_builtins(struct cmdline *l, int *status);
+
+/* Le nom de la commande interne numéro i, NULL après la dernière */
+const char *builtin_name(int i);
+
+/* La commande chargée par enable -f sous le nom name, NULL si aucune */
+shell_builtin_fn find_loaded_builtin(const char *name);
+
+#endif
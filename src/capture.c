@@ -0,0 +1,309 @@
+/*
+ * Sortie gardée des jobs (voir capture.h).
+ *
+ * L'anneau d'un job (buf, de taille size) grandit au fur et à mesure
+ * jusqu'à max au lieu d'être alloué d'un coup. written compte tous les
+ * octets reçus : l'anneau en contient les len derniers, et output -f
+ * n'affiche que ce qui dépasse ce qu'il a déjà montré. Les tubes sont
+ * dans un epoll à eux, qui est un des timers du shell.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/select.h>
+#include "csapp.h"
+#include "timers.h"
+#include "vars.h"
+#include "capture.h"
+
+#define READS_PER_TICK 4    /* un job bavard ne bloque pas le shell */
+
+struct capture {
+    int     jid;
+    int     fd;             /* bout lecture, -1 : le job a fini d'écrire */
+    char   *buf;
+    size_t  size, max;      /* taille de buf, et jusqu'où elle grandit */
+    size_t  start, len;
+    size_t  written;        /* octets reçus en tout */
+    long    born;           /* ordre de lancement des jobs */
+};
+
+static struct capture **caps = NULL;
+static int ncaps = 0, caps_size = 0;
+static size_t total = 0, total_max = CAPTURE_MAX;
+static long births = 0;
+static int epfd = -1;
+static pid_t owner = 0;         /* un sous-shell repart de zéro */
+
+static volatile sig_atomic_t interrupted = 0;
+
+static void on_int(int sig) {
+    (void)sig;
+    interrupted = 1;
+}
+
+static struct capture *find(int jid) {
+    for (int i = 0; i < ncaps; i++)
+        if (caps[i]->jid == jid) return caps[i];
+    return NULL;
+}
+
+/* le job a fini d'écrire */
+static void finish(struct capture *c) {
+    epoll_ctl(epfd, EPOLL_CTL_DEL, c->fd, NULL);
+    close(c->fd);
+    c->fd = -1;
+}
+
+static void drop(int i) {
+    struct capture *c = caps[i];
+
+    if (c->fd >= 0) finish(c);
+    total -= c->len;
+    free(c->buf);
+    free(c);
+    caps[i] = caps[--ncaps];
+}
+
+/* oublie les n plus anciens octets de c */
+static void cut(struct capture *c, size_t n) {
+    if (n == 0) return;
+    c->start = (c->start + n) % c->size;
+    c->len -= n;
+    total -= n;
+}
+
+/* au-delà de CAPTURE_MAX : les données du plus ancien job d'abord. un
+   job fini dont il ne reste rien est oublié */
+static void evict(void) {
+    while (total > total_max) {
+        int old = -1;
+        for (int i = 0; i < ncaps; i++)
+            if (caps[i]->len > 0 &&
+                (old < 0 || caps[i]->born < caps[old]->born))
+                old = i;
+        if (old < 0) return;
+
+        struct capture *c = caps[old];
+        cut(c, c->len < total - total_max ? c->len : total - total_max);
+        if (c->len == 0 && c->fd < 0) drop(old);
+    }
+}
+
+/* buf d'au moins need octets (au plus max), l'anneau remis à plat */
+static void grow(struct capture *c, size_t need) {
+    size_t size = c->size ? c->size : 4096;
+
+    while (size < need) size *= 2;
+    if (size > c->max) size = c->max;
+
+    char *buf = Malloc(size);
+    size_t first = c->len < c->size - c->start ? c->len : c->size - c->start;
+    if (c->len > 0) {
+        memcpy(buf, c->buf + c->start, first);
+        memcpy(buf + first, c->buf, c->len - first);
+    }
+    free(c->buf);
+    c->buf = buf;
+    c->size = size;
+    c->start = 0;
+}
+
+static void append(struct capture *c, const char *data, size_t n) {
+    c->written += n;
+    if (n >= c->max) {
+        data += n - c->max;
+        n = c->max;
+        cut(c, c->len);
+    } else if (c->len + n > c->max) {
+        cut(c, c->len + n - c->max);
+    }
+    if (c->len + n > c->size) grow(c, c->len + n);
+
+    size_t end = (c->start + c->len) % c->size;
+    size_t first = n < c->size - end ? n : c->size - end;
+    memcpy(c->buf + end, data, first);
+    memcpy(c->buf, data + first, n - first);
+    c->len += n;
+    total += n;
+    evict();
+}
+
+static void capture_tick(void) {
+    static char data[64 * 1024];
+    struct epoll_event ev[16];
+
+    int n = epoll_wait(epfd, ev, 16, 0);
+    for (int i = 0; i < n; i++) {
+        struct capture *c = ev[i].data.ptr;
+
+        for (int k = 0; k < READS_PER_TICK; k++) {
+            ssize_t r = read(c->fd, data, sizeof(data));
+            if (r > 0) {
+                append(c, data, r);
+                continue;
+            }
+            if (r < 0 && errno == EINTR) continue;
+            /* 0 : tous les processus du job ont fermé le tube */
+            if (r == 0 || errno != EAGAIN) finish(c);
+            break;
+        }
+    }
+}
+
+int capture_open(int *rd, int *wr) {
+    int p[2];
+
+    if (pipe(p) < 0) return -1;
+    fcntl(p[0], F_SETFD, FD_CLOEXEC);
+    fcntl(p[1], F_SETFD, FD_CLOEXEC);
+    fcntl(p[0], F_SETFL, O_NONBLOCK);
+    *rd = p[0];
+    *wr = p[1];
+    return 0;
+}
+
+void capture_attach(int jid, int rd) {
+    if (owner != getpid()) {
+        /* les anneaux et l'epoll sont ceux du père (timers_forget a fermé
+           notre copie) */
+        ncaps = 0;
+        total = 0;
+        epfd = -1;
+        owner = getpid();
+    }
+    if (epfd < 0) {
+        epfd = epoll_create1(EPOLL_CLOEXEC);
+        if (epfd >= 0 && timers_add(epfd, capture_tick) < 0) {
+            close(epfd);
+            epfd = -1;
+        }
+        if (epfd < 0) {
+            perror("capture");
+            close(rd);
+            return;
+        }
+    }
+
+    /* le jid a déjà servi : la sortie de l'ancien job est oubliée */
+    for (int i = 0; i < ncaps; i++) {
+        if (caps[i]->jid == jid) {
+            drop(i);
+            break;
+        }
+    }
+
+    struct capture *c = Calloc(1, sizeof(struct capture));
+    c->jid = jid;
+    c->fd = rd;
+    c->max = var_get_size("CAPTURE_SIZE", CAPTURE_SIZE);
+    c->born = ++births;
+    total_max = var_get_size("CAPTURE_MAX", CAPTURE_MAX);
+
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.ptr = c;
+    if (epoll_ctl(epfd, EPOLL_CTL_ADD, rd, &ev) < 0) {
+        perror("capture");
+        close(rd);
+        free(c);
+        return;
+    }
+
+    if (ncaps == caps_size) {
+        caps_size = caps_size ? 2 * caps_size : 16;
+        caps = Realloc(caps, caps_size * sizeof(struct capture *));
+    }
+    caps[ncaps++] = c;
+}
+
+static int by_born(const void *a, const void *b) {
+    const struct capture *x = *(struct capture * const *)a;
+    const struct capture *y = *(struct capture * const *)b;
+    return x->born < y->born ? -1 : x->born > y->born;
+}
+
+void capture_list(void) {
+    qsort(caps, ncaps, sizeof(struct capture *), by_born);
+    for (int i = 0; i < ncaps; i++) {
+        struct capture *c = caps[i];
+        printf("[%d] %zu octets", c->jid, c->len);
+        if (c->written > c->len)
+            printf(" (%zu perdus)", c->written - c->len);
+        printf(" %s\n", c->fd >= 0 ? "en cours" : "fini");
+    }
+}
+
+/* ce qui a été reçu à partir de l'octet from (ce qui en reste) */
+static void print_from(struct capture *c, size_t from) {
+    size_t first = c->written - c->len;
+
+    if (from < first) from = first;
+    if (from >= c->written) return;
+
+    size_t n = c->written - from;
+    size_t pos = (c->start + (from - first)) % c->size;
+    size_t a = n < c->size - pos ? n : c->size - pos;
+    fwrite(c->buf + pos, 1, a, stdout);
+    fwrite(c->buf, 1, n - a, stdout);
+}
+
+int capture_print(int jid, int follow) {
+    struct capture *c = find(jid);
+    if (!c) return 1;
+
+    if (c->written > c->len)
+        fprintf(stderr, "output: %zu octets perdus avant\n",
+                c->written - c->len);
+    print_from(c, 0);
+    fflush(stdout);
+    if (!follow) return 0;
+
+    /* -f : Ctrl-C arrête (sans SA_RESTART, pselect est interrompu). SIGINT
+       et SIGCHLD ne passent que pendant pselect : rien n'est perdu entre
+       le test et l'attente */
+    struct sigaction sa, old;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_int;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, &old);
+
+    sigset_t mask, prev, sleep_mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGCHLD);
+    sigaddset(&mask, SIGINT);
+    sigprocmask(SIG_BLOCK, &mask, &prev);
+    sleep_mask = prev;
+    sigdelset(&sleep_mask, SIGCHLD);
+    sigdelset(&sleep_mask, SIGINT);
+
+    long born = c->born;
+    size_t pos = c->written;
+    interrupted = 0;
+    while (!interrupted) {
+        /* l'anneau a pu être oublié, ou repris par un autre job */
+        c = find(jid);
+        if (!c || c->born != born) break;
+        print_from(c, pos);
+        pos = c->written;
+        fflush(stdout);
+        if (c->fd < 0) break;
+
+        int tfd = timers_fd();
+        fd_set rd;
+        FD_ZERO(&rd);
+        FD_SET(tfd, &rd);
+        if (pselect(tfd + 1, &rd, NULL, NULL, NULL, &sleep_mask) > 0)
+            timers_run();
+    }
+
+    sigprocmask(SIG_SETMASK, &prev, NULL);
+    sigaction(SIGINT, &old, NULL);
+    return 0;
+}
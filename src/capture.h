@@ -0,0 +1,38 @@
+#ifndef __CAPTURE_H__
+#define __CAPTURE_H__
+
+#include <stddef.h>
+
+/* ── Sortie gardée des jobs en arrière-plan (cmd &>>, set capture) ──
+   La sortie et les erreurs du job vont dans un tube que le shell vide
+   quand il dort (c’est un timer pour timers.h) : rien ne s’affiche au
+   milieu de ce qu’on tape. Elles sont gardées en mémoire dans un anneau
+   par job, lisible avec output %n [-f], même après la fin du job.
+
+   La mémoire est bornée : CAPTURE_SIZE octets par job (64k par défaut)
+   et CAPTURE_MAX en tout (1m). Un nombre, suivi ou non de k ou m. Quand
+   une borne est atteinte, les données les plus anciennes sont perdues
+   d’abord : le début de l’anneau du job, ou pour la borne totale celui
+   du plus ancien job qui a encore des données. Les deux variables sont
+   lues au lancement de chaque job. */
+
+#define CAPTURE_SIZE (64 * 1024)
+#define CAPTURE_MAX  (1024 * 1024)
+
+/* Un tube pour la sortie d’un job : *rd est à passer à capture_attach,
+   *wr au job → 0, -1 si erreur */
+int  capture_open(int *rd, int *wr);
+
+/* Le job jid est lancé, il écrit à l’autre bout de rd : le shell le lit
+   désormais (SIGCHLD bloqué) */
+void capture_attach(int jid, int rd);
+
+/* output : une ligne par job dont la sortie est gardée */
+void capture_list(void);
+
+/* output %n [-f] : affiche ce qui est gardé pour le job jid, puis avec
+   follow ce qui arrive jusqu’à la fin du job (ou Ctrl-C)
+   → 0, 1 si rien n’est gardé pour ce job */
+int  capture_print(int jid, int follow);
+
+#endif
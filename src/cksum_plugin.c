@@ -0,0 +1,93 @@
+/*
+ * Exemple de commande chargeable : cksum [fichier...], le CRC POSIX de
+ * cksum(1), avec la même sortie.
+ *
+ *   make cksum_plugin.so
+ *   enable -f ./cksum_plugin.so cksum
+ *
+ * Voir shell_plugin.h pour l'interface.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdint.h>
+#include "shell_plugin.h"
+
+static uint32_t crc_table[256];
+
+static void init_table(void) {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t c = i << 24;
+        for (int k = 0; k < 8; k++)
+            c = (c & 0x80000000) ? (c << 1) ^ 0x04C11DB7 : c << 1;
+        crc_table[i] = c;
+    }
+}
+
+static uint32_t crc_update(uint32_t crc, const unsigned char *p, size_t n) {
+    while (n--) crc = (crc << 8) ^ crc_table[(crc >> 24) ^ *p++];
+    return crc;
+}
+
+/* CRC de fd → 0, -1 si erreur de lecture */
+static int sum_fd(int fd, uint32_t *crc, uint64_t *size) {
+    unsigned char buf[64 * 1024];
+    ssize_t n;
+
+    *crc = 0;
+    *size = 0;
+    while ((n = read(fd, buf, sizeof(buf))) != 0) {
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        *crc = crc_update(*crc, buf, n);
+        *size += n;
+    }
+
+    /* la longueur suit les données, octet de poids faible d'abord */
+    for (uint64_t len = *size; len; len >>= 8) {
+        unsigned char c = len & 0xff;
+        *crc = crc_update(*crc, &c, 1);
+    }
+    *crc = ~*crc;
+    return 0;
+}
+
+int cksum_builtin(int argc, char **argv, int fd_in, int fd_out) {
+    char line[4096];
+    uint32_t crc;
+    uint64_t size;
+    int status = 0;
+
+    if (!crc_table[1]) init_table();
+
+    if (argc < 2) {
+        if (sum_fd(fd_in, &crc, &size) < 0) {
+            dprintf(2, "cksum: -: %s\n", strerror(errno));
+            return 1;
+        }
+        int n = snprintf(line, sizeof(line), "%u %llu\n", crc,
+                         (unsigned long long)size);
+        write(fd_out, line, n);
+        return 0;
+    }
+
+    for (int i = 1; i < argc; i++) {
+        int fd = open(argv[i], O_RDONLY | O_CLOEXEC);
+        if (fd < 0 || sum_fd(fd, &crc, &size) < 0) {
+            dprintf(2, "cksum: %s: %s\n", argv[i], strerror(errno));
+            if (fd >= 0) close(fd);
+            status = 1;
+            continue;
+        }
+        close(fd);
+        int n = snprintf(line, sizeof(line), "%u %llu %s\n", crc,
+                         (unsigned long long)size, argv[i]);
+        write(fd_out, line, n);
+    }
+    return status;
+}
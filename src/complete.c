@@ -0,0 +1,413 @@
+/*
+ * Complétion (voir complete.h).
+ *
+ * Le trie est un tableau de noeuds : les fils d'un noeud sont chaînés
+ * par next, triés, et les noeuds ne sont jamais libérés (un nom enlevé
+ * laisse des noeuds à zéro, ignorés, que le prochain nom pareil
+ * reprendra). Le noeud 0 est la racine des commandes, le noeud 1 celle
+ * des jobs.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include "csapp.h"
+#include "builtins.h"
+#include "exec.h"
+#include "jobs.h"
+#include "vars.h"
+#include "complete.h"
+
+#define ROOT_COMMANDS 0
+#define ROOT_JOBS     1
+
+struct tnode {
+    int           child, next;  /* premier fils, frère suivant */
+    int           words;        /* sources qui donnent le nom qui finit ici */
+    int           below;        /* noms dans le sous-arbre, lui compris */
+    unsigned char c;
+};
+
+static struct tnode *nodes = NULL;
+static int nnodes = 0, nodes_size = 0;
+
+/* les noms d'une source, pour les enlever quand elle change */
+struct source {
+    char           *dir;        /* répertoire de PATH */
+    struct timespec mtime;
+    char          **names;
+    int             n, size;
+};
+
+static struct source fixed;     /* commandes internes et préfixes */
+static struct source jobsrc;
+static struct source *dirs = NULL;
+static int ndirs = 0;
+
+/* commandes reconnues par exec.c avant les commandes internes */
+static const char *prefixes[] = {
+    "after", "every", "memo", "pmap", "timeout",
+    "if", "for", "while",
+};
+
+static int new_node(unsigned char c) {
+    if (nnodes == nodes_size) {
+        nodes_size = nodes_size ? 2 * nodes_size : 1024;
+        nodes = Realloc(nodes, nodes_size * sizeof(struct tnode));
+    }
+    memset(&nodes[nnodes], 0, sizeof(struct tnode));
+    nodes[nnodes].c = c;
+    return nnodes++;
+}
+
+/* le fils c de n (0 s'il n'existe pas et que create est nul) */
+static int child_of(int n, unsigned char c, int create) {
+    int prev = 0, k = nodes[n].child;
+
+    while (k && nodes[k].c < c) {
+        prev = k;
+        k = nodes[k].next;
+    }
+    if (k && nodes[k].c == c) return k;
+    if (!create) return 0;
+
+    int m = new_node(c);        /* nodes a pu bouger */
+    nodes[m].next = k;
+    if (prev) nodes[prev].next = m;
+    else nodes[n].child = m;
+    return m;
+}
+
+/* name compte delta fois de plus sous root. below ne compte que les
+   noms différents : un exécutable dans deux répertoires de PATH est un
+   seul candidat */
+static void trie_add(int root, const char *name, int delta) {
+    int n = root;
+
+    for (const char *p = name; *p; p++)
+        n = child_of(n, (unsigned char)*p, 1);
+
+    int before = nodes[n].words > 0;
+    nodes[n].words += delta;
+    int change = (nodes[n].words > 0) - before;
+    if (change == 0) return;
+
+    n = root;
+    nodes[n].below += change;
+    for (const char *p = name; *p; p++) {
+        n = child_of(n, (unsigned char)*p, 0);
+        nodes[n].below += change;
+    }
+}
+
+/* le noeud de prefix sous root, -1 s'il n'y a aucun nom dessous */
+static int trie_find(int root, const char *prefix) {
+    int n = root;
+
+    for (const char *p = prefix; *p; p++)
+        if (!(n = child_of(n, (unsigned char)*p, 0))) return -1;
+    return nodes[n].below > 0 ? n : -1;
+}
+
+/* les noms sous n (buf en contient le début, len octets) */
+static void trie_collect(int n, char *buf, int len, struct completion *c,
+                         int max) {
+    if (c->nnames >= max) return;
+    if (nodes[n].words > 0) {
+        buf[len] = '\0';
+        c->names[c->nnames++] = strdup(buf);
+    }
+    if (len >= PATH_MAX - 1) return;
+    for (int k = nodes[n].child; k && c->nnames < max; k = nodes[k].next) {
+        if (nodes[k].below == 0) continue;
+        buf[len] = nodes[k].c;
+        trie_collect(k, buf, len + 1, c, max);
+    }
+}
+
+static void source_add(struct source *s, int root, const char *name) {
+    if (s->n == s->size) {
+        s->size = s->size ? 2 * s->size : 64;
+        s->names = Realloc(s->names, s->size * sizeof(char *));
+    }
+    s->names[s->n++] = strdup(name);
+    trie_add(root, name, 1);
+}
+
+static void source_clear(struct source *s, int root) {
+    for (int i = 0; i < s->n; i++) {
+        trie_add(root, s->names[i], -1);
+        free(s->names[i]);
+    }
+    s->n = 0;
+}
+
+static int by_name(const void *a, const void *b) {
+    return strcmp(*(char * const *)a, *(char * const *)b);
+}
+
+/* un exécutable (pas un répertoire) de d */
+static int executable(DIR *d, const char *name, unsigned char type) {
+    if (type == DT_DIR) return 0;
+    if (type != DT_REG) {
+        /* un lien, ou un système de fichiers sans d_type */
+        struct stat st;
+        if (fstatat(dirfd(d), name, &st, 0) < 0 || !S_ISREG(st.st_mode))
+            return 0;
+    }
+    return faccessat(dirfd(d), name, X_OK, 0) == 0;
+}
+
+/* les exécutables du répertoire de s, qui a changé : ses noms (triés)
+   sont comparés à ceux d'avant, seuls les nouveaux sont examinés */
+static void load_dir(struct source *s) {
+    DIR *d = opendir(s->dir);
+    if (!d) {
+        source_clear(s, ROOT_COMMANDS);
+        return;
+    }
+
+    /* les noms du répertoire, le type en tête de chacun */
+    char **seen = NULL;
+    int nseen = 0, size = 0;
+    struct dirent *de;
+    while ((de = readdir(d))) {
+        if (strcmp(de->d_name, ".") == 0 || strcmp(de->d_name, "..") == 0)
+            continue;
+        if (nseen == size) {
+            size = size ? 2 * size : 256;
+            seen = Realloc(seen, size * sizeof(char *));
+        }
+        size_t n = strlen(de->d_name);
+        char *e = Malloc(n + 2);
+        e[0] = de->d_type ? de->d_type : DT_UNKNOWN;
+        memcpy(e + 1, de->d_name, n + 1);
+        seen[nseen++] = e;
+    }
+    for (int i = 0; i < nseen; i++) seen[i]++;
+    qsort(seen, nseen, sizeof(char *), by_name);
+
+    /* fusion des deux listes triées */
+    char **names = Malloc((s->n + nseen + 1) * sizeof(char *));
+    int n = 0, i = 0, j = 0;
+    while (i < s->n || j < nseen) {
+        int cmp = i == s->n ? 1 : j == nseen ? -1
+                : strcmp(s->names[i], seen[j]);
+        if (cmp < 0) {
+            /* disparu */
+            trie_add(ROOT_COMMANDS, s->names[i], -1);
+            free(s->names[i++]);
+        } else if (cmp == 0) {
+            names[n++] = s->names[i++];
+            j++;
+        } else {
+            if (executable(d, seen[j], seen[j][-1])) {
+                names[n++] = strdup(seen[j]);
+                trie_add(ROOT_COMMANDS, seen[j], 1);
+            }
+            j++;
+        }
+    }
+    closedir(d);
+
+    for (int k = 0; k < nseen; k++) free(seen[k] - 1);
+    free(seen);
+    free(s->names);
+    s->names = names;
+    s->n = s->size = n;
+}
+
+static int same_time(struct timespec a, struct timespec b) {
+    return a.tv_sec == b.tv_sec && a.tv_nsec == b.tv_nsec;
+}
+
+/* les répertoires de PATH : ceux qui ont changé sont relus */
+static void refresh_path(void) {
+    const char *path = var_get("PATH");
+    struct source *now = NULL;
+    int nnow = 0;
+
+    char *copy = strdup(path ? path : "");
+    char *p = copy;
+    for (;;) {
+        char *colon = strchr(p, ':');
+        if (colon) *colon = '\0';
+        const char *dir = *p ? p : ".";
+
+        now = Realloc(now, (nnow + 1) * sizeof(struct source));
+        struct source *s = &now[nnow++];
+
+        /* le même qu'avant : on le reprend */
+        int k = 0;
+        while (k < ndirs && (!dirs[k].dir || strcmp(dirs[k].dir, dir) != 0))
+            k++;
+        if (k < ndirs) {
+            *s = dirs[k];
+            dirs[k].dir = NULL;
+        } else {
+            memset(s, 0, sizeof(*s));
+            s->dir = strdup(dir);
+            s->mtime.tv_sec = -1;
+        }
+
+        struct stat st;
+        if (stat(s->dir, &st) < 0) memset(&st, 0, sizeof(st));
+        if (!same_time(st.st_mtim, s->mtime)) {
+            s->mtime = st.st_mtim;
+            load_dir(s);
+        }
+
+        if (!colon) break;
+        p = colon + 1;
+    }
+    free(copy);
+
+    /* ceux qui ne sont plus dans PATH */
+    for (int k = 0; k < ndirs; k++) {
+        if (!dirs[k].dir) continue;
+        source_clear(&dirs[k], ROOT_COMMANDS);
+        free(dirs[k].names);
+        free(dirs[k].dir);
+    }
+    free(dirs);
+    dirs = now;
+    ndirs = nnow;
+}
+
+static void refresh_jobs(void) {
+    char name[16];
+
+    sigset_t prev;
+    block_sigchld(&prev);
+    source_clear(&jobsrc, ROOT_JOBS);
+    for (job_t *j = first_job(); j; j = next_job(j)) {
+        snprintf(name, sizeof(name), "%%%d", j->jid);
+        source_add(&jobsrc, ROOT_JOBS, name);
+    }
+    unblock_sigchld(&prev);
+}
+
+/* le trie et ses sources à jour */
+static void refresh(enum complete_kind kind) {
+    if (nnodes == 0) {
+        new_node(0);            /* ROOT_COMMANDS */
+        new_node(0);            /* ROOT_JOBS */
+        for (int i = 0; builtin_name(i); i++)
+            source_add(&fixed, ROOT_COMMANDS, builtin_name(i));
+        for (size_t i = 0; i < sizeof(prefixes) / sizeof(prefixes[0]); i++)
+            source_add(&fixed, ROOT_COMMANDS, prefixes[i]);
+    }
+    if (kind == COMPLETE_JOB) refresh_jobs();
+    else refresh_path();
+}
+
+/* ce que tous les noms sous n ont en commun après lui */
+static char *trie_common(int n) {
+    char buf[PATH_MAX];
+    int len = 0;
+
+    while (nodes[n].words == 0 && len < PATH_MAX - 1) {
+        int only = 0, live = 0;
+        for (int k = nodes[n].child; k && live < 2; k = nodes[k].next)
+            if (nodes[k].below > 0) {
+                only = k;
+                live++;
+            }
+        if (live != 1) break;
+        n = only;
+        buf[len++] = nodes[n].c;
+    }
+    buf[len] = '\0';
+    return strdup(buf);
+}
+
+/* les fichiers dont le chemin commence par word */
+static void complete_file(const char *word, int max, struct completion *c) {
+    const char *slash = strrchr(word, '/');
+    const char *base = slash ? slash + 1 : word;
+    size_t blen = strlen(base);
+    char dir[PATH_MAX];
+
+    if (!slash) strcpy(dir, ".");
+    else if (slash == word) strcpy(dir, "/");
+    else snprintf(dir, sizeof(dir), "%.*s", (int)(slash - word), word);
+
+    DIR *d = opendir(dir);
+    if (!d) return;
+
+    /* tous les candidats, pour le préfixe commun */
+    char **all = NULL;
+    int nall = 0, size = 0;
+    struct dirent *de;
+    while ((de = readdir(d))) {
+        if (strncmp(de->d_name, base, blen) != 0) continue;
+        if (de->d_name[0] == '.' && base[0] != '.') continue;
+        if (strcmp(de->d_name, ".") == 0 || strcmp(de->d_name, "..") == 0)
+            continue;
+        if (nall == size) {
+            size = size ? 2 * size : 64;
+            all = Realloc(all, size * sizeof(char *));
+        }
+        all[nall++] = strdup(de->d_name);
+    }
+
+    if (nall > 0) {
+        qsort(all, nall, sizeof(char *), by_name);
+        size_t common = strlen(all[0]);
+        for (int i = 1; i < nall; i++) {
+            size_t k = 0;
+            while (k < common && all[i][k] == all[0][k]) k++;
+            common = k;
+        }
+        c->common = strndup(all[0] + blen, common - blen);
+
+        struct stat st;
+        if (nall == 1 && fstatat(dirfd(d), all[0], &st, 0) == 0 &&
+            S_ISDIR(st.st_mode))
+            c->dir = 1;
+    }
+    closedir(d);
+
+    c->n = nall;
+    for (int i = 0; i < nall; i++) {
+        if (c->nnames < max) c->names[c->nnames++] = all[i];
+        else free(all[i]);
+    }
+    free(all);
+}
+
+void complete_word(const char *word, enum complete_kind kind, int max,
+                   struct completion *c) {
+    memset(c, 0, sizeof(*c));
+    c->names = Malloc((max > 0 ? max : 1) * sizeof(char *));
+
+    if (kind == COMPLETE_FILE || strchr(word, '/')) {
+        complete_file(word, max, c);
+        return;
+    }
+
+    refresh(kind);
+    int root = kind == COMPLETE_JOB ? ROOT_JOBS : ROOT_COMMANDS;
+    int n = trie_find(root, word);
+    if (n < 0) return;
+
+    char buf[PATH_MAX];
+    size_t len = strlen(word);
+    if (len >= sizeof(buf)) return;
+    memcpy(buf, word, len);
+
+    c->n = nodes[n].below;
+    c->common = trie_common(n);
+    trie_collect(n, buf, len, c, max);
+}
+
+void completion_free(struct completion *c) {
+    for (int i = 0; i < c->nnames; i++) free(c->names[i]);
+    free(c->names);
+    free(c->common);
+}
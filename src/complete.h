@@ -0,0 +1,42 @@
+#ifndef __COMPLETE_H__
+#define __COMPLETE_H__
+
+/* ── Complétion (Tab dans l’éditeur de ligne, voir lineedit.h) ──
+   Les noms de commandes (commandes internes, préfixes comme timeout ou
+   memo, exécutables des répertoires de PATH) et les numéros de jobs
+   (%1, %2...) sont dans un trie en mémoire, construit à la première
+   complétion. Chaque nom y compte le nombre de sources qui le donnent :
+   à chaque complétion, seules les sources qui ont changé sont relues
+   (un répertoire de PATH dont la date de modification a changé, un
+   répertoire ajouté ou enlevé de PATH, la table des jobs) ; pour un
+   répertoire, seuls les noms apparus sont examinés et ajoutés, et ceux
+   qui ont disparu décomptés. Chaque noeud sait combien de noms il y a
+   sous lui : compter les candidats ne coûte rien, et les parcourir ne
+   visite que des branches qui en ont.
+
+   Les noms de fichiers (un mot qui n’est pas une commande, ou qui
+   contient un '/') sont lus dans leur répertoire à chaque fois. */
+
+enum complete_kind {
+    COMPLETE_COMMAND,   /* premier mot d’une commande */
+    COMPLETE_JOB,       /* %n */
+    COMPLETE_FILE,
+};
+
+struct completion {
+    char  *common;  /* ce que tous les candidats ont après le mot */
+    char **names;   /* les candidats en entier, triés (max au plus) */
+    int    nnames;
+    int    n;       /* nombre de candidats en tout */
+    int    dir;     /* le seul candidat est un répertoire */
+};
+
+/* Les candidats pour compléter word, comme un mot de genre kind, en
+   gardant leurs max premiers noms. c est à libérer avec
+   completion_free() */
+void complete_word(const char *word, enum complete_kind kind, int max,
+                   struct completion *c);
+
+void completion_free(struct completion *c);
+
+#endif
@@ -0,0 +1,120 @@
+/*
+ * Placement des jobs sur les cœurs (voir cpumap.h).
+ *
+ * Les processeurs logiques qui ont le même (physical_package_id,
+ * core_id) forment un cœur physique. Chaque cœur a sa charge : le nombre
+ * de jobs épinglés dessus. Sans sysfs, chaque processeur en ligne est
+ * un cœur.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sched.h>
+#include "cpumap.h"
+
+#define SYS_CPU "/sys/devices/system/cpu"
+
+struct core {
+    int       package, id;
+    int       first;            /* premier processeur logique */
+    cpu_set_t cpus;
+    int       load;
+};
+
+static struct core *cores = NULL;
+static int ncores = -1;         /* -1 : topologie pas encore lue */
+
+/* entier du fichier SYS_CPU/cpu<cpu>/<what>, def si absent */
+static int read_int(int cpu, const char *what, int def) {
+    char path[128];
+    int v = def;
+
+    snprintf(path, sizeof(path), SYS_CPU "/cpu%d/%s", cpu, what);
+    FILE *f = fopen(path, "re");
+    if (!f) return def;
+    if (fscanf(f, "%d", &v) != 1) v = def;
+    fclose(f);
+    return v;
+}
+
+static void add_cpu(int cpu) {
+    int package = read_int(cpu, "topology/physical_package_id", 0);
+    int id = read_int(cpu, "topology/core_id", cpu);
+
+    for (int k = 0; k < ncores; k++) {
+        if (cores[k].package == package && cores[k].id == id) {
+            CPU_SET(cpu, &cores[k].cpus);
+            return;
+        }
+    }
+    cores = realloc(cores, (ncores + 1) * sizeof(struct core));
+    if (!cores) {
+        fprintf(stderr, "cpumap: plus de mémoire\n");
+        exit(1);
+    }
+    memset(&cores[ncores], 0, sizeof(struct core));
+    cores[ncores].package = package;
+    cores[ncores].id = id;
+    cores[ncores].first = cpu;
+    CPU_SET(cpu, &cores[ncores].cpus);
+    ncores++;
+}
+
+static void cpumap_init(void) {
+    cpu_set_t allowed;
+
+    ncores = 0;
+    /* seulement les processeurs où le shell a le droit de tourner (ceux
+       hors ligne n'y sont pas) */
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) < 0) {
+        CPU_ZERO(&allowed);
+        for (long cpu = 0; cpu < sysconf(_SC_NPROCESSORS_ONLN); cpu++)
+            CPU_SET(cpu, &allowed);
+    }
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+        if (CPU_ISSET(cpu, &allowed)) add_cpu(cpu);
+}
+
+int cpumap_assign(int n, int *pin) {
+    if (n <= 0) return 0;
+    if (ncores < 0) cpumap_init();
+    if (n > ncores) n = ncores;
+
+    /* n fois le moins chargé (à égalité, le premier) parmi ceux pas
+       encore pris pour ce job */
+    for (int i = 0; i < n; i++) {
+        int best = -1;
+        for (int k = 0; k < ncores; k++) {
+            int taken = 0;
+            for (int t = 0; t < i; t++)
+                if (pin[t] == cores[k].first) taken = 1;
+            if (!taken && (best < 0 || cores[k].load < cores[best].load))
+                best = k;
+        }
+        cores[best].load++;
+        pin[i] = cores[best].first;
+    }
+    return n;
+}
+
+void cpumap_release(const int *pin, int n) {
+    for (int i = 0; i < n; i++)
+        for (int k = 0; k < ncores; k++)
+            if (cores[k].first == pin[i] && cores[k].load > 0)
+                cores[k].load--;
+}
+
+void cpumap_apply(const int *pin, int n) {
+    cpu_set_t set;
+
+    if (n <= 0) return;
+    CPU_ZERO(&set);
+    for (int i = 0; i < n; i++)
+        for (int k = 0; k < ncores; k++)
+            if (cores[k].first == pin[i]) CPU_OR(&set, &set, &cores[k].cpus);
+    if (sched_setaffinity(0, sizeof(set), &set) < 0)
+        perror("sched_setaffinity");
+}
@@ -0,0 +1,28 @@
+#ifndef __CPUMAP_H__
+#define __CPUMAP_H__
+
+/* ── Placement des jobs sur les cœurs ──
+   cmd &pin, ou tous les jobs en arrière-plan après set autopin : le job
+   reçoit les cœurs physiques les moins chargés (un par étage de pipeline,
+   au plus MAXPIN, voir jobs.h), et ses processus sont attachés à ces
+   cœurs par sched_setaffinity avant l’exec. Un job composé ( ... ),
+   for, if... reçoit autant de cœurs que son plus long pipeline, que ses
+   processus se partagent. Un cœur physique compte avec tous ses
+   processeurs logiques (SMT) : deux jobs épinglés ne se retrouvent pas
+   sur les deux moitiés du même cœur tant qu’il y a des cœurs libres.
+
+   La topologie vient de /sys/devices/system/cpu (lue au premier appel).
+   Un cœur est désigné par le numéro de son premier processeur logique :
+   c’est ce que jobs affiche. */
+
+/* Réserve n cœurs (les moins chargés) → combien, leurs numéros dans pin */
+int  cpumap_assign(int n, int *pin);
+
+/* Rend les cœurs pin[0..n-1] (à la fin du job : aussi depuis le handler
+   SIGCHLD) */
+void cpumap_release(const int *pin, int n);
+
+/* Dans le fils : attache le processus aux cœurs pin[0..n-1] */
+void cpumap_apply(const int *pin, int n);
+
+#endif
@@ -728,8 +728,10 @@ void Sem_init(sem_t *sem, int pshared, unsigned int value)
 
 void P(sem_t *sem) 
 {
-    if (sem_wait(sem) < 0)
-	unix_error("P error");
+    /* sem_wait is never restarted after a signal handler */
+    while (sem_wait(sem) < 0)
+	if (errno != EINTR)
+	    unix_error("P error");
 }
 
 void V(sem_t *sem) 
@@ -994,7 +996,17 @@ int open_clientfd(char *hostname, char *port) {
  *       -1 with errno set for other errors.
  */
 /* $begin open_listenfd */
-int open_listenfd(char *port) 
+int open_listenfd(char *port)
+{
+    return open_host_listenfd(NULL, port);
+}
+/* $end open_listenfd */
+
+/*
+ * open_host_listenfd - Like open_listenfd, but only on the addresses of
+ *     host (any address if host is NULL).
+ */
+int open_host_listenfd(char *host, char *port)
 {
     struct addrinfo hints, *listp, *p;
     int listenfd, rc, optval=1;
@@ -1004,7 +1016,7 @@ int open_listenfd(char *port)
     hints.ai_socktype = SOCK_STREAM;             /* Accept connections */
     hints.ai_flags = AI_PASSIVE | AI_ADDRCONFIG; /* ... on any IP address */
     hints.ai_flags |= AI_NUMERICSERV;            /* ... using port number */
-    if ((rc = getaddrinfo(NULL, port, &hints, &listp)) != 0) {
+    if ((rc = getaddrinfo(host, port, &hints, &listp)) != 0) {
         fprintf(stderr, "getaddrinfo failed (port %s): %s\n", port, gai_strerror(rc));
         return -2;
     }
@@ -1041,7 +1053,79 @@ int open_listenfd(char *port)
     }
     return listenfd;
 }
-/* $end open_listenfd */
+
+/*
+ * open_unix_listenfd - Open and return a listening socket on the Unix
+ *     domain socket path. A stale socket (nobody listening on it) is
+ *     replaced; any other existing file, or a live socket, makes it fail
+ *     with EADDRINUSE. Returns -1 with errno set on error.
+ */
+int open_unix_listenfd(char *path)
+{
+    struct sockaddr_un addr;
+    int listenfd;
+
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+
+    struct stat st;
+    if (lstat(path, &st) == 0) {
+        int stale = 0;
+        if (S_ISSOCK(st.st_mode)) {
+            int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+            if (fd < 0)
+                return -1;
+            stale = connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0
+                    && errno == ECONNREFUSED;
+            close(fd);
+        }
+        if (!stale) {
+            errno = EADDRINUSE;
+            return -1;
+        }
+        unlink(path);
+    }
+
+    if ((listenfd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0)
+        return -1;
+    if (bind(listenfd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+        listen(listenfd, LISTENQ) < 0) {
+        close(listenfd);
+        return -1;
+    }
+    return listenfd;
+}
+
+/*
+ * open_unix_clientfd - Open a connection to the server listening on the
+ *     Unix domain socket path. Returns -1 with errno set on error.
+ */
+int open_unix_clientfd(char *path)
+{
+    struct sockaddr_un addr;
+    int clientfd;
+
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+
+    if ((clientfd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0)
+        return -1;
+    if (connect(clientfd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        close(clientfd);
+        return -1;
+    }
+    return clientfd;
+}
 
 /****************************************************
  * Wrappers for reentrant protocol-independent helpers
@@ -1064,6 +1148,24 @@ int Open_listenfd(char *port)
     return rc;
 }
 
+int Open_unix_clientfd(char *path)
+{
+    int rc;
+
+    if ((rc = open_unix_clientfd(path)) < 0)
+	unix_error("Open_unix_clientfd error");
+    return rc;
+}
+
+int Open_unix_listenfd(char *path)
+{
+    int rc;
+
+    if ((rc = open_unix_listenfd(path)) < 0)
+	unix_error("Open_unix_listenfd error");
+    return rc;
+}
+
 /* $end csapp.c */
 
 
@@ -26,6 +26,7 @@
 #include <semaphore.h>
 #include <sys/socket.h>
 #include <netdb.h>
+#include <sys/un.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 
@@ -189,10 +190,15 @@ ssize_t Rio_readlineb(rio_t *rp, void *usrbuf, size_t maxlen);
 /* Reentrant protocol-independent client/server helpers */
 int open_clientfd(char *hostname, char *port);
 int open_listenfd(char *port);
+int open_host_listenfd(char *host, char *port);
+int open_unix_clientfd(char *path);
+int open_unix_listenfd(char *path);
 
 /* Wrappers for reentrant protocol-independent client/server helpers */
 int Open_clientfd(char *hostname, char *port);
 int Open_listenfd(char *port);
+int Open_unix_clientfd(char *path);
+int Open_unix_listenfd(char *path);
 
 
 #endif /* __CSAPP_H__ */
@@ -0,0 +1,229 @@
+/*
+ * every (voir every.h).
+ *
+ * Le shell lance un sous-shell (launch_function) qui attend les départs
+ * sur son timerfd et exécute la commande à chacun avec run_node, comme
+ * une ligne tapée : elle est expansée à chaque fois ($(date) change).
+ * Pendant qu'elle tourne, les départs s'accumulent dans le timerfd (le
+ * nombre d'échéances lu par read) : sautés ou mis en file après.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <signal.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/select.h>
+#include <sys/timerfd.h>
+#include "csapp.h"
+#include "exec.h"
+#include "timers.h"
+#include "timeout.h"
+#include "every.h"
+
+struct every {
+    struct cmdline cmd;     /* la ligne sans every et ses options */
+    long           interval;
+    int            queue;   /* -q */
+    int            count;   /* -n, 0 : sans fin */
+    struct series *s;
+};
+
+/* signal qui termine la série (Ctrl-C...) */
+static volatile sig_atomic_t ended = 0;
+
+static void on_end(int sig) {
+    ended = sig;
+}
+
+/* départs arrivés depuis la dernière lecture (0 si aucun) */
+static uint64_t ticks(int tfd) {
+    uint64_t n;
+    return read(tfd, &n, sizeof(n)) == sizeof(n) ? n : 0;
+}
+
+static void print_summary(const struct series *s) {
+    printf("every: %d exécution(s), %d départ(s) sauté(s)", s->runs,
+           s->skipped);
+    if (s->runs > 0)
+        printf(", durée min %.3fs moy %.3fs max %.3fs", s->min / 1000.0,
+               s->total / 1000.0 / s->runs, s->max / 1000.0);
+    printf("\n");
+    fflush(stdout);
+}
+
+static int every_body(void *arg) {
+    struct every *e = arg;
+    struct series *s = e->s;
+
+    /* pas de SA_RESTART : l'attente du départ s'arrête */
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_end;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    sigaction(SIGHUP, &sa, NULL);
+
+    int tfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (tfd < 0) {
+        perror("every: timerfd");
+        return 1;
+    }
+    /* le premier départ tout de suite, puis toutes les interval ms */
+    struct itimerspec it;
+    it.it_interval.tv_sec = e->interval / 1000;
+    it.it_interval.tv_nsec = (e->interval % 1000) * 1000000;
+    it.it_value.tv_sec = 0;
+    it.it_value.tv_nsec = 1;
+    timerfd_settime(tfd, 0, &it, NULL);
+
+    struct node n;
+    memset(&n, 0, sizeof(n));
+    n.type = N_CMD;
+    n.cmd = &e->cmd;
+
+    uint64_t pending = 0;       /* départs à faire tout de suite (-q) */
+    while (!ended && (e->count == 0 || s->runs < e->count)) {
+        if (pending == 0) {
+            fd_set rd;
+            FD_ZERO(&rd);
+            FD_SET(tfd, &rd);
+            if (select(tfd + 1, &rd, NULL, NULL, NULL) < 0) continue;
+            uint64_t t = ticks(tfd);
+            if (t == 0) continue;
+            pending = e->queue ? t : 1;
+            if (!e->queue) s->skipped += t - 1;
+        }
+
+        long long t0 = timers_now();
+        int status = run_node(&n, 0);
+        long long d = timers_now() - t0;
+        pending--;
+
+        s->last_status = status;
+        s->last = d;
+        if (s->runs == 0 || d < s->min) s->min = d;
+        if (d > s->max) s->max = d;
+        s->total += d;
+        s->runs++;
+
+        /* les départs arrivés pendant l'exécution */
+        uint64_t t = ticks(tfd);
+        if (e->queue) pending += t;
+        else s->skipped += t;
+    }
+
+    print_summary(s);
+    return ended ? 128 + ended : s->last_status;
+}
+
+int is_every(struct cmdline *raw) {
+    return raw->seq[0] && raw->seq[0][0] &&
+           strcmp(raw->seq[0][0], "every") == 0;
+}
+
+/* premier mot de l'expansion de raw (à libérer, NULL si vide) */
+static char *expand_one(char *raw) {
+    char *words[2] = { raw, NULL };
+    char **tab = NULL;
+    size_t len = 0;
+    char *w = NULL;
+
+    expand_words(words, &tab, &len);
+    for (size_t i = 0; i < len; i++) {
+        if (i == 0) w = tab[i];
+        else free(tab[i]);
+    }
+    free(tab);
+    return w;
+}
+
+static int usage(void) {
+    fprintf(stderr, "usage: every DURÉE [-q] [-n N] cmd\n");
+    return -1;
+}
+
+int launch_every(struct cmdline *raw, job_state state) {
+    struct every e;
+    char **argv = raw->seq[0];
+    int i = 1;
+
+    memset(&e, 0, sizeof(e));
+    e.interval = -1;
+
+    /* les options avant ou après la durée */
+    for (; argv[i]; i++) {
+        if (strcmp(argv[i], "-q") == 0) {
+            e.queue = 1;
+        } else if (strcmp(argv[i], "-n") == 0 && argv[i + 1]) {
+            char *n = expand_one(argv[++i]);
+            e.count = n ? atoi(n) : 0;
+            free(n);
+            if (e.count <= 0) return usage();
+        } else if (e.interval < 0) {
+            char *d = expand_one(argv[i]);
+            e.interval = d ? parse_duration(d) : -1;
+            free(d);
+            if (e.interval <= 0) return usage();
+        } else {
+            break;
+        }
+    }
+    if (e.interval <= 0 || !argv[i]) return usage();
+
+    /* la commande : la même ligne à partir du mot i, au premier plan du
+       sous-shell */
+    int nseq = 0;
+    while (raw->seq[nseq]) nseq++;
+    char ***seq = Malloc((nseq + 1) * sizeof(char **));
+    memcpy(seq, raw->seq, (nseq + 1) * sizeof(char **));
+    seq[0] = argv + i;
+    e.cmd = *raw;
+    e.cmd.seq = seq;
+    e.cmd.background = e.cmd.pin = e.cmd.prio = e.cmd.capture = 0;
+
+    e.s = mmap(NULL, sizeof(struct series), PROT_READ | PROT_WRITE,
+               MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (e.s == MAP_FAILED) {
+        perror("every: mmap");
+        free(seq);
+        return -1;
+    }
+    memset(e.s, 0, sizeof(struct series));
+    e.s->interval = e.interval;
+
+    char cmd_str[MAXCMD] = "";
+    for (int k = 0; argv[k] && (int)strlen(cmd_str) < MAXCMD - 2; k++) {
+        if (k > 0) strncat(cmd_str, " ", MAXCMD - strlen(cmd_str) - 1);
+        strncat(cmd_str, argv[k], MAXCMD - strlen(cmd_str) - 1);
+    }
+
+    /* SIGCHLD bloqué : le job ne peut pas finir avant d'avoir sa page */
+    sigset_t prev;
+    block_sigchld(&prev);
+    int jid = launch_function(cmd_str, -1, state, every_body, &e);
+    if (jid > 0) get_job_by_jid(jid)->series = e.s;
+    else series_release(e.s);
+    unblock_sigchld(&prev);
+
+    free(seq);
+    return jid;
+}
+
+void series_format(const struct series *s, char *buf, int buflen) {
+    int n = snprintf(buf, buflen, "every:%gs runs:%d", s->interval / 1000.0,
+                     s->runs);
+    if (s->runs > 0 && n < buflen)
+        n += snprintf(buf + n, buflen - n, " avg:%.2fs max:%.2fs",
+                      s->total / 1000.0 / s->runs, s->max / 1000.0);
+    if (s->skipped > 0 && n < buflen)
+        snprintf(buf + n, buflen - n, " skipped:%d", s->skipped);
+}
+
+void series_release(struct series *s) {
+    if (s) munmap(s, sizeof(struct series));
+}
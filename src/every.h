@@ -0,0 +1,44 @@
+#ifndef __EVERY_H__
+#define __EVERY_H__
+
+#include "readcmd.h"
+#include "jobs.h"
+
+/* ── every DURÉE [-q] [-n N] cmd ──
+   Lance cmd tout de suite, puis toutes les DURÉE (voir parse_duration,
+   timeout.h), N fois au plus (-n). Les départs sont ceux d’un timerfd
+   périodique : ils ne dérivent pas, quelle que soit la durée de cmd.
+
+   Deux exécutions ne se recouvrent jamais. Si cmd dure plus que
+   l’intervalle, les départs manqués sont sautés (on attend le suivant),
+   ou avec -q mis en file : ils partent dès que cmd a fini, l’un après
+   l’autre.
+
+   La série est un seul job (un sous-shell qui lance cmd et l’attend) :
+   stop / bg / fg / Ctrl-C s’appliquent à l’ensemble. Ses statistiques
+   sont dans une page partagée avec le shell : jobs les montre, et la
+   série les affiche quand elle se termine. */
+
+/* Statistiques d’une série (partagées entre le shell et le sous-shell) */
+struct series {
+    long      interval;     /* en ms */
+    int       runs;         /* exécutions terminées */
+    int       skipped;      /* départs sautés */
+    int       last_status;
+    long long last, min, max, total;    /* durées, en ms */
+};
+
+/* Vrai si la ligne brute raw est un appel à every */
+int  is_every(struct cmdline *raw);
+
+/* Lance la série de la ligne brute raw comme un job d’état state, sans
+   attendre → jid, -1 si échec */
+int  launch_every(struct cmdline *raw, job_state state);
+
+/* "every:5s runs:12 avg:0.31s max:0.90s skipped:1" dans buf */
+void series_format(const struct series *s, char *buf, int buflen);
+
+/* À la fin du job : rend la page partagée */
+void series_release(struct series *s);
+
+#endif
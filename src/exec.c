@@ -0,0 +1,925 @@
+/*
+ * Exécution des lignes de commande : lancement des pipelines, attente du
+ * premier plan, et interprétation de l’arbre construit par ast.c
+ * (listes, && / ||, groupes, sous-shells, if / while / for).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <errno.h>
+#include <signal.h>
+#include <sys/select.h>
+#include "csapp.h"
+#include "exec.h"
+#include "builtins.h"
+#include "pmap.h"
+#include "vars.h"
+#include "zygote.h"
+#include "remote.h"
+#include "cpumap.h"
+#include "prio.h"
+#include "gang.h"
+#include "timers.h"
+#include "timeout.h"
+#include "every.h"
+#include "after.h"
+#include "waitjob.h"
+#include "capture.h"
+#include "memo.h"
+
+int exec_debug = 0;
+int exec_interactive = 0;
+int exec_autopin = 0;
+int exec_autolow = 0;
+int exec_capture = 0;
+int last_status = 0;
+void (*exec_job_done)(job_t *j, int code) = NULL;
+
+/* code de retour du dernier job de premier plan, rempli par le handler */
+static volatile sig_atomic_t fg_status = 0;
+
+/* groupe de processus du sous-shell courant (0 dans le shell principal) :
+   les commandes lancées par un sous-shell restent dans son groupe, pour
+   que stop / fg / Ctrl-C les touchent avec lui */
+static pid_t exec_pgid = 0;
+
+/* on bloque SIGCHLD pour éviter que jobs[] soit modifié en même temps */
+void block_sigchld(sigset_t *prev) {
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGCHLD);
+    sigprocmask(SIG_BLOCK, &mask, prev);
+}
+
+/* on remet le masque comme avant */
+void unblock_sigchld(sigset_t *prev) {
+    sigprocmask(SIG_SETMASK, prev, NULL);
+}
+
+/* status waitpid → code de retour à la sh (128 + signal si tué) */
+static int status_code(int status) {
+    if (WIFEXITED(status))   return WEXITSTATUS(status);
+    if (WIFSIGNALED(status)) return 128 + WTERMSIG(status);
+    return 0;
+}
+
+int job_code(const job_t *j) {
+    return j->timed_out ? TIMEOUT_STATUS : status_code(j->status);
+}
+
+/* handler appelé quand un fils change d'état */
+void sigchld_handler(int signum) {
+    (void)signum;
+    int status;
+    pid_t pid;
+
+    /* on récupère tous les fils terminés ou stoppés */
+    while ((pid = waitpid(-1, &status, WNOHANG | WUNTRACED)) > 0) {
+        job_t *j = get_job_by_pid(pid);
+        if (!j) continue;
+
+        if (WIFSTOPPED(status)) {
+            /* dans un sous-shell, tout le groupe (nous compris) est stoppé
+               et repartira ensemble : on continue d'attendre le job */
+            if (exec_pgid) continue;
+
+            /* tout le groupe reçoit le signal : on n'affiche qu'une fois.
+               un job Paused a été suspendu par gang : rien à dire */
+            if (j->state == STOPPED || j->state == PAUSED) continue;
+            if (j->state == FG) fg_status = 128 + WSTOPSIG(status);
+            j->state = STOPPED;
+            if (exec_interactive) {
+                printf("\n[%d] %d Stopped %s\n", j->jid, (int)j->pid, j->cmd);
+                printf("shell> ");
+                fflush(stdout);
+            }
+
+        } else if (WIFEXITED(status) || WIFSIGNALED(status)) {
+            if (pid == j->last) j->status = status;
+
+            /* le job n'est fini que quand tous ses processus le sont */
+            if (job_proc_exited(j, pid) > 0) continue;
+
+            /* les jobs qui l'attendent (after) */
+            if (j->dependents.jid) after_job_done(j, job_code(j));
+
+            if (j->state == FG) {
+                fg_status = job_code(j);
+            } else if (j->waited) {
+                /* wait l'attend : il garde son status, c'est wait qui le
+                   retirera (voir waitjob.h) */
+                j->state = DONE;
+                cpumap_release(j->pin, j->npin);
+                j->npin = 0;
+                continue;
+            } else if (!exec_pgid && exec_job_done) {
+                exec_job_done(j, job_code(j));
+            } else if ((j->state == RUNNING || j->state == PAUSED) &&
+                       exec_interactive) {
+                /* si c'était un bg on affiche Done */
+                printf("\n[%d] %d Done %s\n", j->jid, (int)j->pid, j->cmd);
+                printf("shell> ");
+                fflush(stdout);
+            }
+            cpumap_release(j->pin, j->npin);
+            delete_job_by_jid(j->jid);
+        }
+    }
+}
+
+/* dans le fils on remet les signaux normaux */
+void reset_signals_in_child(void) {
+    sigset_t empty;
+    sigemptyset(&empty);
+    sigprocmask(SIG_SETMASK, &empty, NULL);
+
+    signal(SIGCHLD, SIG_DFL);
+    signal(SIGINT,  SIG_DFL);
+    signal(SIGTSTP, SIG_DFL);
+    signal(SIGQUIT, SIG_DFL);
+    signal(SIGTERM, SIG_DFL);
+}
+
+/* set autolow : on baisse (on = 1) ou on remet (on = 0) les jobs
+   normal en arrière-plan (SIGCHLD bloqué) */
+static void dim_background(int on) {
+    static pid_t *pgids = NULL;
+    static int size = 0;
+    int n = 0;
+
+    for (job_t *j = first_job(); j; j = next_job(j)) {
+        if (j->cls != CLASS_NORMAL || j->host[0]) continue;
+        if (on ? j->state != RUNNING || j->dimmed : !j->dimmed) continue;
+
+        if (n == size) {
+            size = size ? 2 * size : 16;
+            pgids = Realloc(pgids, size * sizeof(pid_t));
+        }
+        pgids[n++] = j->pgid;
+        j->dimmed = on;
+    }
+    prio_dim_pgrps(pgids, n, on);
+}
+
+/* on attend qu'il n'y ait plus de job en foreground.
+   SIGCHLD est bloqué pendant le test, sigsuspend le débloque le temps
+   de dormir : pas de signal perdu entre le test et l'attente. s'il y a
+   des timers (gang, timeout...), pselect fait pareil en les surveillant
+   aussi */
+int wait_fg_job(void) {
+    sigset_t prev;
+    block_sigchld(&prev);
+
+    int dim = exec_autolow && !exec_pgid;
+    if (dim) dim_background(1);
+
+    while (get_fg_job() != NULL) {
+        int tfd = timers_fd();
+        if (tfd < 0) {
+            sigsuspend(&prev);
+            continue;
+        }
+        fd_set rd;
+        FD_ZERO(&rd);
+        FD_SET(tfd, &rd);
+        if (pselect(tfd + 1, &rd, NULL, NULL, NULL, &prev) > 0)
+            timers_run();
+    }
+    int st = fg_status;
+
+    if (dim) dim_background(0);
+    unblock_sigchld(&prev);
+    return st;
+}
+
+int shell_has_duties(void) {
+    return timeout_pending() || after_pending();
+}
+
+void wait_shell_duties(void) {
+    sigset_t prev;
+    block_sigchld(&prev);
+
+    /* chaque fin de job (SIGCHLD) ou échéance réveille pselect */
+    while (shell_has_duties()) {
+        int tfd = timers_fd();
+        if (tfd < 0) break;
+        fd_set rd;
+        FD_ZERO(&rd);
+        FD_SET(tfd, &rd);
+        if (pselect(tfd + 1, &rd, NULL, NULL, NULL, &prev) > 0)
+            timers_run();
+    }
+
+    unblock_sigchld(&prev);
+}
+
+void shell_exit(int status) {
+    fflush(stdout);
+    if (exec_pgid) _exit(status & 0xff);
+    wait_shell_duties();
+    gang_stop();            // personne ne doit rester suspendu
+    exit(status & 0xff);
+}
+
+/* on reconstruit la commande en string pour l'affichage jobs */
+static void build_cmd_str(struct cmdline *l, char *buf, int buflen) {
+    buf[0] = '\0';
+
+    for (int i = 0; l->seq[i] != NULL; i++) {
+        for (int j = 0; l->seq[i][j] != NULL; j++) {
+            if ((int)strlen(buf) >= buflen - 3) return;  // buffer plein
+            strncat(buf, l->seq[i][j], buflen - strlen(buf) - 2);
+            strncat(buf, " ", buflen - strlen(buf) - 1);
+        }
+
+        if (l->seq[i+1] != NULL)
+            strncat(buf, "| ", buflen - strlen(buf) - 1);
+    }
+}
+
+/* où et comment tourne un job : ses cœurs (&pin, voir cpumap.h), sa
+   classe de priorité (&low, voir prio.h) et où va sa sortie (&>>, voir
+   capture.h) */
+struct placement {
+    int       pin[MAXPIN];
+    int       npin;
+    job_class cls;
+    int       out;      /* tube où écrivent stdout et stderr, -1 sinon */
+    int       out_rd;   /* son autre bout, lu par le shell */
+};
+
+static const struct placement anywhere = {
+    .npin = 0, .cls = CLASS_NORMAL, .out = -1, .out_rd = -1
+};
+
+/* placement d'un job de stages étages, lancé avec l'état state. les
+   cœurs sont réservés ici : avec &pin, ou pour un job en arrière-plan du
+   shell après set autopin. pareil pour le tube de &>> et set capture */
+static void place_job(struct placement *pl, int pin, int prio, int capture,
+                      job_state state, int stages) {
+    int want = 0;
+
+    if (pin || (exec_autopin && state == RUNNING && !exec_pgid))
+        want = stages < MAXPIN ? stages : MAXPIN;
+    pl->npin = cpumap_assign(want, pl->pin);
+    pl->cls = prio;
+
+    pl->out = pl->out_rd = -1;
+    if ((capture || (exec_capture && state == RUNNING && !exec_pgid)) &&
+        capture_open(&pl->out_rd, &pl->out) < 0)
+        perror("capture");
+}
+
+/* le job n'a pas pu être lancé : on rend ce que place_job a pris */
+static void unplace_job(const struct placement *pl) {
+    cpumap_release(pl->pin, pl->npin);
+    if (pl->out >= 0) {
+        close(pl->out);
+        close(pl->out_rd);
+    }
+}
+
+/* dans le fils, avant exec. les redirections de l'étage (pipe, '>')
+   passent ensuite devant la sortie gardée */
+static void place_self(const struct placement *pl) {
+    cpumap_apply(pl->pin, pl->npin);
+    prio_apply_self(pl->cls);
+    if (pl->out >= 0) {
+        dup2(pl->out, STDOUT_FILENO);
+        dup2(pl->out, STDERR_FILENO);
+    }
+}
+
+/* redirige fd vers le fichier path (dans le fils), exit si impossible */
+static void redirect_or_die(const char *path, int flags, int fd) {
+    int f = open(path, flags, 0644);
+    if (f < 0) {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        _exit(1);
+    }
+    dup2(f, fd);
+    close(f);
+}
+
+/* l'étage i du pipeline lancé par le zygote, avec les mêmes entrée et
+   sortie que dans spawn_pipeline(). les fichiers de < et > sont ouverts
+   ici : en cas d'erreur, on laisse le fork normal la signaler.
+   → pid, -1 pour passer par fork */
+static pid_t spawn_with_zygote(struct cmdline *l, int i, int nb_cmd,
+                               int fd_in, int fd_out, int prev_read,
+                               int pipe_out, pid_t pgid) {
+    int fd[3] = { STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO };
+    int in = -1, out = -1;
+
+    if (i > 0) fd[0] = prev_read;
+    else if (l->in) {
+        if ((in = fd[0] = open(l->in, O_RDONLY | O_CLOEXEC)) < 0) return -1;
+    } else if (fd_in >= 0) fd[0] = fd_in;
+
+    if (i < nb_cmd-1) fd[1] = pipe_out;
+    else if (l->out) {
+        out = fd[1] = open(l->out, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (out < 0) {
+            if (in >= 0) close(in);
+            return -1;
+        }
+    } else if (fd_out >= 0) fd[1] = fd_out;
+
+    pid_t pid = zygote_spawn(l->seq[i], vars_envp(),
+                             i < l->nassign ? l->assign[i] : NULL, fd, pgid);
+    if (in >= 0) close(in);
+    if (out >= 0) close(out);
+    return pid;
+}
+
+/* fork + exec de chaque commande du pipeline l dans le groupe *pgid
+   (0 : le premier fils crée le groupe et *pgid est mis à jour).
+   si fd_in / fd_out >= 0, ils remplacent l'entrée du premier / la sortie
+   du dernier processus quand il n'y a pas de '<' / '>'.
+   les pids des fils sont ajoutés dans pids[] (*n processus au total).
+   les fils sont placés selon pl.
+   retourne le pid du dernier étage (0 s'il n'a pas été lancé) */
+static pid_t spawn_pipeline(struct cmdline *l, int fd_in, int fd_out,
+                            pid_t *pgid, pid_t *pids, int *n,
+                            const struct placement *pl) {
+    int nb_cmd = 0;
+    pid_t last = 0;
+    while (l->seq[nb_cmd] != NULL) nb_cmd++;
+
+    /* <(...) et >(...) : un pipe par substitution. le bout côté commande
+       est passé en argument sous la forme /dev/fd/N, l'autre bout va au
+       processus de la substitution. tout est O_CLOEXEC : seul l'étage qui
+       utilise le /dev/fd/N le garde ouvert après exec */
+    int cmd_fd[l->nprocsub + 1], sub_fd[l->nprocsub + 1];
+    int nb_sub = 0;
+
+    for (int k = 0; k < l->nprocsub; k++) {
+        struct procsub *ps = &l->procsub[k];
+        int p[2];
+
+        if (pipe(p) < 0) {
+            fprintf(stderr, "pipe failed\n");
+            break;
+        }
+        fcntl(p[0], F_SETFD, FD_CLOEXEC);
+        fcntl(p[1], F_SETFD, FD_CLOEXEC);
+        cmd_fd[k] = ps->output ? p[1] : p[0];
+        sub_fd[k] = ps->output ? p[0] : p[1];
+        nb_sub++;
+
+        char path[32];
+        snprintf(path, sizeof(path), "/dev/fd/%d", cmd_fd[k]);
+        free(l->seq[ps->stage][ps->arg]);
+        l->seq[ps->stage][ps->arg] = strdup(path);
+    }
+
+    int prev_read = -1;     /* sortie du pipe précédent */
+
+    for (int i = 0; i < nb_cmd; i++) {
+        int pipefd[2] = { -1, -1 };
+
+        if (*n >= MAXPROCS) {
+            fprintf(stderr, "trop de processus dans le job\n");
+            break;
+        }
+
+        if (i < nb_cmd-1 && pipe(pipefd) < 0) {
+            fprintf(stderr, "pipe failed\n");
+            break;
+        }
+
+        /* par le zygote si possible (pas de <(...), pas de commande
+           chargée, pas de placement : le fils fait plus qu'un exec) */
+        pid_t pid = -1;
+        int by_zygote = 0;
+        if (nb_sub == 0 && pl->npin == 0 && pl->cls == CLASS_NORMAL &&
+            pl->out < 0 && zygote_enabled() &&
+            !find_loaded_builtin(l->seq[i][0])) {
+            pid = spawn_with_zygote(l, i, nb_cmd, fd_in, fd_out,
+                                    prev_read, pipefd[1], *pgid);
+            by_zygote = pid > 0;
+        }
+        if (!by_zygote) pid = fork();
+
+        if (pid < 0) {
+            fprintf(stderr, "fork: failed\n");
+            if (pipefd[0] >= 0) { close(pipefd[0]); close(pipefd[1]); }
+            break;
+        }
+
+        if (pid == 0) {
+            reset_signals_in_child();
+            setpgid(0, *pgid);
+            place_self(pl);
+
+            /* entrée : le fichier pour le premier, le pipe sinon */
+            if (i == 0) {
+                if (l->in) redirect_or_die(l->in, O_RDONLY, STDIN_FILENO);
+                else if (fd_in >= 0) dup2(fd_in, STDIN_FILENO);
+            } else {
+                dup2(prev_read, STDIN_FILENO);
+                close(prev_read);
+            }
+
+            /* sortie : le pipe suivant, ou le fichier pour le dernier */
+            if (i < nb_cmd-1) {
+                dup2(pipefd[1], STDOUT_FILENO);
+                close(pipefd[0]);
+                close(pipefd[1]);
+            } else if (l->out) {
+                redirect_or_die(l->out, O_WRONLY | O_CREAT | O_TRUNC,
+                                STDOUT_FILENO);
+            } else if (fd_out >= 0) {
+                dup2(fd_out, STDOUT_FILENO);
+            }
+
+            /* les /dev/fd/N de cet étage doivent survivre à l'exec */
+            for (int k = 0; k < nb_sub; k++)
+                if (l->procsub[k].stage == i)
+                    fcntl(cmd_fd[k], F_SETFD, 0);
+
+            /* NAME=valeur devant la commande : seulement pour elle */
+            if (i < l->nassign && l->assign[i]) vars_overlay(l->assign[i]);
+
+            /* commande chargée par enable -f : pas d'exec */
+            shell_builtin_fn run = find_loaded_builtin(l->seq[i][0]);
+            if (run) {
+                int argc = 0;
+                while (l->seq[i][argc]) argc++;
+                _exit(run(argc, l->seq[i], STDIN_FILENO, STDOUT_FILENO) & 0xff);
+            }
+
+            execvp(l->seq[i][0], l->seq[i]);
+
+            /* _exit : exit() remettrait l'offset de stdin (partagé avec
+               le shell) au début de ce qu'il a déjà lu */
+            fprintf(stderr, "%s: command not found\n", l->seq[i][0]);
+            _exit(127);
+        }
+
+        if (*pgid == 0) *pgid = pid;
+        setpgid(pid, *pgid);
+        pids[(*n)++] = pid;
+        if (i == nb_cmd-1) last = pid;
+
+        /* le père ne garde aucun bout de pipe */
+        if (prev_read >= 0) close(prev_read);
+        if (pipefd[1] >= 0) close(pipefd[1]);
+        prev_read = pipefd[0];
+    }
+    if (prev_read >= 0) close(prev_read);
+
+    /* les substitutions sont lancées dans le même groupe : stop, fg et
+       la fin du job les concernent aussi */
+    for (int k = 0; k < nb_sub; k++) {
+        struct procsub *ps = &l->procsub[k];
+
+        if (*pgid != 0) {
+            if (ps->output)
+                spawn_pipeline(ps->cmd, sub_fd[k], -1, pgid, pids, n, pl);
+            else
+                spawn_pipeline(ps->cmd, -1, sub_fd[k], pgid, pids, n, pl);
+        }
+        close(sub_fd[k]);
+        close(cmd_fd[k]);
+    }
+    return last;
+}
+
+/* enregistre un job de n processus, placé selon pl (SIGCHLD bloqué).
+   s'il n'a pas pu être enregistré, ses cœurs sont rendus. sa sortie
+   gardée est désormais lue par le shell */
+static int register_job(pid_t *pids, int n, pid_t pgid, pid_t last,
+                        job_state state, const char *cmd_str,
+                        const struct placement *pl) {
+    int jid = -1;
+
+    if (n > 0) jid = add_job(pids[0], pgid, state, cmd_str);
+    if (jid < 0) {
+        unplace_job(pl);
+        return -1;
+    }
+    if (pl->out >= 0) {
+        close(pl->out);
+        capture_attach(jid, pl->out_rd);
+    }
+    for (int k = 1; k < n; k++)
+        add_job_proc(jid, pids[k]);
+
+    job_t *j = get_job_by_jid(jid);
+    j->last = last;
+    j->npin = pl->npin;
+    memcpy(j->pin, pl->pin, pl->npin * sizeof(int));
+    j->cls = pl->cls;
+    if (state == FG) fg_status = 0;
+    if (state == RUNNING && !exec_pgid) gang_balance();
+    return jid;
+}
+
+/* lance la ligne l (une commande ou un pipeline) dans un nouveau groupe
+   de processus et l'ajoute dans jobs[] avec l'état state.
+   si fd_out >= 0 et qu'il n'y a pas de '>', la sortie du dernier
+   processus part dans fd_out (utilisé pour les substitutions $(...)).
+   on n'attend pas la fin : retourne le jid, ou -1 si échec */
+int launch_cmdline(struct cmdline *l, int fd_out, job_state state) {
+    if (l->seq[0] == NULL) return -1;
+
+    char cmd_str[MAXCMD];
+    build_cmd_str(l, cmd_str, MAXCMD);
+
+    fflush(stdout);        // sinon le fils hérite du buffer de printf
+    vars_envp();           // refait ici une fois, pas dans chaque fils
+
+    sigset_t prev;
+    block_sigchld(&prev);  // important avant fork
+
+    pid_t pgid = exec_pgid;
+    pid_t pids[MAXPROCS];
+    int n = 0, stages = 0;
+    struct placement pl;
+
+    while (l->seq[stages]) stages++;
+    place_job(&pl, l->pin, l->prio, l->capture, state, stages);
+
+    pid_t last = spawn_pipeline(l, -1, fd_out, &pgid, pids, &n, &pl);
+    int jid = register_job(pids, n, pgid, last, state, cmd_str, &pl);
+
+    unblock_sigchld(&prev);
+    return jid;
+}
+
+/* launch_function(), le sous-shell placé selon pl */
+static int launch_function_placed(const char *cmd_str, int fd_out,
+                                  job_state state, int (*body)(void *arg),
+                                  void *arg, const struct placement *pl) {
+    fflush(stdout);
+
+    sigset_t prev;
+    block_sigchld(&prev);
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        fprintf(stderr, "fork: failed\n");
+        unplace_job(pl);
+        unblock_sigchld(&prev);
+        return -1;
+    }
+
+    if (pid == 0) {
+        /* le fils : ses jobs ne sont pas ceux du shell */
+        setpgid(0, exec_pgid);
+        exec_pgid = getpgrp();
+        init_jobs();
+        zygote_forget();
+        timers_forget();
+        exec_debug = 0;
+        exec_interactive = 0;
+        signal(SIGINT,  SIG_DFL);
+        signal(SIGTSTP, SIG_DFL);
+        place_self(pl);
+        /* le père a pu bloquer SIGCHLD pour de bon (--serve) : le fils en
+           a besoin pour attendre ses commandes */
+        sigdelset(&prev, SIGCHLD);
+        unblock_sigchld(&prev);
+
+        if (fd_out >= 0) {
+            dup2(fd_out, STDOUT_FILENO);
+            close(fd_out);
+        }
+        int status = body(arg);
+        fflush(stdout);
+        _exit(status & 0xff);
+    }
+
+    pid_t pgid = exec_pgid ? exec_pgid : pid;
+    setpgid(pid, pgid);
+    int jid = register_job(&pid, 1, pgid, pid, state, cmd_str, pl);
+
+    unblock_sigchld(&prev);
+    return jid;
+}
+
+/* lance body(arg) dans un fils du shell (un sous-shell), qui sort avec
+   le code retourné. même contrat que launch_cmdline() */
+int launch_function(const char *cmd_str, int fd_out, job_state state,
+                    int (*body)(void *arg), void *arg) {
+    return launch_function_placed(cmd_str, fd_out, state, body, arg, &anywhere);
+}
+
+/* corps du sous-shell : le noeud, en dernière position */
+static int subshell_body(void *arg) {
+    struct node *n = arg;
+
+    n->background = 0;      /* c'est une copie : le père n'est pas touché */
+    if (n->type == N_SUBSHELL) n = n->a;
+    return run_node(n, 1);
+}
+
+/* étages du plus long pipeline de n : les commandes d'un noeud
+   composé passent l'une après l'autre, c'est ce qui tourne à la fois */
+static int node_stages(const struct node *n) {
+    if (!n) return 0;
+    if (n->type == N_CMD) {
+        int k = 0;
+        while (n->cmd && n->cmd->seq[k]) k++;
+        return k;
+    }
+    int a = node_stages(n->a), b = node_stages(n->b), c = node_stages(n->c);
+    if (b > a) a = b;
+    return c > a ? c : a;
+}
+
+/* lance le noeud n dans un sous-shell (placé selon ses &pin, &low...) */
+int launch_node(struct node *n, int fd_out, job_state state) {
+    char cmd_str[MAXCMD];
+    struct placement pl;
+    int stages = node_stages(n);
+    ast_format(n, cmd_str, MAXCMD);
+
+    place_job(&pl, n->pin, n->prio, n->capture, state,
+              stages > 0 ? stages : 1);
+    return launch_function_placed(cmd_str, fd_out, state, subshell_body, n,
+                                  &pl);
+}
+
+
+/* ── interprétation de l’arbre ── */
+
+static const char *shell_lookup(const char *name) {
+    static char buf[16];
+
+    if (strcmp(name, "?") == 0) {
+        snprintf(buf, sizeof(buf), "%d", last_status);
+        return buf;
+    }
+    if (strcmp(name, "$") == 0) {
+        snprintf(buf, sizeof(buf), "%d", (int)getpid());
+        return buf;
+    }
+    return var_get(name);
+}
+
+/* affichage de debug de la ligne expansée (comme avant l'arbre) */
+static void print_cmdline(struct cmdline *l) {
+    if (l->in)  printf("in: %s\n", l->in);
+    if (l->out) printf("out: %s\n", l->out);
+
+    for (int i = 0; l->seq[i] != 0; i++) {
+        printf("seq[%d]: ", i);
+        if (i < l->nassign && l->assign[i])
+            for (int j = 0; l->assign[i][j] != 0; j++)
+                printf("%s ", l->assign[i][j]);
+        for (int j = 0; l->seq[i][j] != 0; j++) printf("%s ", l->seq[i][j]);
+        printf("\n");
+    }
+}
+
+/* la dernière commande d'un script, d'un -c ou d'un sous-shell : plus
+   rien ne sera exécuté après elle, elle peut remplacer le shell au lieu
+   d'être lancée dans un fils qu'on attendrait avant de sortir.
+   seulement pour une commande externe seule (pas de pipe, pas de '&',
+   pas de <(...)), et si le shell n'a plus rien à faire pour les jobs
+   en arrière-plan */
+static int can_exec_in_place(struct cmdline *l) {
+    return !l->background && l->seq[1] == NULL && l->nprocsub == 0 &&
+           !shell_has_duties();
+}
+
+/* exec sans fork : on fait ce que ferait le fils de spawn_pipeline() */
+void exec_in_place(struct cmdline *l) {
+    fflush(stdout);
+    reset_signals_in_child();
+
+    if (l->in)  redirect_or_die(l->in, O_RDONLY, STDIN_FILENO);
+    if (l->out) redirect_or_die(l->out, O_WRONLY | O_CREAT | O_TRUNC,
+                                STDOUT_FILENO);
+
+    if (l->nassign && l->assign[0]) vars_overlay(l->assign[0]);
+    else vars_envp();
+
+    execvp(l->seq[0][0], l->seq[0]);
+
+    fprintf(stderr, "%s: command not found\n", l->seq[0][0]);
+    _exit(127);
+}
+
+/* "[jid] pid" d'un job qu'on vient de lancer en arrière-plan. il a pu
+   déjà finir (et être retiré par le handler) : plus de pid à montrer */
+static void print_launched(int jid) {
+    sigset_t prev;
+    block_sigchld(&prev);
+
+    job_t *j = get_job_by_jid(jid);
+    if (j) printf("[%d] %d\n", jid, (int)j->pid);
+    else printf("[%d]\n", jid);
+
+    unblock_sigchld(&prev);
+}
+
+/* après le lancement du job jid : on l'attend, ou on affiche son numéro
+   s'il est en arrière-plan → code de retour */
+static int finish_launch(int jid, int background) {
+    if (jid < 0) return 1;
+    if (!background) return wait_fg_job();
+
+    if (exec_interactive) print_launched(jid);
+    return 0;
+}
+
+/* une feuille : expansion, builtin ou pipeline */
+static int run_cmd(struct cmdline *raw, int tail) {
+    /* pmap développe sa liste de mots lui-même, au fur et à mesure */
+    if (is_pmap(raw))
+        return finish_launch(launch_pmap(raw, raw->background ? RUNNING : FG),
+                             raw->background);
+    /* every aussi : la commande est expansée à chaque exécution */
+    if (is_every(raw))
+        return finish_launch(launch_every(raw, raw->background ? RUNNING : FG),
+                             raw->background);
+
+    /* after garde la ligne telle quelle : elle est expansée au départ */
+    if (is_after(raw)) {
+        int jid = launch_after(raw);
+        if (jid < 0) return 1;
+        if (!raw->background) return wait_jobs(&jid, 1, 0, -1);
+        if (exec_interactive) printf("[%d]\n", jid);
+        return 0;
+    }
+
+    struct cmdline *l = expand_cmdline(raw);
+    int status = 0;
+
+    if (l->err) {
+        fprintf(stderr, "error: %s\n", l->err);
+        freecmdline(l);
+        return 2;
+    }
+    if (l->seq[0] == NULL) {
+        freecmdline(l);
+        return last_status;     /* ligne vide après expansion */
+    }
+
+    /* timeout DURÉE ... cmd : cmd, avec une échéance pour son job */
+    struct timeout_spec to;
+    int timed = is_timeout(l);
+    if (timed && timeout_parse(l, &to) < 0) {
+        freecmdline(l);
+        return TIMEOUT_FAILED;
+    }
+
+    if (exec_debug) print_cmdline(l);
+
+    if (l->seq[0][0] == NULL) {
+        /* que des NAME=valeur : variables du shell */
+        for (char **a = l->assign[0]; *a; a++) {
+            char *eq = strchr(*a, '=');
+            *eq = '\0';
+            var_set(*a, eq + 1, -1);
+        }
+        freecmdline(l);
+        return 0;
+    }
+
+    /* memo cmd : la sortie gardée d'une exécution précédente, ou cmd */
+    if (is_memo(l)) {
+        int jid = launch_memo(l, l->background ? RUNNING : FG);
+        if (timed && jid > 0) timeout_set(jid, &to);
+        status = jid == MEMO_HIT ? 0 : finish_launch(jid, l->background);
+        freecmdline(l);
+        return status;
+    }
+
+    if (handle_builtins(l, &status)) {
+        freecmdline(l);
+        return status;
+    }
+
+    if (tail && !timed && can_exec_in_place(l))
+        exec_in_place(l);
+
+    int jid = launch_cmdline(l, -1, l->background ? RUNNING : FG);
+    if (timed && jid > 0) timeout_set(jid, &to);
+    status = finish_launch(jid, l->background);
+    freecmdline(l);
+    return status;
+}
+
+/* Ctrl-C pendant une boucle : on arrête la boucle */
+static int interrupted(int status) {
+    return status == 128 + SIGINT;
+}
+
+/* un tour de boucle for par mot de la liste, produit à la demande.
+   la variable reste définie après la boucle, comme dans sh */
+struct for_loop {
+    struct node *n;
+    int          status;
+};
+
+static int for_item(const char *w, void *arg) {
+    struct for_loop *f = arg;
+
+    var_set(f->n->var, w, -1);
+    f->status = run_node(f->n->b, 0);
+    return interrupted(f->status);
+}
+
+int run_node(struct node *n, int tail) {
+    int status = 0;
+
+    if (!n) return last_status;
+
+    if (n->background) {
+        int jid = n->remote ? launch_remote(n) : launch_node(n, -1, RUNNING);
+        if (jid > 0 && exec_interactive) print_launched(jid);
+        return last_status = (jid > 0 ? 0 : 1);
+    }
+
+    switch (n->type) {
+    case N_CMD:
+        status = run_cmd(n->cmd, tail);
+        break;
+    case N_SEQ:
+        run_node(n->a, 0);
+        status = run_node(n->b, tail);
+        break;
+    case N_AND:
+        status = run_node(n->a, 0);
+        if (status == 0) status = run_node(n->b, tail);
+        break;
+    case N_OR:
+        status = run_node(n->a, 0);
+        if (status != 0) status = run_node(n->b, tail);
+        break;
+    case N_GROUP:
+        status = run_node(n->a, tail);
+        break;
+    case N_SUBSHELL:
+        /* en dernière position, le shell peut servir de sous-shell */
+        if (tail) status = run_node(n->a, 1);
+        else status = launch_node(n, -1, FG) > 0 ? wait_fg_job() : 1;
+        break;
+    case N_IF:
+        if (run_node(n->a, 0) == 0) status = run_node(n->b, tail);
+        else if (n->c)              status = run_node(n->c, tail);
+        else                        status = 0;
+        break;
+    case N_WHILE:
+        while ((status = run_node(n->a, 0)) == 0) {
+            status = run_node(n->b, 0);
+            if (interrupted(status)) break;
+        }
+        if (!interrupted(status)) status = 0;
+        break;
+    case N_FOR: {
+        struct for_loop f = { n, 0 };
+
+        expand_words_each(n->words, for_item, &f);
+        status = f.status;
+        break;
+    }
+    }
+    return last_status = status;
+}
+
+
+/* ── $(...) et `...` ── */
+
+/* la commande est lancée au premier plan, sortie sur fd_out */
+static void subst_spawn(char *text, int fd_out) {
+    struct node *root;
+    char *err;
+
+    int r = ast_parse_cached(text, &root, &err);
+    if (r != AST_OK) {
+        fprintf(stderr, "error: %s\n", r == AST_MORE ? "unterminated command" : err);
+        return;
+    }
+    if (!root) return;
+
+    /* un simple pipeline est lancé directement, le reste dans un fils */
+    if (root->type == N_CMD && !root->cmd->background) {
+        struct cmdline *l = expand_cmdline(root->cmd);
+        if (l->err) fprintf(stderr, "error: %s\n", l->err);
+        else if (l->seq[0]) launch_cmdline(l, fd_out, FG);
+        freecmdline(l);
+    } else {
+        launch_node(root, fd_out, FG);
+    }
+    ast_release(root);
+}
+
+static void subst_wait(void) {
+    last_status = wait_fg_job();
+}
+
+const struct expand_ops shell_expand_ops = {
+    .spawn  = subst_spawn,
+    .wait   = subst_wait,
+    .lookup = shell_lookup,
+};
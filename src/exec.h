@@ -0,0 +1,95 @@
+#ifndef __EXEC_H__
+#define __EXEC_H__
+
+#include <signal.h>
+#include "readcmd.h"
+#include "jobs.h"
+#include "ast.h"
+
+/* Si non nul, on affiche in/out/seq avant de lancer chaque commande */
+extern int exec_debug;
+
+/* Si non nul, le shell lit ce que tape l’utilisateur (0 dans un script,
+   un -c, un sous-shell) : les jobs en arrière-plan sont annoncés à leur
+   lancement et à leur fin */
+extern int exec_interactive;
+
+/* set autopin : les jobs en arrière-plan sont épinglés comme avec &pin
+   (voir cpumap.h) */
+extern int exec_autopin;
+
+/* set autolow : les jobs en arrière-plan sont baissés pendant une
+   commande au premier plan (voir prio.h) */
+extern int exec_autolow;
+
+/* set capture : la sortie des jobs en arrière-plan est gardée comme avec
+   &>> (voir capture.h) */
+extern int exec_capture;
+
+/* Code de retour de la dernière commande ($?) */
+extern int last_status;
+
+/* Si non NULL, appelé par le handler SIGCHLD à la fin d’un job en
+   arrière-plan (code : à la sh), à la place du message Done */
+extern void (*exec_job_done)(job_t *j, int code);
+
+/* On bloque SIGCHLD pendant qu’on touche à jobs[] */
+void block_sigchld(sigset_t *prev);
+void unblock_sigchld(sigset_t *prev);
+
+/* Code de retour du job fini j : à la sh (128 + signal s’il a été tué),
+   124 s’il a été arrêté par timeout */
+int  job_code(const job_t *j);
+
+/* Handler SIGCHLD : récupère les fils et met jobs[] à jour */
+void sigchld_handler(int signum);
+
+/* Dans un fils, avant exec : signaux par défaut, rien de bloqué */
+void reset_signals_in_child(void);
+
+/* Lance la ligne l (déjà expansée) sans attendre, dans un nouveau job
+   d’état state. Si fd_out >= 0 (et pas de '>'), la sortie du dernier
+   processus y est envoyée. Retourne le jid, -1 si échec */
+int  launch_cmdline(struct cmdline *l, int fd_out, job_state state);
+
+/* Lance body(arg) dans un sous-shell (un fils qui sort avec le code
+   retourné), enregistré comme un job. Même contrat que launch_cmdline() */
+int  launch_function(const char *cmd_str, int fd_out, job_state state,
+                     int (*body)(void *arg), void *arg);
+
+/* Lance l’arbre n dans un sous-shell, comme launch_function() */
+int  launch_node(struct node *n, int fd_out, job_state state);
+
+/* Remplace le processus courant par la commande l (un seul étage) :
+   redirections, signaux par défaut, exec. Ne revient pas */
+void exec_in_place(struct cmdline *l);
+
+/* Attend qu’il n’y ait plus de job au premier plan
+   → code de retour du job (128 + signal s’il a été tué ou stoppé) */
+int  wait_fg_job(void);
+
+/* Vrai si le shell a encore à faire pour des jobs en arrière-plan
+   (une échéance de timeout, un after en attente) : il ne peut pas sortir
+   ni être remplacé par exec sans les abandonner */
+int  shell_has_duties(void);
+
+/* Fin d’un script ou d’un -c : attend, en faisant tourner les timers,
+   que shell_has_duties() soit faux. Les autres jobs continuent sans le
+   shell */
+void wait_shell_duties(void);
+
+/* exit : le shell principal attend comme à la fin d’un script puis sort
+   par exit() ; un sous-shell sort tout de suite par _exit(). Ne revient
+   pas */
+void shell_exit(int status);
+
+/* Exécute l’arbre n → code de retour.
+   tail non nul : rien ne sera exécuté après n dans ce processus (fin d’un
+   script, d’un -c ou d’un sous-shell), la dernière commande externe
+   remplace alors le shell par exec, sans fork ni attente */
+int  run_node(struct node *n, int tail);
+
+/* Les fonctions utilisées par l’expansion des mots ($(...), $x) */
+extern const struct expand_ops shell_expand_ops;
+
+#endif
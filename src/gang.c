@@ -0,0 +1,180 @@
+/*
+ * Ordonnanceur des jobs en arrière-plan (voir gang.h).
+ *
+ * Partage équitable pondéré : chaque job géré a un temps virtuel vtime,
+ * qui avance de quantum / poids pour chaque quantum où il a tourné. À
+ * chaque tick, les K jobs de plus petit vtime tournent (à égalité, ceux
+ * qui tournent déjà, pour ne pas réveiller et suspendre pour rien). Un
+ * job qui arrive (nouveau, ou qui revient d’un Stopped ou du premier
+ * plan) part du plus petit vtime des jobs gérés : il n’a pas de retard
+ * à rattraper sur ceux qui tournent depuis longtemps.
+ *
+ * Le job est Paused avant le SIGSTOP, SIGCHLD bloqué : le handler sait
+ * que cet arrêt n’est pas celui de l’utilisateur et ne l’affiche pas.
+ *
+ * L’état n’a de sens que dans le shell qui l’a créé : un sous-shell
+ * (fils) en a une copie, qu’il ignore (owner).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <signal.h>
+#include <stdint.h>
+#include <sys/timerfd.h>
+#include "exec.h"
+#include "jobs.h"
+#include "gang.h"
+#include "timers.h"
+
+static int   tfd = -1;          /* timerfd, -1 : inactif */
+static pid_t owner = 0;         /* le shell qui l’a créé */
+static int   slots;             /* K */
+static int   quantum;           /* en ms */
+
+static int active(void) {
+    return tfd >= 0 && getpid() == owner;
+}
+
+/* un job que l’ordonnanceur peut faire tourner ou suspendre */
+static int is_candidate(const job_t *j) {
+    return j->jid != 0 && !j->host[0] &&
+           (j->state == RUNNING || j->state == PAUSED);
+}
+
+/* a doit passer avant b */
+static int before(const job_t *a, const job_t *b) {
+    if (a->vtime != b->vtime) return a->vtime < b->vtime;
+    if (a->state != b->state) return a->state == RUNNING;
+    return a->jid < b->jid;
+}
+
+/* SIGCHLD bloqué */
+static void balance(void) {
+    static char chosen[MAXJOBS];    /* par case de jobs[] */
+    double min = -1;
+
+    for (job_t *j = first_job(); j; j = next_job(j)) {
+        chosen[j - jobs] = 0;
+        if (is_candidate(j) && j->managed && (min < 0 || j->vtime < min))
+            min = j->vtime;
+    }
+
+    for (job_t *j = first_job(); j; j = next_job(j)) {
+        if (!is_candidate(j)) {
+            j->managed = 0;
+        } else if (!j->managed) {
+            if (min >= 0 && j->vtime < min) j->vtime = min;
+            j->managed = 1;
+        }
+    }
+
+    /* les K premiers (K est petit : pas besoin de tri) */
+    for (int n = 0; n < slots; n++) {
+        job_t *best = NULL;
+        for (job_t *j = first_job(); j; j = next_job(j))
+            if (is_candidate(j) && !chosen[j - jobs] &&
+                (!best || before(j, best)))
+                best = j;
+        if (!best) break;
+        chosen[best - jobs] = 1;
+    }
+
+    for (job_t *j = first_job(); j; j = next_job(j)) {
+        if (!is_candidate(j)) continue;
+
+        if (chosen[j - jobs] && j->state == PAUSED) {
+            j->state = RUNNING;
+            kill(-(j->pgid), SIGCONT);
+        } else if (!chosen[j - jobs] && j->state == RUNNING) {
+            j->state = PAUSED;
+            kill(-(j->pgid), SIGSTOP);
+        }
+    }
+}
+
+void gang_balance(void) {
+    if (active()) balance();
+}
+
+static void gang_tick(void) {
+    uint64_t ticks;
+
+    if (!active()) return;
+    if (read(tfd, &ticks, sizeof(ticks)) != sizeof(ticks)) return;
+
+    sigset_t prev;
+    block_sigchld(&prev);
+    for (job_t *j = first_job(); j; j = next_job(j)) {
+        if (is_candidate(j) && j->managed && j->state == RUNNING)
+            j->vtime += (double)ticks * quantum / j->weight;
+    }
+    balance();
+    unblock_sigchld(&prev);
+}
+
+int gang_start(int k, int quantum_ms) {
+    static int registered = 0;
+
+    if (k < 1 || quantum_ms < 1) return -1;
+    if (!active()) {
+        if (tfd >= 0) close(tfd);       /* copie d’un autre shell */
+        tfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        if (tfd < 0) return -1;
+        if (timers_add(tfd, gang_tick) < 0) {
+            close(tfd);
+            tfd = -1;
+            return -1;
+        }
+        owner = getpid();
+    }
+    slots = k;
+    quantum = quantum_ms;
+
+    struct itimerspec it;
+    it.it_interval.tv_sec = quantum_ms / 1000;
+    it.it_interval.tv_nsec = (long)(quantum_ms % 1000) * 1000000;
+    it.it_value = it.it_interval;
+    if (timerfd_settime(tfd, 0, &it, NULL) < 0) {
+        timers_remove(tfd);
+        close(tfd);
+        tfd = -1;
+        return -1;
+    }
+
+    /* en quittant le shell, personne ne doit rester suspendu */
+    if (!registered) {
+        atexit(gang_stop);
+        registered = 1;
+    }
+
+    sigset_t prev;
+    block_sigchld(&prev);
+    balance();
+    unblock_sigchld(&prev);
+    return 0;
+}
+
+void gang_stop(void) {
+    if (!active()) return;
+
+    sigset_t prev;
+    block_sigchld(&prev);
+    for (job_t *j = first_job(); j; j = next_job(j)) {
+        j->managed = 0;
+        if (j->state == PAUSED) {
+            j->state = RUNNING;
+            kill(-(j->pgid), SIGCONT);
+        }
+    }
+    unblock_sigchld(&prev);
+
+    timers_remove(tfd);
+    close(tfd);
+    tfd = -1;
+}
+
+void gang_print(void) {
+    if (active()) printf("gang %d %d\n", slots, quantum);
+    else printf("gang off\n");
+}
@@ -0,0 +1,33 @@
+#ifndef __GANG_H__
+#define __GANG_H__
+
+/* ── Ordonnanceur des jobs en arrière-plan ──
+   gang K [quantum_ms] : au plus K jobs en arrière-plan tournent à la
+   fois, les autres sont suspendus (SIGSTOP au groupe, état Paused dans
+   jobs). Tous les quantum_ms (un timerfd), chaque job qui a tourné
+   avance de quantum / poids, et ce sont les K jobs les moins avancés
+   qui tournent pendant le quantum suivant : chacun a une part du
+   processeur proportionnelle à son poids (gang -w W %n, 1 par défaut).
+
+   Un job arrêté par l’utilisateur (stop, Ctrl-Z) est Stopped, pas
+   Paused : l’ordonnanceur n’y touche plus jusqu’au bg. Les jobs au
+   premier plan et les jobs distants (&@) ne sont pas concernés.
+
+   Le quantum est un des timers du shell (voir timers.h). */
+
+#define GANG_QUANTUM 100    /* quantum par défaut, en ms */
+
+/* Active l’ordonnanceur (ou change ses réglages) → 0, -1 si erreur */
+int  gang_start(int k, int quantum_ms);
+
+/* Le désactive : les jobs suspendus repartent */
+void gang_stop(void);
+
+/* Affiche les réglages */
+void gang_print(void);
+
+/* Choisit les jobs qui tournent, sans attendre le prochain quantum
+   (après le lancement d’un job). SIGCHLD doit être bloqué */
+void gang_balance(void);
+
+#endif
@@ -0,0 +1,514 @@
+/*
+ * Historique (voir history.h).
+ *
+ * Les projections ne sont refaites que si la taille d'un fichier a
+ * changé : tant que personne n'écrit, history_entry ne coûte qu'un
+ * fstat par fichier.
+ *
+ * HISTFILE.tri est projeté en écriture : ajouter une commande aux listes
+ * de ses trigrammes, c'est écrire en mémoire. Un bloc est rempli avant
+ * d'être accroché à sa liste, un numéro écrit avant que le compte du
+ * bloc ne le montre. Le fichier grandit par ftruncate, par morceaux.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+#include "csapp.h"
+#include "vars.h"
+#include "history.h"
+
+#define LIST_DEFAULT 20
+
+#define NBUCKETS   65536        /* listes : un trigramme → une liste */
+#define BLOCK_MIN  4            /* numéros dans le premier bloc d'une liste */
+#define BLOCK_MAX  1024         /* ... et au plus (la taille double) */
+#define GROW_MIN   (1 << 20)    /* le fichier des listes grandit d'au moins */
+
+#define OFF_MAGIC  "tpshell-hoff 2\n"   /* 16 octets avec le '\0' */
+#define TRI_MAGIC  "tpshell-htri 2\n"
+#define MAGIC_LEN  16
+
+/* HISTFILE.tri : l'en-tête, puis les blocs */
+struct bucket {
+    uint64_t tail;          /* dernier bloc de la liste, 0 : liste vide */
+    uint32_t count;         /* numéros dans la liste */
+    uint32_t unused;
+};
+
+struct tri_head {
+    char          magic[MAGIC_LEN];
+    uint64_t      nindexed;     /* commandes déjà dans les listes */
+    uint64_t      end;          /* fin de la partie utilisée */
+    struct bucket b[NBUCKETS];
+};
+
+/* un bloc de numéros de commandes, croissants ; prev : le bloc d'avant
+   (plus anciens) */
+struct block {
+    uint64_t prev;
+    uint32_t n, cap;
+    uint32_t ids[];
+};
+
+static char *path = NULL;   /* HISTFILE des fichiers ouverts */
+static int hfd = -1, ifd = -1, tfd = -1;
+static char *text = NULL;   /* le fichier projeté */
+static size_t text_len = 0;
+static char *offs_map = NULL;   /* HISTFILE.idx : OFF_MAGIC, puis la
+                                   position de chaque commande */
+static size_t offs_len = 0;
+static const uint64_t *offs = NULL;
+static size_t nrecs = 0;
+static char *tri = NULL;        /* HISTFILE.tri */
+static size_t tri_len = 0;
+
+#define HEAD ((struct tri_head *)tri)
+
+/* la liste du trigramme p */
+static int bucket_of(const char *p) {
+    const unsigned char *u = (const unsigned char *)p;
+    uint32_t t = u[0] | u[1] << 8 | u[2] << 16;
+    return (t * 2654435761u) >> 16;
+}
+
+static struct block *block_at(uint64_t off) {
+    return off ? (struct block *)(tri + off) : NULL;
+}
+
+/* vrai si les len octets de s contiennent pattern (de longueur plen) */
+static int contains(const char *s, size_t len, const char *pattern,
+                    size_t plen) {
+    if (plen == 0) return 1;
+    for (const char *end = s + len; (size_t)(end - s) >= plen; s++) {
+        s = memchr(s, pattern[0], end - s - plen + 1);
+        if (!s) return 0;
+        if (memcmp(s, pattern, plen) == 0) return 1;
+    }
+    return 0;
+}
+
+static void *project(int fd, size_t len, int prot) {
+    if (len == 0) return NULL;
+    void *p = mmap(NULL, len, prot, MAP_SHARED, fd, 0);
+    return p == MAP_FAILED ? NULL : p;
+}
+
+/* la projection *map (de taille *len) de fd, refaite si sa taille a
+   changé */
+static void remap_one(int fd, char **map, size_t *len, int prot) {
+    struct stat st;
+
+    if (fstat(fd, &st) < 0 || (size_t)st.st_size == *len) return;
+    if (*map) munmap(*map, *len);
+    *len = st.st_size;
+    if (!(*map = project(fd, *len, prot))) *len = 0;
+}
+
+/* les projections à la taille actuelle des fichiers */
+static void remap(void) {
+    remap_one(hfd, &text, &text_len, PROT_READ);
+    remap_one(ifd, &offs_map, &offs_len, PROT_READ);
+    remap_one(tfd, &tri, &tri_len, PROT_READ | PROT_WRITE);
+
+    if (offs_len >= MAGIC_LEN) {
+        offs = (const uint64_t *)(offs_map + MAGIC_LEN);
+        nrecs = (offs_len - MAGIC_LEN) / sizeof(uint64_t);
+    } else {
+        offs = NULL;
+        nrecs = 0;
+    }
+}
+
+/* fin (après le '\n') de la commande qui commence à off */
+static size_t end_of(size_t off) {
+    if (off >= text_len) return text_len;
+    char *nl = memchr(text + off, '\n', text_len - off);
+    return nl ? (size_t)(nl - text) + 1 : text_len;
+}
+
+static int write_all(int fd, const void *buf, size_t n) {
+    const char *p = buf;
+
+    while (n > 0) {
+        ssize_t w = write(fd, p, n);
+        if (w < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        p += w;
+        n -= w;
+    }
+    return 0;
+}
+
+/* size octets de plus à la fin des listes (verrou pris) → leur position,
+   0 si le fichier n'a pas pu grandir. tri peut avoir bougé */
+static uint64_t tri_alloc(size_t size) {
+    uint64_t off = HEAD->end;
+
+    if (off + size > tri_len) {
+        size_t len = tri_len + tri_len / 4;
+        if (len < off + size + GROW_MIN) len = off + size + GROW_MIN;
+        if (ftruncate(tfd, len) < 0) return 0;
+        remap();
+        if (!tri || off + size > tri_len) return 0;
+    }
+    HEAD->end = off + size;
+    return off;
+}
+
+/* ajoute la commande id à la liste b → 0, -1 si erreur */
+static int post(int b, uint32_t id) {
+    struct block *blk = block_at(HEAD->b[b].tail);
+
+    if (!blk || blk->n == blk->cap) {
+        uint32_t cap = !blk ? BLOCK_MIN
+                     : blk->cap < BLOCK_MAX ? 2 * blk->cap : BLOCK_MAX;
+        uint64_t off = tri_alloc(sizeof(struct block) + cap * sizeof(uint32_t));
+        if (!off) return -1;
+        blk = block_at(off);
+        blk->prev = HEAD->b[b].tail;
+        blk->n = 0;
+        blk->cap = cap;
+        HEAD->b[b].tail = off;
+    }
+    blk->ids[blk->n] = id;
+    blk->n++;
+    HEAD->b[b].count++;
+    return 0;
+}
+
+/* met la commande id dans la liste de chacun de ses trigrammes (une
+   fois par liste) → 0, -1 si erreur */
+static int index_entry(uint32_t id) {
+    static uint32_t seen[NBUCKETS];     /* gen du dernier passage */
+    static uint32_t gen = 0;
+    size_t off = offs[id], end = end_of(off);
+    const char *s = text + off;
+    size_t len = end - off - (end > off && text[end - 1] == '\n');
+
+    if (++gen == 0) {
+        memset(seen, 0, sizeof(seen));
+        gen = 1;
+    }
+    for (size_t i = 0; i + 3 <= len; i++) {
+        int b = bucket_of(s + i);
+        if (seen[b] == gen) continue;
+        seen[b] = gen;
+        if (post(b, id) < 0) return -1;
+    }
+    return 0;
+}
+
+/* remet à zéro un fichier d'index (absent, ou d'un autre format) */
+static void reset(int fd, const char *magic, size_t size) {
+    if (ftruncate(fd, 0) < 0 || ftruncate(fd, size) < 0) return;
+    pwrite(fd, magic, MAGIC_LEN, 0);
+}
+
+/* les index au format attendu (verrou pris) : sinon ils sont refaits */
+static void check_format(void) {
+    int redo = offs_len < MAGIC_LEN ||
+               memcmp(offs_map, OFF_MAGIC, MAGIC_LEN) != 0;
+
+    if (redo) {
+        /* O_APPEND : ftruncate remet la fin au début */
+        if (ftruncate(ifd, 0) == 0) write_all(ifd, OFF_MAGIC, MAGIC_LEN);
+    }
+    if (redo || tri_len < sizeof(struct tri_head) ||
+        memcmp(tri, TRI_MAGIC, MAGIC_LEN) != 0) {
+        reset(tfd, TRI_MAGIC, sizeof(struct tri_head) + GROW_MIN);
+        remap();
+        if (tri) HEAD->end = sizeof(struct tri_head);
+    }
+    remap();
+}
+
+/* indexe les commandes que les index n'ont pas encore (verrou pris) */
+static void repair(void) {
+    size_t from = nrecs > 0 ? end_of(offs[nrecs - 1]) : 0;
+
+    if (from < text_len) {
+        /* une dernière ligne coupée : la suivante ne doit pas s'y coller */
+        if (text[text_len - 1] != '\n') {
+            write_all(hfd, "\n", 1);
+            remap();
+        }
+
+        static uint64_t buf[4096];
+        int n = 0;
+        while (from < text_len) {
+            buf[n] = from;
+            if (++n == 4096) {
+                write_all(ifd, buf, n * sizeof(uint64_t));
+                n = 0;
+            }
+            from = end_of(from);
+        }
+        write_all(ifd, buf, n * sizeof(uint64_t));
+        remap();
+    }
+
+    if (!tri) return;
+    while (HEAD->nindexed < nrecs) {
+        if (index_entry(HEAD->nindexed) < 0) return;
+        HEAD->nindexed++;
+    }
+}
+
+static void close_history(void) {
+    if (text) munmap(text, text_len);
+    if (offs_map) munmap(offs_map, offs_len);
+    if (tri) munmap(tri, tri_len);
+    if (hfd >= 0) close(hfd);
+    if (ifd >= 0) close(ifd);
+    if (tfd >= 0) close(tfd);
+    text = offs_map = tri = NULL;
+    offs = NULL;
+    text_len = offs_len = tri_len = nrecs = 0;
+    hfd = ifd = tfd = -1;
+    free(path);
+    path = NULL;
+}
+
+/* HISTFILE + suffix, ouvert avec flags */
+static int open_with(const char *p, const char *suffix, int flags) {
+    char *name = Malloc(strlen(p) + strlen(suffix) + 1);
+    sprintf(name, "%s%s", p, suffix);
+    int fd = open(name, flags | O_CREAT | O_CLOEXEC, 0600);
+    free(name);
+    return fd;
+}
+
+/* les fichiers de HISTFILE, ouverts et projetés → 0, -1 si erreur */
+static int open_history(void) {
+    const char *p = var_get("HISTFILE");
+    char def[4096];
+
+    if (!p) {
+        const char *home = var_get("HOME");
+        snprintf(def, sizeof(def), "%s/.tpshell_history", home ? home : ".");
+        p = def;
+    }
+    if (path && strcmp(path, p) == 0) {
+        remap();
+        return 0;
+    }
+    close_history();
+
+    hfd = open_with(p, "", O_RDWR | O_APPEND);
+    ifd = open_with(p, ".idx", O_RDWR | O_APPEND);
+    tfd = open_with(p, ".tri", O_RDWR);
+    if (hfd < 0 || ifd < 0 || tfd < 0) {
+        int e = errno;
+        close_history();
+        errno = e;
+        return -1;
+    }
+    path = strdup(p);
+
+    flock(ifd, LOCK_EX);
+    remap();
+    check_format();
+    repair();
+    flock(ifd, LOCK_UN);
+    return 0;
+}
+
+void history_add(const char *cmd) {
+    size_t n = strlen(cmd);
+
+    if (strspn(cmd, " \t\n") == n) return;
+    if (open_history() < 0) return;
+
+    char *line = Malloc(n + 1);
+    for (size_t i = 0; i < n; i++)
+        line[i] = cmd[i] == '\n' ? HISTORY_NEWLINE : cmd[i];
+    line[n] = '\n';
+
+    /* le verrou tient la commande et ses index ensemble : une autre
+       commande ne peut pas passer entre les deux */
+    flock(ifd, LOCK_EX);
+    remap();
+    check_format();
+    repair();
+    if (write_all(hfd, line, n + 1) == 0) {
+        remap();
+        repair();
+    }
+    flock(ifd, LOCK_UN);
+    free(line);
+}
+
+int history_count(void) {
+    if (open_history() < 0) return 0;
+    return nrecs;
+}
+
+const char *history_entry(int i, size_t *len) {
+    if (i < 0 || (size_t)i >= nrecs) return NULL;
+
+    /* l'index a pu être projeté après le texte */
+    size_t off = offs[i];
+    if (off >= text_len) remap();
+    if (off >= text_len) return NULL;
+
+    size_t end = end_of(off);
+    *len = end - off - (text[end - 1] == '\n');
+    return text + off;
+}
+
+/* "    12  commande", les '\n' remis */
+static void print_entry(int i) {
+    size_t len;
+    const char *e = history_entry(i, &len);
+
+    if (!e) return;
+    printf("%6d  ", i + 1);
+    for (size_t k = 0; k < len; k++)
+        putchar(e[k] == HISTORY_NEWLINE ? '\n' : e[k]);
+    putchar('\n');
+}
+
+static int open_or_complain(void) {
+    if (open_history() == 0) return 0;
+    perror("history");
+    return -1;
+}
+
+void history_list(int n) {
+    if (open_or_complain() < 0) return;
+    if (n <= 0) n = LIST_DEFAULT;
+
+    int first = (int)nrecs > n ? (int)nrecs - n : 0;
+    for (int i = first; i < (int)nrecs; i++) print_entry(i);
+}
+
+/* une liste, parcourue du plus récent au plus ancien */
+struct cursor {
+    struct block *blk;
+    int           pos;      /* numéro courant : blk->ids[pos] */
+    uint32_t      count;
+};
+
+static void cursor_init(struct cursor *c, int b) {
+    c->blk = block_at(HEAD->b[b].tail);
+    c->pos = c->blk ? (int)c->blk->n - 1 : -1;
+    c->count = HEAD->b[b].count;
+}
+
+/* avance c jusqu'au premier numéro <= id → ce numéro, -1 si la liste
+   est finie. un bloc dont le premier numéro est après id est sauté
+   sans être lu */
+static int64_t seek(struct cursor *c, int64_t id) {
+    while (c->blk) {
+        if (c->pos >= 0 && c->blk->ids[0] <= id) {
+            if (c->blk->ids[c->pos] > id) {
+                /* le dernier ids[k] <= id, k dans [0, pos) */
+                int lo = 0, hi = c->pos;
+                while (hi - lo > 1) {
+                    int mid = (lo + hi) / 2;
+                    if (c->blk->ids[mid] <= id) lo = mid;
+                    else hi = mid;
+                }
+                c->pos = lo;
+            }
+            return c->blk->ids[c->pos];
+        }
+        c->blk = block_at(c->blk->prev);
+        c->pos = c->blk ? (int)c->blk->n - 1 : -1;
+    }
+    return -1;
+}
+
+static int by_count(const void *a, const void *b) {
+    const struct cursor *x = a, *y = b;
+    return x->count < y->count ? -1 : x->count > y->count;
+}
+
+/* vrai si la commande id contient pattern */
+static int matches(int64_t id, const char *pattern, size_t plen) {
+    size_t len;
+    const char *e = history_entry(id, &len);
+    return e && contains(e, len, pattern, plen);
+}
+
+/* les commandes qui contiennent pattern (au moins 3 caractères), par
+   les listes de ses trigrammes : la plus courte donne les candidats,
+   qu'on cherche dans les autres → leur nombre, dans *found (du plus
+   récent au plus ancien) */
+static size_t search_lists(const char *pattern, size_t plen, int **found) {
+    struct cursor *c = Malloc((plen - 2) * sizeof(struct cursor));
+    int nc = 0;
+    size_t n = 0, size = 0;
+
+    for (size_t i = 0; i + 3 <= plen; i++) {
+        int b = bucket_of(pattern + i), dup = 0;
+        for (size_t k = 0; k < i && !dup; k++)
+            dup = bucket_of(pattern + k) == b;
+        if (!dup) cursor_init(&c[nc++], b);
+    }
+    qsort(c, nc, sizeof(struct cursor), by_count);
+
+    int64_t cand = nrecs > 0 ? seek(&c[0], (int64_t)nrecs - 1) : -1;
+    while (cand >= 0) {
+        int64_t next = cand - 1;
+        int all = 1;
+        for (int k = 1; k < nc && all; k++) {
+            int64_t v = seek(&c[k], cand);
+            if (v < cand) {
+                /* pas dans cette liste : on repart de là où elle est */
+                next = v;
+                all = 0;
+            }
+        }
+        if (all && matches(cand, pattern, plen)) {
+            if (n == size) {
+                size = size ? 2 * size : 64;
+                *found = Realloc(*found, size * sizeof(int));
+            }
+            (*found)[n++] = cand;
+        }
+        cand = next >= 0 ? seek(&c[0], next) : -1;
+    }
+    free(c);
+    return n;
+}
+
+int history_search(const char *pattern) {
+    if (open_or_complain() < 0) return 0;
+
+    /* verrou partagé : personne n'ajoute pendant qu'on lit les listes */
+    flock(ifd, LOCK_SH);
+    remap();
+
+    size_t plen = strlen(pattern);
+    int found = 0;
+
+    if (plen >= 3 && tri && HEAD->nindexed == nrecs) {
+        int *ids = NULL;
+        size_t n = search_lists(pattern, plen, &ids);
+        for (size_t i = n; i-- > 0;) print_entry(ids[i]);
+        free(ids);
+        found = n;
+    } else {
+        /* moins de 3 caractères : pas de trigramme, tout est candidat */
+        for (size_t i = 0; i < nrecs; i++) {
+            if (matches(i, pattern, plen)) {
+                print_entry(i);
+                found++;
+            }
+        }
+    }
+
+    flock(ifd, LOCK_UN);
+    return found;
+}
@@ -0,0 +1,59 @@
+#ifndef __HISTORY_H__
+#define __HISTORY_H__
+
+#include <stddef.h>
+
+/* ── Historique des commandes ──
+   Un fichier texte, une commande par ligne (les '\n' d’une commande sur
+   plusieurs lignes y sont des HISTORY_NEWLINE) : HISTFILE, par défaut
+   $HOME/.tpshell_history. Il n’est jamais relu ni découpé : il est projeté
+   en mémoire (mmap) à la première utilisation, et reprojeté quand un
+   autre shell l’a fait grandir.
+
+   À côté, HISTFILE.idx donne la position de chaque commande dans le
+   fichier, et HISTFILE.tri une liste par trigramme (haché sur 65536
+   listes) : les numéros des commandes qui le contiennent, en blocs
+   chaînés du plus récent au plus ancien. history -s prend la plus
+   courte des listes des trigrammes du motif et ne garde que les
+   numéros qui sont aussi dans les autres (un bloc entier plus récent
+   que le numéro cherché est sauté), puis vérifie le texte de ceux-là.
+   Un motif de moins de 3 caractères n’a pas de trigramme : toutes les
+   commandes sont lues.
+
+   Mesuré sur 10 millions de commandes (430 Mo de texte, 80 Mo de
+   positions, 1,7 Go de listes ; shell lancé compris) : 22 ms pour un
+   motif rare, 87 ms pour un motif absent, 200 à 300 ms quand il y a
+   80 000 à 110 000 réponses à afficher ; refaire les index prend 9 s,
+   ajouter une commande 0,2 ms.
+
+   Les ajouts se font sous un verrou (flock) exclusif sur HISTFILE.idx,
+   les recherches sous un verrou partagé : des shells en parallèle ne se
+   mélangent pas. Le texte et les positions sont en O_APPEND, chaque
+   commande y est écrite d’un seul write ; les listes sont écrites dans
+   leur projection. Des index absents, d’un autre format ou en retard
+   (shell tué au milieu d’un ajout) sont complétés à l’ouverture et à
+   chaque ajout.
+
+   Les commandes tapées dans un shell interactif sont gardées si son
+   entrée est un terminal, ou si HISTFILE est définie. */
+
+#define HISTORY_NEWLINE '\037'  /* un '\n' dans une commande gardée */
+
+/* Ajoute la commande text à la fin de l’historique */
+void history_add(const char *text);
+
+/* Nombre de commandes dans l’historique (0 s’il n’y en a pas) */
+int  history_count(void);
+
+/* La commande numéro i (0 : la plus ancienne), *len octets, sans '\n'
+   final, valable jusqu’au prochain appel → NULL si i est hors limites */
+const char *history_entry(int i, size_t *len);
+
+/* history [N] : les N dernières commandes (20 par défaut), numérotées */
+void history_list(int n);
+
+/* history -s motif : les commandes qui contiennent motif → nombre de
+   commandes trouvées */
+int  history_search(const char *pattern);
+
+#endif
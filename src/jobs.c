@@ -4,10 +4,18 @@
  * Ce fichier gère les jobs du shell.
  * Un job correspond à une commande lancée (foreground ou background).
  * On utilise un tableau global jobs[] pour stocker tout ça.
- * Une case est libre si jid == 0.
+ * Une case est libre si jid == 0. slot_of[] donne la case d'un jid, et
+ * une table de hachage celle d'un pid : le handler SIGCHLD trouve le job
+ * d'un fils fini sans parcourir jobs[]. Les cases occupées sont chaînées
+ * par jid croissant, les libres sont dans une pile, et on se souvient de
+ * la case du job au premier plan : rien ne parcourt les MAXJOBS cases,
+ * seulement les jobs présents.
  */
 
 #include "jobs.h"
+#include "timers.h"
+#include "every.h"
+#include "csapp.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -15,81 +23,254 @@
 /* tableau global des jobs */
 job_t jobs[MAXJOBS];
 
-/* retourne un jid libre (le plus petit dispo) */
-static int next_jid(void)
+/* case + 1 de chaque jid, 0 s'il est libre */
+static int slot_of[MAXJOBS + 1];
+
+/* les cases occupées, par jid croissant (-1 : fin de la liste) */
+static int head = -1;
+static int next_of[MAXJOBS], prev_of[MAXJOBS];
+static int njobs = 0;
+
+/* les cases libres : free_slots[nfree - 1] est la prochaine */
+static int free_slots[MAXJOBS];
+static int nfree = -1;          /* -1 : pas encore remplie */
+
+/* case du dernier job mis au premier plan, -1 si aucun */
+static int fg_slot = -1;
+
+/* pid → case, adressage ouvert (pid 0 : entrée vide). on n'y ajoute
+   que SIGCHLD bloqué (la table peut grandir) ; le handler ne fait que
+   chercher et retirer */
+struct pid_entry {
+    pid_t pid;
+    int   slot;
+};
+static struct pid_entry *pid_tab = NULL;
+static unsigned pid_cap = 0, pid_n = 0;   /* pid_cap : puissance de 2 */
+
+static unsigned pid_hash(pid_t pid)
+{
+    return (unsigned)pid * 2654435761u;
+}
+
+static void pid_put(pid_t pid, int slot);
+
+static void pid_grow(void)
+{
+    struct pid_entry *old = pid_tab;
+    unsigned old_cap = pid_cap;
+
+    pid_cap = pid_cap ? 2 * pid_cap : 256;
+    pid_tab = Calloc(pid_cap, sizeof(struct pid_entry));
+    pid_n = 0;
+    for (unsigned i = 0; i < old_cap; i++)
+        if (old[i].pid) pid_put(old[i].pid, old[i].slot);
+    free(old);
+}
+
+/* un pid déjà présent (réutilisé par le système) change de case */
+static void pid_put(pid_t pid, int slot)
+{
+    if (pid <= 0) return;
+    if (2 * (pid_n + 1) > pid_cap) pid_grow();
+
+    unsigned mask = pid_cap - 1, i = pid_hash(pid) & mask;
+    while (pid_tab[i].pid && pid_tab[i].pid != pid) i = (i + 1) & mask;
+    if (!pid_tab[i].pid) pid_n++;
+    pid_tab[i].pid = pid;
+    pid_tab[i].slot = slot;
+}
+
+static int pid_find(pid_t pid)
+{
+    if (pid <= 0 || pid_cap == 0) return -1;
+
+    unsigned mask = pid_cap - 1, i = pid_hash(pid) & mask;
+    for (; pid_tab[i].pid; i = (i + 1) & mask)
+        if (pid_tab[i].pid == pid) return pid_tab[i].slot;
+    return -1;
+}
+
+/* retire pid s'il est à la case slot. les entrées suivantes du même
+   groupe reculent : pas de case morte, pas d'allocation */
+static void pid_del(pid_t pid, int slot)
+{
+    if (pid <= 0 || pid_cap == 0) return;
+
+    unsigned mask = pid_cap - 1, i = pid_hash(pid) & mask;
+    while (pid_tab[i].pid != pid) {
+        if (!pid_tab[i].pid) return;
+        i = (i + 1) & mask;
+    }
+    if (pid_tab[i].slot != slot) return;
+
+    for (unsigned j = i;;) {
+        j = (j + 1) & mask;
+        if (!pid_tab[j].pid) break;
+        unsigned k = pid_hash(pid_tab[j].pid) & mask;
+        /* à sa place si k est entre i (exclu) et j (inclus) */
+        if (i <= j ? (i < k && k <= j) : (i < k || k <= j)) continue;
+        pid_tab[i] = pid_tab[j];
+        i = j;
+    }
+    pid_tab[i].pid = 0;
+    pid_n--;
+}
+
+/* met la case slot (jid déjà rempli) à sa place dans la liste */
+static void link_slot(int slot)
 {
-    int used[MAXJOBS + 1];
-    memset(used, 0, sizeof(used));
+    int jid = jobs[slot].jid, prev = -1, cur = head;
 
-    // on marque les jid déjà utilisés
-    for (int i = 0; i < MAXJOBS; i++) {
-        if (jobs[i].jid > 0 && jobs[i].jid <= MAXJOBS)
-            used[jobs[i].jid] = 1;
+    while (cur >= 0 && jobs[cur].jid < jid) {
+        prev = cur;
+        cur = next_of[cur];
     }
+    prev_of[slot] = prev;
+    next_of[slot] = cur;
+    if (prev >= 0) next_of[prev] = slot;
+    else head = slot;
+    if (cur >= 0) prev_of[cur] = slot;
+}
 
-    // on cherche le premier libre
-    for (int jid = 1; jid <= MAXJOBS; jid++) {
-        if (!used[jid])
+static void unlink_slot(int slot)
+{
+    if (prev_of[slot] >= 0) next_of[prev_of[slot]] = next_of[slot];
+    else head = next_of[slot];
+    if (next_of[slot] >= 0) prev_of[next_of[slot]] = prev_of[slot];
+}
+
+/* retourne un jid libre (le plus petit dispo) : il y en a un parmi les
+   njobs + 1 premiers */
+static int next_jid(void)
+{
+    for (int jid = 1; jid <= njobs + 1 && jid <= MAXJOBS; jid++) {
+        if (slot_of[jid] == 0)
             return jid;
     }
 
     return -1;  // plus de place
 }
 
+/* vide la case du job j et la rend libre */
+static void release_slot(job_t *j)
+{
+    int slot = j - jobs;
+
+    pid_del(j->pid, slot);
+    for (int k = 0; k < j->nprocs; k++)
+        pid_del(j->procs[k], slot);
+    unlink_slot(slot);
+    njobs--;
+    free_slots[nfree++] = slot;
+    if (fg_slot == slot) fg_slot = -1;
+
+    slot_of[j->jid] = 0;
+    j->jid   = 0;
+    j->pid   = 0;
+    j->pgid  = 0;
+    j->state = UNDEF;
+    j->cmd[0] = '\0';
+    j->nprocs = 0;
+    j->host[0] = '\0';
+    j->npin = 0;
+    j->dependents.jid = 0;
+}
+
 /* initialise complètement le tableau des jobs */
 void init_jobs(void)
 {
-    for (int i = 0; i < MAXJOBS; i++) {
-        jobs[i].jid   = 0;
-        jobs[i].pid   = 0;
-        jobs[i].pgid  = 0;
-        jobs[i].state = UNDEF;
-        jobs[i].cmd[0] = '\0';
+    if (nfree < 0) {
+        nfree = 0;
+        for (int i = MAXJOBS - 1; i >= 0; i--)
+            free_slots[nfree++] = i;
+    }
+
+    // les cases libres n'ont pas besoin d'être remises à zéro (add_job
+    // remplit tout) : un sous-shell n'écrit que dans les cases occupées,
+    // sans faire recopier tout le tableau après fork
+    while (head >= 0) {
+        job_t *j = &jobs[head];
+        j->series = NULL;       // la page partagée reste au père
+        j->pending = NULL;
+        release_slot(j);
     }
 }
 
-/* trouve la première case libre dans le tableau */
+/* trouve une case libre dans le tableau */
 int first_free_slot(void)
 {
-    for (int i = 0; i < MAXJOBS; i++) {
-        if (jobs[i].jid == 0)
-            return i;
-    }
-    return -1;
+    return nfree > 0 ? free_slots[nfree - 1] : -1;
+}
+
+/* nombre de jobs dans le tableau */
+int count_jobs(void)
+{
+    return njobs;
+}
+
+/* nombre de jobs lancés chez l'agent host */
+int count_host_jobs(const char *host)
+{
+    int n = 0;
+    for (job_t *j = first_job(); j; j = next_job(j))
+        if (strcmp(j->host, host) == 0) n++;
+    return n;
 }
 
-/* chercher un job à partir du pid */
+job_t *first_job(void)
+{
+    return head >= 0 ? &jobs[head] : NULL;
+}
+
+job_t *next_job(job_t *j)
+{
+    int next = next_of[j - jobs];
+    return next >= 0 ? &jobs[next] : NULL;
+}
+
+/* chercher un job à partir du pid (le principal ou un des autres) */
 job_t *get_job_by_pid(pid_t pid)
 {
-    for (int i = 0; i < MAXJOBS; i++) {
-        if (jobs[i].jid != 0 && jobs[i].pid == pid)
-            return &jobs[i];
-    }
-    return NULL;
+    int slot = pid_find(pid);
+    return slot >= 0 ? &jobs[slot] : NULL;
 }
 
 /* chercher un job à partir du jid */
 job_t *get_job_by_jid(int jid)
 {
-    if (jid <= 0) return NULL;
+    if (jid <= 0 || jid > MAXJOBS || slot_of[jid] == 0) return NULL;
+    return &jobs[slot_of[jid] - 1];
+}
 
-    for (int i = 0; i < MAXJOBS; i++) {
-        if (jobs[i].jid == jid)
-            return &jobs[i];
-    }
-    return NULL;
+/* change le jid d'un job (after : le job lancé prend celui de l'attente) */
+void renumber_job(job_t *j, int jid)
+{
+    int slot = j - jobs;
+
+    slot_of[j->jid] = 0;
+    unlink_slot(slot);
+    j->jid = jid;
+    slot_of[jid] = slot + 1;
+    link_slot(slot);
 }
 
-/* retourne le job en foreground s'il existe */
+/* retourne le job en foreground s'il existe : le dernier mis au premier
+   plan, s'il y est encore */
 job_t *get_fg_job(void)
 {
-    for (int i = 0; i < MAXJOBS; i++) {
-        if (jobs[i].jid != 0 && jobs[i].state == FG)
-            return &jobs[i];
-    }
+    if (fg_slot >= 0 && jobs[fg_slot].jid != 0 &&
+        jobs[fg_slot].state == FG)
+        return &jobs[fg_slot];
     return NULL;
 }
 
+void set_fg_job(job_t *j)
+{
+    j->state = FG;
+    fg_slot = j - jobs;
+}
+
 /* permet de gérer %jid ou pid directement */
 job_t *get_job_by_id_str(const char *id_str)
 {
@@ -112,6 +293,7 @@ job_t *get_job_by_id_str(const char *id_str)
 /* ajoute un job dans le tableau */
 int add_job(pid_t pid, pid_t pgid, job_state state, const char *cmd)
 {
+    if (nfree < 0) init_jobs();
     int slot = first_free_slot();
     if (slot < 0) {
         fprintf(stderr, "add_job: plus de place\n");
@@ -123,11 +305,38 @@ int add_job(pid_t pid, pid_t pgid, job_state state, const char *cmd)
         fprintf(stderr, "add_job: impossible de donner un jid\n");
         return -1;
     }
+    nfree--;
 
     jobs[slot].jid   = jid;
     jobs[slot].pid   = pid;
     jobs[slot].pgid  = pgid;
     jobs[slot].state = state;
+    jobs[slot].procs[0] = pid;
+    jobs[slot].nprocs = 1;
+    jobs[slot].last   = pid;
+    jobs[slot].status = 0;
+    jobs[slot].host[0] = '\0';
+    jobs[slot].npin = 0;
+    jobs[slot].cls = CLASS_NORMAL;
+    jobs[slot].dimmed = 0;
+    jobs[slot].weight = 1;
+    jobs[slot].vtime = 0;
+    jobs[slot].managed = 0;
+    jobs[slot].waited = 0;
+    jobs[slot].deadline = 0;
+    jobs[slot].timed_out = 0;
+    jobs[slot].series = NULL;
+    jobs[slot].ndeps = 0;
+    jobs[slot].dependents.jid = 0;
+    jobs[slot].nwaiting = 0;
+    jobs[slot].ok_only = 0;
+    jobs[slot].dep_failed = 0;
+    jobs[slot].pending = NULL;
+    slot_of[jid] = slot + 1;
+    link_slot(slot);
+    njobs++;
+    pid_put(pid, slot);
+    if (state == FG) fg_slot = slot;
 
     // copie de la commande (avec sécurité)
     strncpy(jobs[slot].cmd, cmd ? cmd : "", MAXCMD - 1);
@@ -136,18 +345,44 @@ int add_job(pid_t pid, pid_t pgid, job_state state, const char *cmd)
     return jid;
 }
 
+/* ajoute un processus au job (pipeline, substitution de processus) */
+int add_job_proc(int jid, pid_t pid)
+{
+    job_t *j = get_job_by_jid(jid);
+    if (!j) return -1;
+
+    if (j->nprocs >= MAXPROCS) {
+        fprintf(stderr, "add_job_proc: trop de processus\n");
+        return -1;
+    }
+    j->procs[j->nprocs++] = pid;
+    pid_put(pid, j - jobs);
+    return 0;
+}
+
+/* un processus du job est fini : on l'enlève (le dernier prend sa place).
+   le pid principal reste connu : on peut encore désigner le job par lui */
+int job_proc_exited(job_t *j, pid_t pid)
+{
+    for (int k = 0; k < j->nprocs; k++) {
+        if (j->procs[k] == pid) {
+            j->procs[k] = j->procs[--j->nprocs];
+            if (pid != j->pid) pid_del(pid, j - jobs);
+            break;
+        }
+    }
+    return j->nprocs;
+}
+
 /* supprime un job à partir de son pid */
 int delete_job_by_pid(pid_t pid)
 {
     job_t *j = get_job_by_pid(pid);
     if (!j) return -1;
 
-    j->jid   = 0;
-    j->pid   = 0;
-    j->pgid  = 0;
-    j->state = UNDEF;
-    j->cmd[0] = '\0';
-
+    series_release(j->series);
+    j->series = NULL;
+    release_slot(j);
     return 0;
 }
 
@@ -157,12 +392,9 @@ int delete_job_by_jid(int jid)
     job_t *j = get_job_by_jid(jid);
     if (!j) return -1;
 
-    j->jid   = 0;
-    j->pid   = 0;
-    j->pgid  = 0;
-    j->state = UNDEF;
-    j->cmd[0] = '\0';
-
+    series_release(j->series);
+    j->series = NULL;
+    release_slot(j);
     return 0;
 }
 
@@ -173,20 +405,73 @@ const char *state_to_str(job_state s)
         case RUNNING: return "Running";
         case STOPPED: return "Stopped";
         case FG:      return "Foreground";
+        case PAUSED:  return "Paused";
+        case DONE:    return "Done";
+        case PENDING: return "Pending";
         default:      return "Undefined";
     }
 }
 
+/* convertit la classe de priorité en texte */
+const char *class_to_str(job_class c)
+{
+    switch (c) {
+        case CLASS_BATCH: return "batch";
+        case CLASS_LOW:   return "low";
+        default:          return "normal";
+    }
+}
+
 /* affiche tous les jobs actifs */
 void list_jobs(void)
 {
-    for (int i = 0; i < MAXJOBS; i++) {
-        if (jobs[i].jid != 0) {
-            printf("[%d] %d %s %s\n",
-                   jobs[i].jid,
-                   (int) jobs[i].pid,
-                   state_to_str(jobs[i].state),
-                   jobs[i].cmd);
+    long long now = timers_now();
+
+    for (job_t *j = first_job(), *next; j; j = next) {
+        next = next_job(j);
+
+        printf("[%d] %d %s ",
+               j->jid,
+               (int) j->pid,
+               state_to_str(j->state));
+
+        // un job distant : la machine, un job épinglé : ses cœurs,
+        // la classe si ce n'est pas normal, le poids sous gang, et le
+        // temps avant le signal de timeout (ou avant le SIGKILL), les
+        // statistiques d'une série every, et les jobs qu'attend un after
+        if (j->host[0])
+            printf("@%s ", j->host);
+        for (int k = 0; k < j->npin; k++)
+            printf("%s%d%s", k == 0 ? "pin:" : ",", j->pin[k],
+                   k == j->npin - 1 ? " " : "");
+        if (j->cls != CLASS_NORMAL)
+            printf("prio:%s ", class_to_str(j->cls));
+        if (j->weight != 1)
+            printf("weight:%d ", j->weight);
+        if (j->deadline) {
+            long long left = j->deadline - now;
+            printf("%s:%.1fs ", j->timed_out ? "kill" : "timeout",
+                   (left > 0 ? left : 0) / 1000.0);
+        }
+        if (j->series) {
+            char stats[128];
+            series_format(j->series, stats, sizeof(stats));
+            printf("%s ", stats);
+        }
+        if (j->state == PENDING) {
+            printf("%s", j->ok_only ? "after-ok" : "after");
+            for (int k = 0, first = 1; k < j->ndeps; k++) {
+                if (!j->deps[k]) continue;
+                printf("%s%%%d", first ? ":" : ",", j->deps[k]);
+                first = 0;
+            }
+            printf(" ");
         }
+
+        printf("%s\n", j->cmd);
+
+        // fini et pas encore repris par wait : on ne le montre qu'une fois
+        if (j->state == DONE)
+            delete_job_by_jid(j->jid);
     }
-}
\ No newline at end of file
+}
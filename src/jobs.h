@@ -4,17 +4,44 @@
 #include <sys/types.h>
 
 /* ── Quelques constantes utiles ── */
-#define MAXJOBS  10       /* On limite volontairement le nombre de jobs */
+#define MAXJOBS 4096      /* Jobs à la fois (after en garde beaucoup en
+                             attente). Rien ne parcourt tout le tableau :
+                             voir first_job() et get_job_by_pid()      */
 #define MAXCMD  256       /* Taille max qu’on garde pour une commande   */
+#define MAXPROCS 32       /* Nombre max de processus dans un même job   */
+#define MAXHOST  64       /* Taille max de "machine:port" d’un agent    */
+#define MAXPIN    8       /* Nombre max de cœurs réservés pour un job   */
+#define MAXDEPS   8       /* Nombre max de jobs attendus par after      */
 
 /* ── Les différents états possibles d’un job ── */
 typedef enum {
     UNDEF   = 0,  /* Case vide ou pas encore utilisée */
     RUNNING = 1,  /* Le job tourne (en arrière-plan en général) */
     STOPPED = 2,  /* Mis en pause (genre Ctrl+Z) */
-    FG      = 3   /* En train de s’exécuter au premier plan */
+    FG      = 3,  /* En train de s’exécuter au premier plan */
+    PAUSED  = 4,  /* Suspendu par l’ordonnanceur (gang, voir gang.h) :
+                     pour l’utilisateur, il tourne toujours */
+    DONE    = 5,  /* Fini, gardé pour wait qui rendra son code (voir
+                     waitjob.h) */
+    PENDING = 6   /* Attend la fin d’autres jobs pour partir (after, voir
+                     after.h) : pas encore de processus */
 } job_state;
 
+/* ── Classes de priorité (voir prio.h) ── */
+typedef enum {
+    CLASS_NORMAL = 0,  /* Comme le shell */
+    CLASS_BATCH  = 1,  /* &batch : calcul long, passe après le reste */
+    CLASS_LOW    = 2   /* &low : seulement quand la machine est libre */
+} job_class;
+
+struct series;             /* every (voir every.h) */
+
+/* ── Une arête du graphe de after : la k-ième dépendance du job jid ── */
+struct edge {
+    int jid;                   /* 0 : pas d’arête (fin de liste) */
+    int k;
+};
+
 /* ── Représentation d’un job ── */
 typedef struct {
     int        jid;          /* Identifiant interne du job (0 = libre) */
@@ -22,6 +49,42 @@ typedef struct {
     pid_t      pgid;         /* Groupe de processus associé */
     job_state  state;        /* Où en est le job actuellement */
     char       cmd[MAXCMD];  /* La commande telle qu’elle a été tapée */
+    int        nprocs;           /* Nombre de processus encore vivants */
+    pid_t      procs[MAXPROCS];  /* Leurs pids : étages du pipeline,
+                                    <(...) et >(...) compris */
+    pid_t      last;         /* Dernier étage du pipeline : donne le $? */
+    int        status;       /* Son status (waitpid) une fois terminé */
+    char       host[MAXHOST];    /* Agent qui fait tourner le job (&@),
+                                    "" pour un job local */
+    int        npin;             /* Cœurs réservés (&pin, voir cpumap.h) */
+    int        pin[MAXPIN];
+    job_class  cls;              /* Classe de priorité */
+    int        dimmed;           /* Baissé le temps d’une commande au
+                                    premier plan (set autolow) */
+    int        weight;           /* Part du processeur sous gang (-w) */
+    double     vtime;            /* Temps virtuel (gang.c) */
+    int        managed;          /* vtime a un sens (gang.c) */
+    int        waited;           /* Attendu par wait : pas de Done à la
+                                    fin, il passe dans l’état DONE */
+    long long  deadline;         /* Échéance de timeout (timers_now(), en
+                                    ms), 0 : aucune. Après le signal :
+                                    celle du SIGKILL */
+    int        deadline_sig;     /* Signal à l’échéance (-s) */
+    long       kill_after;       /* Puis SIGKILL après (-k, en ms) */
+    int        timed_out;        /* Le signal est parti : code 124 */
+    struct series *series;       /* Statistiques d’une série every,
+                                    NULL sinon */
+    int        ndeps;            /* after : jobs attendus (voir after.h) */
+    int        deps[MAXDEPS];    /* Leurs jids, 0 une fois finis */
+    struct edge next_edge[MAXDEPS]; /* Arête suivante dans la liste des
+                                       jobs qui attendent deps[k] */
+    struct edge dependents;      /* Première arête vers ce job : la liste
+                                    des jobs qui l’attendent */
+    int        nwaiting;         /* Jobs attendus pas encore finis */
+    int        ok_only;          /* --ok : seulement s’ils ont réussi */
+    int        dep_failed;       /* L’un d’eux a échoué */
+    char      *pending;          /* Commande à lancer (PENDING), NULL
+                                    sinon */
 } job_t;
 
 /* ── Tableau global qui contient tous les jobs ── */
@@ -35,10 +98,30 @@ void init_jobs(void);
 /* Cherche une place libre dans le tableau (-1 si c’est plein) */
 int  first_free_slot(void);
 
+/* Les jobs présents, par jid croissant, sans passer par les cases
+   libres : for (job_t *j = first_job(); j; j = next_job(j)).
+   SIGCHLD doit être bloqué (le handler retire les jobs finis) */
+job_t *first_job(void);
+job_t *next_job(job_t *j);
+
+/* Nombre de jobs dans le tableau */
+int  count_jobs(void);
+
+/* Nombre de jobs qui tournent chez l’agent host */
+int  count_host_jobs(const char *host);
+
 /* Ajoute un job dans le tableau
    → retourne son jid si ça marche, sinon -1 */
 int  add_job(pid_t pid, pid_t pgid, job_state state, const char *cmd);
 
+/* Ajoute un processus de plus (même groupe) au job jid
+   → 0 si ça marche, sinon -1 */
+int  add_job_proc(int jid, pid_t pid);
+
+/* Retire pid (qui vient de se terminer) des processus de son job
+   → nombre de processus du job encore vivants */
+int  job_proc_exited(job_t *j, pid_t pid);
+
 /* Supprime un job à partir de son pid */
 int  delete_job_by_pid(pid_t pid);
 
@@ -48,19 +131,31 @@ int  delete_job_by_jid(int jid);
 /* Récupère le job actuellement au premier plan (ou NULL s’il n’y en a pas) */
 job_t *get_fg_job(void);
 
-/* Cherche un job avec son pid */
+/* Met j au premier plan (fg) : c’est lui que get_fg_job() rendra */
+void  set_fg_job(job_t *j);
+
+/* Cherche un job avec le pid d’un de ses processus encore vivants, ou
+   son pid principal (par une table de hachage : le handler SIGCHLD ne
+   parcourt pas le tableau) */
 job_t *get_job_by_pid(pid_t pid);
 
-/* Cherche un job avec son jid */
+/* Cherche un job avec son jid (sans parcourir le tableau) */
 job_t *get_job_by_jid(int jid);
 
+/* Donne au job j le jid libre jid */
+void  renumber_job(job_t *j, int jid);
+
 /* Permet d’accepter soit "%3" (jid), soit "1234" (pid) */
 job_t *get_job_by_id_str(const char *id_str);
 
-/* Affiche tous les jobs (comme la commande jobs du shell) */
+/* Affiche tous les jobs (comme la commande jobs du shell), SIGCHLD
+   bloqué */
 void  list_jobs(void);
 
 /* Convertit un état en texte lisible */
 const char *state_to_str(job_state s);
 
+/* Pareil pour une classe de priorité */
+const char *class_to_str(job_class c);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,485 @@
+/*
+ * Éditeur de ligne (voir lineedit.h).
+ *
+ * La ligne est un tampon d'octets (de l'UTF-8) : le curseur se déplace
+ * d'un caractère à la fois en sautant les octets de suite (10xxxxxx),
+ * qui ne prennent pas de colonne. Un caractère de contrôle (un '\n'
+ * d'une commande de l'historique) s'affiche ^J, sur deux colonnes.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+#include <termios.h>
+#include <sys/ioctl.h>
+#include "csapp.h"
+#include "timers.h"
+#include "history.h"
+#include "complete.h"
+#include "vars.h"
+#include "lineedit.h"
+
+#define LIST_MAX 200            /* candidats montrés par Tab Tab */
+
+/* touches reconnues dans les séquences d'échappement */
+enum {
+    KEY_UP = 256, KEY_DOWN, KEY_LEFT, KEY_RIGHT, KEY_HOME, KEY_END,
+    KEY_DELETE, KEY_NONE,
+};
+
+static struct {
+    char       *buf;            /* la ligne, terminée par '\0' */
+    size_t      len, size;
+    size_t      pos;            /* le curseur */
+    size_t      first;          /* premier octet affiché (défilement) */
+    const char *prompt;
+} ed;
+
+/* octets lus mais pas encore traités (un collage de plusieurs lignes
+   est gardé pour les appels suivants) */
+static unsigned char pending[4096];
+static size_t pstart = 0, pend = 0;
+
+/* ce qui part dans le write d'un affichage */
+static char *out = NULL;
+static size_t out_len = 0, out_size = 0;
+
+static struct termios cooked;
+
+int lineedit_usable(void) {
+    const char *term = var_get("TERM");
+
+    return isatty(STDIN_FILENO) && isatty(STDOUT_FILENO) &&
+           !(term && strcmp(term, "dumb") == 0);
+}
+
+static int is_cont(unsigned char c) {
+    return (c & 0xc0) == 0x80;
+}
+
+static int is_ctl(unsigned char c) {
+    return c < 32 || c == 127;
+}
+
+static size_t next_char(size_t i) {
+    if (i < ed.len) i++;
+    while (i < ed.len && is_cont(ed.buf[i])) i++;
+    return i;
+}
+
+static size_t prev_char(size_t i) {
+    if (i > 0) i--;
+    while (i > 0 && is_cont(ed.buf[i])) i--;
+    return i;
+}
+
+/* colonnes prises par les n octets de s */
+static int width(const char *s, size_t n) {
+    int w = 0;
+
+    for (size_t i = 0; i < n; i++) {
+        unsigned char c = s[i];
+        w += is_ctl(c) ? 2 : !is_cont(c);
+    }
+    return w;
+}
+
+static void out_add(const char *s, size_t n) {
+    if (out_len + n > out_size) {
+        out_size = 2 * (out_len + n);
+        out = Realloc(out, out_size);
+    }
+    memcpy(out + out_len, s, n);
+    out_len += n;
+}
+
+static void out_str(const char *s) {
+    out_add(s, strlen(s));
+}
+
+static void out_flush(void) {
+    const char *p = out;
+    size_t n = out_len;
+
+    /* ce que printf a encore (un message de fin de job) passe avant */
+    fflush(stdout);
+    while (n > 0) {
+        ssize_t w = write(STDOUT_FILENO, p, n);
+        if (w < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        p += w;
+        n -= w;
+    }
+    out_len = 0;
+}
+
+static int term_cols(void) {
+    struct winsize ws;
+
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == 0 && ws.ws_col > 0)
+        return ws.ws_col;
+    return 80;
+}
+
+/* réaffiche le prompt et la ligne, le curseur à sa place : un write */
+static void render(void) {
+    int plen = width(ed.prompt, strlen(ed.prompt));
+    int room = term_cols() - plen - 1;
+    if (room < 8) room = 8;
+
+    /* trop large : on fait défiler pour garder le curseur visible */
+    if (width(ed.buf, ed.len) <= room) ed.first = 0;
+    if (ed.pos < ed.first) ed.first = ed.pos;
+    while (width(ed.buf + ed.first, ed.pos - ed.first) > room)
+        ed.first = next_char(ed.first);
+
+    out_str("\r");
+    out_str(ed.prompt);
+    int w = 0;
+    for (size_t i = ed.first; i < ed.len; i++) {
+        unsigned char c = ed.buf[i];
+        int cw = is_ctl(c) ? 2 : !is_cont(c);
+        if (w + cw > room) break;
+        w += cw;
+        if (is_ctl(c)) {
+            char ctl[2] = { '^', c ^ 0x40 };
+            out_add(ctl, 2);
+        } else {
+            out_add((char *)&c, 1);
+        }
+    }
+    out_str("\033[K\r");
+
+    int col = plen + width(ed.buf + ed.first, ed.pos - ed.first);
+    if (col > 0) {
+        char move[16];
+        snprintf(move, sizeof(move), "\033[%dC", col);
+        out_str(move);
+    }
+    out_flush();
+}
+
+static void bell(void) {
+    out_str("\a");
+    out_flush();
+}
+
+/* l'octet suivant du terminal, -1 en fin d'entrée. en attendant, les
+   timers du shell tournent */
+static int read_byte(void) {
+    while (pstart == pend) {
+        struct pollfd p[2];
+        int n = 1, tfd = timers_fd();
+
+        p[0].fd = STDIN_FILENO;
+        p[0].events = POLLIN;
+        if (tfd >= 0) {
+            p[1].fd = tfd;
+            p[1].events = POLLIN;
+            n = 2;
+        }
+        if (poll(p, n, -1) < 0) {
+            if (errno != EINTR) return -1;
+            /* SIGCHLD : le handler a pu écrire par-dessus la ligne */
+            render();
+            continue;
+        }
+        if (n == 2 && (p[1].revents & POLLIN)) timers_run();
+        if (!p[0].revents) continue;
+
+        ssize_t r = read(STDIN_FILENO, pending, sizeof(pending));
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0) return -1;
+        pstart = 0;
+        pend = r;
+    }
+    return pending[pstart++];
+}
+
+/* une touche : un octet, ou une des KEY_ pour une séquence ESC [ ... */
+static int read_key(void) {
+    int c = read_byte();
+    if (c != 27) return c;
+
+    int c2 = read_byte();
+    if (c2 != '[' && c2 != 'O') return c2 < 0 ? -1 : KEY_NONE;
+
+    int c3 = read_byte();
+    if (c3 >= '0' && c3 <= '9') {
+        /* ESC [ n ~ */
+        int c4;
+        while ((c4 = read_byte()) >= '0' && c4 <= '9') {
+        }
+        if (c4 != '~') return KEY_NONE;
+        switch (c3) {
+        case '1': case '7': return KEY_HOME;
+        case '4': case '8': return KEY_END;
+        case '3':           return KEY_DELETE;
+        }
+        return KEY_NONE;
+    }
+    switch (c3) {
+    case 'A': return KEY_UP;
+    case 'B': return KEY_DOWN;
+    case 'C': return KEY_RIGHT;
+    case 'D': return KEY_LEFT;
+    case 'H': return KEY_HOME;
+    case 'F': return KEY_END;
+    }
+    return c3 < 0 ? -1 : KEY_NONE;
+}
+
+static void reserve(size_t n) {
+    if (ed.len + n + 1 > ed.size) {
+        ed.size = 2 * (ed.len + n + 1);
+        ed.buf = Realloc(ed.buf, ed.size);
+    }
+}
+
+static void insert(const char *s, size_t n) {
+    reserve(n);
+    memmove(ed.buf + ed.pos + n, ed.buf + ed.pos, ed.len - ed.pos + 1);
+    memcpy(ed.buf + ed.pos, s, n);
+    ed.pos += n;
+    ed.len += n;
+}
+
+/* efface les octets [from, to) */
+static void erase(size_t from, size_t to) {
+    memmove(ed.buf + from, ed.buf + to, ed.len - to + 1);
+    ed.len -= to - from;
+    if (ed.pos > to) ed.pos -= to - from;
+    else if (ed.pos > from) ed.pos = from;
+}
+
+/* la ligne devient les n octets de s (une commande de l'historique) */
+static void set_line(const char *s, size_t n) {
+    ed.len = 0;
+    reserve(n);
+    for (size_t i = 0; i < n; i++)
+        ed.buf[i] = s[i] == HISTORY_NEWLINE ? '\n' : s[i];
+    ed.buf[n] = '\0';
+    ed.len = ed.pos = n;
+}
+
+static int is_sep(char c) {
+    return c && strchr(" \t\n;|&<>()", c);
+}
+
+/* vrai si un mot qui commence en start est le nom d'une commande */
+static int command_position(size_t start) {
+    static const char *keywords[] = {
+        "then", "do", "else", "elif", "if", "while", "!",
+    };
+    size_t i = start;
+
+    while (i > 0 && (ed.buf[i - 1] == ' ' || ed.buf[i - 1] == '\t')) i--;
+    if (i == 0 || strchr(";|&(\n", ed.buf[i - 1])) return 1;
+
+    size_t end = i;
+    while (i > 0 && !is_sep(ed.buf[i - 1])) i--;
+    for (size_t k = 0; k < sizeof(keywords) / sizeof(keywords[0]); k++)
+        if (end - i == strlen(keywords[k]) &&
+            strncmp(ed.buf + i, keywords[k], end - i) == 0)
+            return 1;
+    return 0;
+}
+
+/* Tab Tab : les candidats sous la ligne, en colonnes */
+static void list(const struct completion *c) {
+    int cols = term_cols(), wide = 0;
+
+    for (int i = 0; i < c->nnames; i++) {
+        int w = width(c->names[i], strlen(c->names[i]));
+        if (w > wide) wide = w;
+    }
+    wide += 2;
+    int per_row = cols / wide > 0 ? cols / wide : 1;
+
+    out_str("\n");
+    for (int i = 0; i < c->nnames; i++) {
+        out_str(c->names[i]);
+        if ((i + 1) % per_row == 0 || i == c->nnames - 1) {
+            out_str("\n");
+        } else {
+            int pad = wide - width(c->names[i], strlen(c->names[i]));
+            for (int k = 0; k < pad; k++) out_str(" ");
+        }
+    }
+    if (c->n > c->nnames) {
+        char more[64];
+        snprintf(more, sizeof(more), "... (%d en tout)\n", c->n);
+        out_str(more);
+    }
+    out_flush();
+}
+
+/* Tab sur le mot qui finit au curseur. again : Tab juste avant */
+static void complete(int again) {
+    size_t start = ed.pos;
+    while (start > 0 && !is_sep(ed.buf[start - 1])) start--;
+
+    char *word = strndup(ed.buf + start, ed.pos - start);
+    enum complete_kind kind = COMPLETE_FILE;
+    if (word[0] == '%') kind = COMPLETE_JOB;
+    else if (command_position(start)) kind = COMPLETE_COMMAND;
+
+    struct completion c;
+    complete_word(word, kind, LIST_MAX, &c);
+    free(word);
+
+    if (c.n == 0) {
+        bell();
+    } else if (c.n == 1) {
+        /* le seul candidat, en entier, et de quoi continuer */
+        insert(c.common, strlen(c.common));
+        insert(c.dir ? "/" : " ", 1);
+    } else if (c.common[0]) {
+        insert(c.common, strlen(c.common));
+    } else if (again) {
+        list(&c);
+    } else {
+        bell();
+    }
+    completion_free(&c);
+}
+
+char *lineedit_read(const char *prompt) {
+    struct termios raw;
+
+    if (tcgetattr(STDIN_FILENO, &cooked) < 0) return NULL;
+    raw = cooked;
+    raw.c_lflag &= ~(ICANON | ECHO | ISIG | IEXTEN);
+    raw.c_iflag &= ~(ICRNL | IXON);
+    raw.c_cc[VMIN] = 1;
+    raw.c_cc[VTIME] = 0;
+    tcsetattr(STDIN_FILENO, TCSADRAIN, &raw);
+
+    ed.prompt = prompt;
+    ed.len = ed.pos = ed.first = 0;
+    reserve(0);
+    ed.buf[0] = '\0';
+
+    /* l'historique : hist est la commande affichée, nhist la ligne en
+       cours d'écriture (gardée dans draft) */
+    int hist = -1, nhist = 0, tab = 0;
+    char *draft = NULL;
+    enum { EDITING, ENTER, CANCEL, END } state = EDITING;
+
+    render();
+    while (state == EDITING) {
+        int c = read_key();
+        int again = tab;
+        tab = 0;
+
+        switch (c) {
+        case -1:
+            state = END;
+            break;
+        case '\r': case '\n':
+            state = ENTER;
+            break;
+        case CTRL('C'):
+            state = CANCEL;
+            break;
+        case CTRL('D'):
+            if (ed.len == 0) state = END;
+            else if (ed.pos < ed.len) erase(ed.pos, next_char(ed.pos));
+            break;
+        case KEY_DELETE:
+            if (ed.pos < ed.len) erase(ed.pos, next_char(ed.pos));
+            break;
+        case 127: case CTRL('H'):
+            if (ed.pos > 0) erase(prev_char(ed.pos), ed.pos);
+            break;
+        case CTRL('A'): case KEY_HOME:
+            ed.pos = 0;
+            break;
+        case CTRL('E'): case KEY_END:
+            ed.pos = ed.len;
+            break;
+        case CTRL('B'): case KEY_LEFT:
+            ed.pos = prev_char(ed.pos);
+            break;
+        case CTRL('F'): case KEY_RIGHT:
+            ed.pos = next_char(ed.pos);
+            break;
+        case CTRL('K'):
+            erase(ed.pos, ed.len);
+            break;
+        case CTRL('U'):
+            erase(0, ed.pos);
+            break;
+        case CTRL('W'): {
+            size_t i = ed.pos;
+            while (i > 0 && ed.buf[i - 1] == ' ') i--;
+            while (i > 0 && ed.buf[i - 1] != ' ') i--;
+            erase(i, ed.pos);
+            break;
+        }
+        case CTRL('L'):
+            out_str("\033[H\033[2J");
+            break;
+        case CTRL('P'): case KEY_UP:
+            if (hist < 0) {
+                nhist = hist = history_count();
+                draft = strdup(ed.buf);
+            }
+            if (hist > 0) {
+                size_t n;
+                const char *e = history_entry(hist - 1, &n);
+                if (e) {
+                    hist--;
+                    set_line(e, n);
+                }
+            }
+            break;
+        case CTRL('N'): case KEY_DOWN:
+            if (hist >= 0 && hist < nhist - 1) {
+                size_t n;
+                const char *e = history_entry(hist + 1, &n);
+                if (e) {
+                    hist++;
+                    set_line(e, n);
+                }
+            } else if (hist >= 0 && hist == nhist - 1) {
+                hist = nhist;
+                set_line(draft, strlen(draft));
+            }
+            break;
+        case '\t':
+            complete(again);
+            tab = 1;
+            break;
+        default:
+            if (c < 256 && !is_ctl(c)) {
+                char b = c;
+                insert(&b, 1);
+            }
+            break;
+        }
+
+        /* un collage : on n'affiche qu'à la fin de ce qui est arrivé */
+        if (state == EDITING && pstart == pend) render();
+    }
+
+    /* le curseur en fin de ligne, pour passer à la suivante */
+    if (state != END) {
+        ed.pos = ed.len;
+        render();
+        out_str(state == CANCEL ? "^C\n" : "\n");
+        out_flush();
+    }
+    if (state == CANCEL) {
+        ed.len = 0;
+        ed.buf[0] = '\0';
+    }
+    tcsetattr(STDIN_FILENO, TCSADRAIN, &cooked);
+    free(draft);
+    return state == END ? NULL : ed.buf;
+}
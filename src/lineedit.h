@@ -0,0 +1,31 @@
+#ifndef __LINEEDIT_H__
+#define __LINEEDIT_H__
+
+/* ── Éditeur de ligne ──
+   Quand l’entrée et la sortie du shell sont un terminal, les commandes
+   sont lues par lineedit_read au lieu de readcmd_line : le terminal est
+   en mode brut le temps de taper la ligne, et remis comme avant pour
+   l’exécuter.
+
+   Touches : flèches gauche / droite, Début / Fin (ou Ctrl-B / F / A / E)
+   pour se déplacer ; Retour arrière, Suppr, Ctrl-K / U / W pour effacer
+   (jusqu’à la fin, jusqu’au début, le mot d’avant) ; flèches haut / bas
+   (ou Ctrl-P / N) pour parcourir l’historique (voir history.h) ; Tab
+   pour compléter (voir complete.h), deux fois pour lister les
+   candidats ; Ctrl-L pour effacer l’écran ; Ctrl-C pour abandonner la
+   ligne ; Ctrl-D sur une ligne vide pour la fin de l’entrée.
+
+   Chaque affichage de la ligne (prompt, texte, curseur) part en un seul
+   write. Une ligne plus large que le terminal défile horizontalement
+   autour du curseur. En attendant une touche, le shell fait tourner ses
+   timers (voir timers.h), comme readcmd ; la ligne est réaffichée quand
+   un signal (la fin d’un job) a pu écrire par-dessus. */
+
+/* Vrai si l’entrée et la sortie sont un terminal qu’on sait éditer */
+int   lineedit_usable(void);
+
+/* Lit une ligne sur le terminal en l’éditant, après prompt → la ligne,
+   sans '\n', valable jusqu’à l’appel suivant ; NULL en fin d’entrée */
+char *lineedit_read(const char *prompt);
+
+#endif
@@ -0,0 +1,422 @@
+/*
+ * memo (voir memo.h).
+ *
+ * Une entrée : la ligne MAGIC, la clé en texte terminée par '\0', puis
+ * la sortie telle quelle. Elle est écrite sous un nom temporaire
+ * (HASH.PID.tmp) et renommée à la fin : une entrée visible est toujours
+ * complète, même si deux shells gardent la même commande en même temps.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <signal.h>
+#include <stdint.h>
+#include <dirent.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "csapp.h"
+#include "exec.h"
+#include "vars.h"
+#include "memo.h"
+
+#define MAGIC "tpshell-memo 1\n"
+#define MAXOPT 16                   /* -d et -e, chacun */
+
+struct memo {
+    struct cmdline *l;
+    char           *dir;
+    char            name[17];       /* le hachage de la clé, en hexa */
+    char           *key;
+    size_t          limit;          /* au-delà, la sortie n'est pas gardée */
+};
+
+/* ajoute s à la fin de *buf (de taille *size) */
+static void append(char **buf, size_t *size, const char *s) {
+    size_t len = *buf ? strlen(*buf) : 0, n = strlen(s);
+
+    if (len + n + 1 > *size) {
+        *size = 2 * (len + n + 1);
+        *buf = Realloc(*buf, *size);
+        if (len == 0) (*buf)[0] = '\0';
+    }
+    memcpy(*buf + len, s, n + 1);
+}
+
+/* FNV-1a 64 bits */
+static uint64_t hash(const char *s) {
+    uint64_t h = 0xcbf29ce484222325ULL;
+
+    for (; *s; s++) {
+        h ^= (unsigned char)*s;
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+/* "var NAME=valeur" ou "var NAME" si elle n'existe pas */
+static void key_var(char **key, size_t *size, const char *name) {
+    const char *v = var_get(name);
+
+    append(key, size, "var ");
+    append(key, size, name);
+    if (v) {
+        append(key, size, "=");
+        append(key, size, v);
+    }
+    append(key, size, "\n");
+}
+
+/* ce qui identifie le contenu de path, sans le lire */
+static void key_file(char **key, size_t *size, const char *what,
+                     const char *path) {
+    struct stat st;
+    char buf[128];
+
+    append(key, size, what);
+    append(key, size, path);
+    if (stat(path, &st) < 0) {
+        append(key, size, " absent\n");
+        return;
+    }
+    snprintf(buf, sizeof(buf), " %lu:%lu %lld %lld.%09ld\n",
+             (unsigned long)st.st_dev, (unsigned long)st.st_ino,
+             (long long)st.st_size, (long long)st.st_mtim.tv_sec,
+             st.st_mtim.tv_nsec);
+    append(key, size, buf);
+}
+
+static char *make_key(struct cmdline *l, char **deps, int ndeps,
+                      char **envs, int nenvs) {
+    char *key = NULL, cwd[4096];
+    size_t size = 0;
+
+    for (int i = 0; l->seq[i]; i++) {
+        append(&key, &size, i == 0 ? "cmd" : "|");
+        for (int k = 0; l->seq[i][k]; k++) {
+            /* la longueur d'abord : "a b" n'est pas "a" "b" */
+            char n[24];
+            snprintf(n, sizeof(n), " %zu:", strlen(l->seq[i][k]));
+            append(&key, &size, n);
+            append(&key, &size, l->seq[i][k]);
+        }
+        append(&key, &size, "\n");
+        if (i < l->nassign && l->assign[i])
+            for (char **a = l->assign[i]; *a; a++) {
+                append(&key, &size, "set ");
+                append(&key, &size, *a);
+                append(&key, &size, "\n");
+            }
+    }
+
+    append(&key, &size, "cwd ");
+    append(&key, &size, getcwd(cwd, sizeof(cwd)) ? cwd : "?");
+    append(&key, &size, "\n");
+
+    /* MEMO_ENV est découpée dans une copie */
+    const char *list = var_get("MEMO_ENV");
+    char *copy = strdup(list ? list : "PATH LANG LC_ALL");
+    for (char *save, *v = strtok_r(copy, " \t", &save); v;
+         v = strtok_r(NULL, " \t", &save))
+        key_var(&key, &size, v);
+    free(copy);
+    for (int k = 0; k < nenvs; k++) key_var(&key, &size, envs[k]);
+
+    if (l->in) key_file(&key, &size, "in ", l->in);
+    for (int k = 0; k < ndeps; k++) key_file(&key, &size, "dep ", deps[k]);
+    return key;
+}
+
+/* crée dir et ceux qui manquent au-dessus → 0, -1 si erreur */
+static int make_dirs(char *dir) {
+    for (char *p = dir + 1; *p; p++) {
+        if (*p != '/') continue;
+        *p = '\0';
+        int r = mkdir(dir, 0700);
+        *p = '/';
+        if (r < 0 && errno != EEXIST) return -1;
+    }
+    return mkdir(dir, 0700) < 0 && errno != EEXIST ? -1 : 0;
+}
+
+static char *path_of(const char *dir, const char *name) {
+    char *path = Malloc(strlen(dir) + strlen(name) + 2);
+    sprintf(path, "%s/%s", dir, name);
+    return path;
+}
+
+/* tout n jusqu'au bout (un tube plein, un signal) → 0, -1 si erreur */
+static int write_all(int fd, const char *buf, size_t n) {
+    while (n > 0) {
+        ssize_t w = write(fd, buf, n);
+        if (w < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        buf += w;
+        n -= w;
+    }
+    return 0;
+}
+
+/* la sortie de l'entrée de m vers out → 0, -1 s'il n'y en a pas */
+static int replay(struct memo *m) {
+    char *path = path_of(m->dir, m->name);
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    free(path);
+    if (fd < 0) return -1;
+
+    struct stat st;
+    size_t head = strlen(MAGIC) + strlen(m->key) + 1;
+    if (fstat(fd, &st) < 0 || (size_t)st.st_size < head) {
+        close(fd);
+        return -1;
+    }
+    char *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) {
+        close(fd);
+        return -1;
+    }
+    /* même hachage ne veut pas dire même clé */
+    if (memcmp(data, MAGIC, strlen(MAGIC)) != 0 ||
+        memcmp(data + strlen(MAGIC), m->key, strlen(m->key) + 1) != 0) {
+        munmap(data, st.st_size);
+        close(fd);
+        return -1;
+    }
+
+    int out = STDOUT_FILENO;
+    if (m->l->out) {
+        out = open(m->l->out, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+        if (out < 0) perror(m->l->out);
+    }
+    fflush(stdout);
+    if (out >= 0) {
+        write_all(out, data + head, st.st_size - head);
+        if (out != STDOUT_FILENO) close(out);
+    }
+
+    /* la date de modification dit quand l'entrée a servi */
+    futimens(fd, NULL);
+    munmap(data, st.st_size);
+    close(fd);
+    return 0;
+}
+
+struct entry {
+    char     *path;
+    off_t     size;
+    long long used;     /* date de modification, en ns */
+};
+
+static int by_use(const void *a, const void *b) {
+    const struct entry *x = a, *y = b;
+    return x->used < y->used ? -1 : x->used > y->used;
+}
+
+/* efface les entrées les moins récemment utilisées jusqu'à ce que le
+   total tienne dans max, et ce que des sous-shells disparus ont laissé */
+static void evict(const char *dir, size_t max) {
+    DIR *d = opendir(dir);
+    if (!d) return;
+
+    struct entry *e = NULL;
+    int n = 0, esize = 0;
+    size_t total = 0;
+    struct dirent *de;
+
+    while ((de = readdir(d))) {
+        if (de->d_name[0] == '.') continue;
+        char *path = path_of(dir, de->d_name);
+        struct stat st;
+
+        /* seulement nos entrées : MEMO_DIR peut contenir autre chose */
+        int ours = strspn(de->d_name, "0123456789abcdef") == 16;
+        if (ours && de->d_name[16] == '.' && strstr(de->d_name, ".tmp")) {
+            /* HASH.PID.tmp : à effacer si PID n'existe plus */
+            pid_t pid = atoi(de->d_name + 17);
+            if (pid > 0 && kill(pid, 0) < 0 && errno == ESRCH) unlink(path);
+            free(path);
+            continue;
+        }
+        if (!ours || de->d_name[16] != '\0' ||
+            stat(path, &st) < 0 || !S_ISREG(st.st_mode)) {
+            free(path);
+            continue;
+        }
+        if (n == esize) {
+            esize = esize ? 2 * esize : 64;
+            e = Realloc(e, esize * sizeof(struct entry));
+        }
+        e[n].path = path;
+        e[n].size = st.st_size;
+        e[n].used = st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+        total += st.st_size;
+        n++;
+    }
+    closedir(d);
+
+    qsort(e, n, sizeof(struct entry), by_use);
+    for (int k = 0; k < n; k++) {
+        if (total > max && unlink(e[k].path) == 0) total -= e[k].size;
+        free(e[k].path);
+    }
+    free(e);
+}
+
+/* le sous-shell : lance cmd, recopie sa sortie et la garde si elle a
+   réussi */
+static int memo_body(void *arg) {
+    struct memo *m = arg;
+    struct cmdline *l = m->l;
+
+    /* cmd tourne au premier plan du sous-shell, placée comme lui */
+    l->background = l->pin = l->prio = l->capture = 0;
+
+    /* '>' : c'est nous qui écrivons le fichier */
+    if (l->out) {
+        int fd = open(l->out, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+        if (fd < 0) {
+            perror(l->out);
+            return 1;
+        }
+        dup2(fd, STDOUT_FILENO);
+        close(fd);
+        l->out = NULL;
+    }
+
+    /* l'entrée en cours d'écriture (-1 : on ne la garde plus) */
+    char tmpname[64];
+    snprintf(tmpname, sizeof(tmpname), "%s.%d.tmp", m->name, (int)getpid());
+    char *tmp = path_of(m->dir, tmpname);
+    int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (fd >= 0 && (write_all(fd, MAGIC, strlen(MAGIC)) < 0 ||
+                    write_all(fd, m->key, strlen(m->key) + 1) < 0)) {
+        close(fd);
+        unlink(tmp);
+        fd = -1;
+    }
+
+    int p[2];
+    if (pipe(p) < 0) {
+        perror("memo: pipe");
+        return 1;
+    }
+    fcntl(p[0], F_SETFD, FD_CLOEXEC);
+    int jid = launch_cmdline(l, p[1], FG);
+    close(p[1]);
+    if (jid < 0) {
+        close(p[0]);
+        if (fd >= 0) {
+            close(fd);
+            unlink(tmp);
+        }
+        return 1;
+    }
+
+    static char buf[64 * 1024];
+    size_t kept = 0;
+    ssize_t r;
+    while ((r = read(p[0], buf, sizeof(buf))) != 0) {
+        if (r < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        write_all(STDOUT_FILENO, buf, r);
+        kept += r;
+        if (fd >= 0 && (kept > m->limit || write_all(fd, buf, r) < 0)) {
+            close(fd);
+            unlink(tmp);
+            fd = -1;
+        }
+    }
+    close(p[0]);
+
+    int status = wait_fg_job();
+    if (fd >= 0) {
+        char *path = path_of(m->dir, m->name);
+        if (close(fd) == 0 && status == 0 && rename(tmp, path) == 0)
+            evict(m->dir, m->limit * 4);
+        else
+            unlink(tmp);
+        free(path);
+    }
+    free(tmp);
+    return status;
+}
+
+int is_memo(struct cmdline *l) {
+    return l->seq[0] && l->seq[0][0] && strcmp(l->seq[0][0], "memo") == 0;
+}
+
+static int usage(void) {
+    fprintf(stderr, "usage: memo [-d FICHIER]... [-e VAR]... cmd\n");
+    return -1;
+}
+
+int launch_memo(struct cmdline *l, job_state state) {
+    char **w = l->seq[0];
+    char *deps[MAXOPT], *envs[MAXOPT];
+    int ndeps = 0, nenvs = 0, i = 1;
+
+    for (; w[i]; i++) {
+        if (strcmp(w[i], "-d") == 0 && w[i + 1] && ndeps < MAXOPT)
+            deps[ndeps++] = w[++i];
+        else if (strcmp(w[i], "-e") == 0 && w[i + 1] && nenvs < MAXOPT)
+            envs[nenvs++] = w[++i];
+        else if (w[i][0] == '-' && w[i][1])
+            return usage();
+        else
+            break;
+    }
+    if (!w[i]) return usage();
+
+    /* la clé avant d'enlever les mots : -d et -e pointent dedans */
+    int first = i;
+    l->seq[0] = w + first;
+    struct memo m;
+    m.l = l;
+    m.key = make_key(l, deps, ndeps, envs, nenvs);
+    snprintf(m.name, sizeof(m.name), "%016llx",
+             (unsigned long long)hash(m.key));
+    m.limit = var_get_size("MEMO_MAX", MEMO_MAX) / 4;
+    l->seq[0] = w;
+
+    /* on enlève les mots de memo (les <(...) du premier étage suivent) */
+    int rest = 0;
+    while (w[first + rest]) rest++;
+    for (int k = 0; k < first; k++) free(w[k]);
+    memmove(w, w + first, (rest + 1) * sizeof(char *));
+    for (int k = 0; k < l->nprocsub; k++)
+        if (l->procsub[k].stage == 0) l->procsub[k].arg -= first;
+
+    const char *dir = var_get("MEMO_DIR");
+    const char *home = var_get("HOME");
+    if (dir) {
+        m.dir = strdup(dir);
+    } else {
+        m.dir = Malloc(strlen(home ? home : "/tmp") + 32);
+        sprintf(m.dir, "%s/.cache/tpshell-memo", home ? home : "/tmp");
+    }
+
+    int jid = -1;
+    if (make_dirs(m.dir) < 0) {
+        fprintf(stderr, "memo: %s: %s\n", m.dir, strerror(errno));
+    } else if (replay(&m) == 0) {
+        jid = MEMO_HIT;
+    } else {
+        char cmd_str[MAXCMD] = "memo";
+        for (int k = 0; w[k] && (int)strlen(cmd_str) < MAXCMD - 2; k++) {
+            strncat(cmd_str, " ", MAXCMD - strlen(cmd_str) - 1);
+            strncat(cmd_str, w[k], MAXCMD - strlen(cmd_str) - 1);
+        }
+        jid = launch_function(cmd_str, -1, state, memo_body, &m);
+    }
+
+    free(m.key);
+    free(m.dir);
+    return jid;
+}
@@ -0,0 +1,41 @@
+#ifndef __MEMO_H__
+#define __MEMO_H__
+
+#include "readcmd.h"
+#include "jobs.h"
+
+/* ── memo [-d FICHIER]... [-e VAR]... cmd ──
+   Garde sur disque la sortie de cmd (une commande ou un pipeline : memo
+   porte sur toute la ligne, comme timeout). La clé d’une exécution est
+   faite des mots de cmd (tous les étages), du répertoire courant, de
+   quelques variables (celles de MEMO_ENV, "PATH LANG LC_ALL" par
+   défaut, celles données par -e, et les NAME=valeur de la ligne), et
+   pour le fichier de '<' et chaque FICHIER de -d : (périphérique, inode,
+   taille, date de modification). Si l’un d’eux change, la clé change.
+
+   Si une entrée a cette clé, sa sortie est rejouée par le shell, sans
+   lancer cmd (code 0). Sinon cmd est lancée dans un sous-shell (un job,
+   comme every) qui recopie sa sortie au fur et à mesure vers la sortie
+   de la ligne et vers l’entrée en cours d’écriture : elle n’est gardée
+   que si cmd a réussi. Seul stdout est gardé, stderr passe tel quel.
+
+   Les entrées sont des fichiers de MEMO_DIR ($HOME/.cache/tpshell-memo
+   par défaut), nommés par le hachage de la clé ; la clé elle-même est
+   au début du fichier et vérifiée avant de rejouer, le reste est rejoué
+   depuis un mmap. Leur date de modification est celle du dernier usage :
+   quand le total dépasse MEMO_MAX (64m par défaut, voir var_get_size),
+   les moins récemment utilisées sont effacées. Une sortie de plus du
+   quart de MEMO_MAX n’est pas gardée. */
+
+#define MEMO_MAX (64 * 1024 * 1024)
+#define MEMO_HIT 0      /* launch_memo : la sortie a été rejouée */
+
+/* Vrai si la ligne l (expansée) commence par memo */
+int  is_memo(struct cmdline *l);
+
+/* Rejoue la sortie gardée pour la ligne l, ou lance cmd dans un job
+   d’état state → MEMO_HIT, le jid, ou -1 si erreur (message déjà
+   affiché). l perd ses mots memo et options */
+int  launch_memo(struct cmdline *l, job_state state);
+
+#endif
@@ -0,0 +1,281 @@
+/*
+ * pmap : exécution parallèle d’une commande sur une liste de mots.
+ *
+ * Le shell lance un sous-shell (launch_function) qui joue le rôle de
+ * répartiteur : il produit les mots un par un, fork + exec la commande
+ * pour chacun tant qu’il y en a moins de N en cours, et sinon attend
+ * qu’une se termine. Ses fils sont dans son groupe : c’est un seul job.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <signal.h>
+#include <errno.h>
+#include <sys/wait.h>
+#include "csapp.h"
+#include "exec.h"
+#include "pmap.h"
+#include "remote.h"
+
+struct pmap {
+    char **tmpl_raw;    /* commande, mots bruts */
+    char **items_raw;   /* mots après :::, NULL : lignes de stdin */
+    char  *in, *out;    /* redirections brutes */
+    int    jobs;        /* commandes en parallèle au plus */
+    int    remote;      /* --remote : chez les agents (voir remote.h) */
+
+    char  *hosts[MAXAGENTS];
+    int    nhosts;
+    int    load[MAXAGENTS]; /* commandes en cours par agent */
+    pid_t *pids;        /* --remote : commande en cours dans chaque place */
+    int   *agent_of;    /* et son agent */
+
+    char **tmpl;        /* commande expansée (dans le répartiteur) */
+    size_t ntmpl;
+    int    running;
+    int    failed;
+};
+
+int is_pmap(struct cmdline *raw) {
+    return raw->seq[0] && raw->seq[0][0] &&
+           strcmp(raw->seq[0][0], "pmap") == 0;
+}
+
+/* attend la fin d'une commande */
+static void reap_one(struct pmap *p) {
+    int status;
+
+    pid_t pid = wait(&status);
+    if (pid < 0) {
+        p->running = 0;
+        return;
+    }
+    p->running--;
+    for (int k = 0; p->remote && k < p->jobs; k++) {
+        if (p->pids[k] == pid) {
+            p->load[p->agent_of[k]]--;
+            p->pids[k] = 0;
+            break;
+        }
+    }
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) p->failed++;
+}
+
+/* copie de t où chaque {} est remplacé par w (NULL si pas de {}) */
+static char *replace_braces(const char *t, const char *w) {
+    const char *c = strstr(t, "{}");
+    if (!c) return NULL;
+
+    size_t wlen = strlen(w), n = 0;
+    char *out = Malloc(strlen(t) + 1);
+    size_t size = strlen(t) + 1;
+
+    for (; *t; t++) {
+        if (t[0] == '{' && t[1] == '}') {
+            size += wlen;
+            out = Realloc(out, size);
+            memcpy(out + n, w, wlen);
+            n += wlen;
+            t++;
+        } else {
+            out[n++] = *t;
+        }
+    }
+    out[n] = '\0';
+    return out;
+}
+
+/* lance la commande pour le mot w, après avoir attendu une place */
+static int pmap_item(const char *w, void *arg) {
+    struct pmap *p = arg;
+    char *argv[p->ntmpl + 2];
+    int replaced = 0;
+
+    while (p->running >= p->jobs)
+        reap_one(p);
+
+    for (size_t i = 0; i < p->ntmpl; i++) {
+        argv[i] = replace_braces(p->tmpl[i], w);
+        if (argv[i]) replaced = 1;
+        else argv[i] = p->tmpl[i];
+    }
+    argv[p->ntmpl] = replaced ? NULL : (char *)w;
+    argv[p->ntmpl + 1] = NULL;
+
+    /* --remote : l'agent qui a le moins de commandes en cours */
+    int a = 0;
+    for (int k = 1; p->remote && k < p->nhosts; k++)
+        if (p->load[k] < p->load[a]) a = k;
+
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0 && p->remote) {
+        int fd = remote_send(p->hosts[a], remote_quote(argv));
+        _exit(fd < 0 ? 255 : remote_wait(fd));
+    }
+    if (pid == 0) {
+        struct cmdline l;
+        char **seq[2] = { argv, NULL };
+
+        memset(&l, 0, sizeof(l));
+        l.seq = seq;
+        /* les mots viennent de stdin : la commande ne doit pas le lire */
+        if (!p->items_raw) l.in = "/dev/null";
+        exec_in_place(&l);
+    }
+    if (pid < 0) {
+        fprintf(stderr, "pmap: fork failed\n");
+        p->failed++;
+    } else {
+        p->running++;
+        for (int k = 0; p->remote && k < p->jobs; k++) {
+            if (p->pids[k] == 0) {
+                p->pids[k] = pid;
+                p->agent_of[k] = a;
+                p->load[a]++;
+                break;
+            }
+        }
+    }
+
+    for (size_t i = 0; i < p->ntmpl; i++)
+        if (argv[i] != p->tmpl[i]) free(argv[i]);
+    return 0;
+}
+
+/* premier mot de l'expansion de raw (NULL si vide) */
+static char *expand_one(char *raw) {
+    char *words[2] = { raw, NULL };
+    char **tab = NULL;
+    size_t len = 0;
+    char *w = NULL;
+
+    expand_words(words, &tab, &len);
+    for (size_t i = 0; i < len; i++) {
+        if (i == 0) w = tab[i];
+        else free(tab[i]);
+    }
+    free(tab);
+    return w;
+}
+
+/* redirige fd vers le fichier de nom brut raw → 0, -1 si échec */
+static int redirect(char *raw, int flags, int fd) {
+    char *path = expand_one(raw);
+    int f = path ? open(path, flags, 0644) : -1;
+
+    if (f < 0) {
+        fprintf(stderr, "%s: %s\n", path ? path : raw, strerror(errno));
+        free(path);
+        return -1;
+    }
+    dup2(f, fd);
+    close(f);
+    free(path);
+    return 0;
+}
+
+/* le répartiteur, dans le sous-shell */
+static int pmap_body(void *arg) {
+    struct pmap *p = arg;
+
+    /* on attend nous-mêmes nos fils, avec wait() */
+    signal(SIGCHLD, SIG_DFL);
+
+    if (p->in && redirect(p->in, O_RDONLY, STDIN_FILENO) < 0) return 1;
+    if (p->out && redirect(p->out, O_WRONLY | O_CREAT | O_TRUNC,
+                           STDOUT_FILENO) < 0) return 1;
+
+    expand_words(p->tmpl_raw, &p->tmpl, &p->ntmpl);
+    if (p->ntmpl == 0) {
+        fprintf(stderr, "pmap: commande manquante\n");
+        return 2;
+    }
+
+    if (p->remote) {
+        p->nhosts = remote_agents(p->hosts);
+        if (p->nhosts == 0) {
+            fprintf(stderr, "pmap: aucun agent (variable AGENTS)\n");
+            return 2;
+        }
+        p->pids = Calloc(p->jobs, sizeof(pid_t));
+        p->agent_of = Calloc(p->jobs, sizeof(int));
+    }
+
+    if (p->items_raw) {
+        expand_words_each(p->items_raw, pmap_item, p);
+    } else {
+        char *line = NULL;
+        size_t size = 0;
+        ssize_t n;
+
+        while ((n = getline(&line, &size, stdin)) >= 0) {
+            if (n > 0 && line[n-1] == '\n') line[n-1] = '\0';
+            pmap_item(line, p);
+        }
+        free(line);
+    }
+
+    while (p->running > 0)
+        reap_one(p);
+    return p->failed ? 1 : 0;
+}
+
+int launch_pmap(struct cmdline *raw, job_state state) {
+    struct pmap p;
+    char **argv = raw->seq[0];
+    int i = 1;
+
+    if (raw->seq[1] != NULL) {
+        fprintf(stderr, "pmap: ne peut pas être dans un pipe\n");
+        return -1;
+    }
+
+    memset(&p, 0, sizeof(p));
+    p.jobs = sysconf(_SC_NPROCESSORS_ONLN);
+    p.in = raw->in;
+    p.out = raw->out;
+
+    for (;;) {
+        if (argv[i] && strcmp(argv[i], "--remote") == 0) {
+            p.remote = 1;
+            i++;
+        } else if (argv[i] && strncmp(argv[i], "-j", 2) == 0) {
+            char *opt = argv[i][2] ? argv[i] + 2 : argv[i+1];
+            char *n = opt ? expand_one(opt) : NULL;
+            p.jobs = n ? atoi(n) : 0;
+            free(n);
+            if (p.jobs <= 0) {
+                fprintf(stderr, "usage: pmap [-j N] [--remote] cmd args... "
+                                "[::: mots...]\n");
+                return -1;
+            }
+            i += argv[i][2] ? 1 : 2;
+        } else {
+            break;
+        }
+    }
+    if (p.jobs <= 0) p.jobs = 1;
+
+    /* la commande va jusqu'au ::: (on la coupe le temps du lancement) */
+    int sep = i;
+    while (argv[sep] && strcmp(argv[sep], ":::") != 0) sep++;
+    char *saved = argv[sep];
+    argv[sep] = NULL;
+    p.tmpl_raw = argv + i;
+    p.items_raw = saved ? argv + sep + 1 : NULL;
+
+    char cmd_str[MAXCMD] = "";
+    for (int k = 0; argv[k] && (int)strlen(cmd_str) < MAXCMD - 2; k++) {
+        if (k > 0) strncat(cmd_str, " ", MAXCMD - strlen(cmd_str) - 1);
+        strncat(cmd_str, argv[k], MAXCMD - strlen(cmd_str) - 1);
+    }
+    if (saved) strncat(cmd_str, " ::: ...", MAXCMD - strlen(cmd_str) - 1);
+
+    int jid = launch_function(cmd_str, -1, state, pmap_body, &p);
+    argv[sep] = saved;
+    return jid;
+}
@@ -0,0 +1,27 @@
+#ifndef __PMAP_H__
+#define __PMAP_H__
+
+#include "readcmd.h"
+#include "jobs.h"
+
+/* pmap [-j N] [--remote] cmd args... [::: mots...]
+   Lance cmd une fois par mot, au plus N à la fois (par défaut le nombre
+   de processeurs). Un {} dans les arguments est remplacé par le mot,
+   sinon le mot est ajouté à la fin. Sans :::, les mots sont les lignes de
+   l’entrée standard.
+   Les mots sont produits au fur et à mesure (voir brace.h) :
+   pmap -j 8 gzip ::: part{1..100000} ne construit jamais la liste.
+   Avec --remote, chaque commande part chez l’agent de AGENTS qui en a le
+   moins en cours (voir remote.h), au plus N à la fois au total.
+   Le tout forme un seul job (un sous-shell qui lance et attend les
+   commandes), stop / fg / bg s’appliquent à l’ensemble. */
+
+/* Vrai si la ligne brute raw est un appel à pmap */
+int is_pmap(struct cmdline *raw);
+
+/* Lance pmap sur la ligne brute (mots non expansés) comme un job d’état
+   state, sans attendre. Le job sort avec 0 si toutes les commandes ont
+   réussi, 1 sinon → jid, -1 si échec */
+int launch_pmap(struct cmdline *raw, job_state state);
+
+#endif
@@ -0,0 +1,164 @@
+/*
+ * Classes de priorité des jobs (voir prio.h).
+ *
+ * Trois réglages par classe : le nice (setpriority), la politique
+ * d'ordonnancement (sched_setscheduler) et la priorité d'E/S
+ * (ioprio_set, sans fonction dans la libc : par syscall). Les trois
+ * sont par thread. Le nice et l'E/S ont une version par groupe
+ * (PRIO_PGRP, IOPRIO_WHO_PGRP) ; pour la politique, il faut passer sur
+ * chaque thread des processus du groupe, trouvés dans /proc : un seul
+ * passage pour tous les groupes à changer.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include "prio.h"
+
+/* linux/ioprio.h */
+#define IOPRIO_CLASS_SHIFT  13
+#define IOPRIO_VALUE(class, data)  (((class) << IOPRIO_CLASS_SHIFT) | (data))
+#define IOPRIO_CLASS_NONE   0
+#define IOPRIO_CLASS_BE     2
+#define IOPRIO_CLASS_IDLE   3
+#define IOPRIO_WHO_PROCESS  1
+#define IOPRIO_WHO_PGRP     2
+
+int str_to_class(const char *s) {
+    if (strcmp(s, "normal") == 0) return CLASS_NORMAL;
+    if (strcmp(s, "batch") == 0)  return CLASS_BATCH;
+    if (strcmp(s, "low") == 0 || strcmp(s, "idle") == 0) return CLASS_LOW;
+    return -1;
+}
+
+static int set_ioprio(pid_t tid, int value) {
+    return syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, tid, value);
+}
+
+/* nice du shell au premier appel : "normal" y revient */
+static int base_nice(void) {
+    static int base = -100;
+    if (base == -100) {
+        errno = 0;
+        base = getpriority(PRIO_PROCESS, 0);
+        if (errno) base = 0;
+    }
+    return base;
+}
+
+static int class_nice(job_class c) {
+    switch (c) {
+    case CLASS_BATCH: return base_nice() + 10 < 19 ? base_nice() + 10 : 19;
+    case CLASS_LOW:   return 19;
+    default:          return base_nice();
+    }
+}
+
+static int class_policy(job_class c) {
+    switch (c) {
+    case CLASS_BATCH: return SCHED_BATCH;
+    case CLASS_LOW:   return SCHED_IDLE;
+    default:          return SCHED_OTHER;
+    }
+}
+
+static int class_ioprio(job_class c) {
+    switch (c) {
+    case CLASS_BATCH: return IOPRIO_VALUE(IOPRIO_CLASS_BE, 7);
+    case CLASS_LOW:   return IOPRIO_VALUE(IOPRIO_CLASS_IDLE, 0);
+    default:          return IOPRIO_VALUE(IOPRIO_CLASS_NONE, 0);
+    }
+}
+
+/* la classe c pour le thread tid (0 : soi-même) → 0, -1 si erreur */
+static int apply_tid(pid_t tid, job_class c) {
+    struct sched_param sp = { .sched_priority = 0 };
+    int r = 0;
+
+    if (setpriority(PRIO_PROCESS, tid, class_nice(c)) < 0) r = -1;
+    if (sched_setscheduler(tid, class_policy(c), &sp) < 0) r = -1;
+    if (set_ioprio(tid, class_ioprio(c)) < 0) r = -1;
+    return r;
+}
+
+void prio_apply_self(job_class c) {
+    if (c != CLASS_NORMAL) apply_tid(0, c);
+}
+
+static int in_set(pid_t pgid, const pid_t *pgids, int n) {
+    for (int i = 0; i < n; i++)
+        if (pgids[i] == pgid) return 1;
+    return 0;
+}
+
+/* f(tid, arg) pour chaque thread des processus des groupes pgids[0..n),
+   en un seul passage sur /proc → 0, -1 si f a échoué au moins une fois */
+static int each_thread(const pid_t *pgids, int n,
+                       int (*f)(pid_t tid, void *arg), void *arg) {
+    DIR *proc = opendir("/proc");
+    struct dirent *e;
+    int r = 0;
+
+    if (!proc) return -1;
+    while ((e = readdir(proc)) != NULL) {
+        pid_t pid = atoi(e->d_name);
+        if (pid <= 0 || !in_set(getpgid(pid), pgids, n)) continue;
+
+        char path[64];
+        snprintf(path, sizeof(path), "/proc/%d/task", (int)pid);
+        DIR *task = opendir(path);
+        if (!task) {
+            if (f(pid, arg) < 0) r = -1;
+            continue;
+        }
+        struct dirent *t;
+        while ((t = readdir(task)) != NULL) {
+            pid_t tid = atoi(t->d_name);
+            if (tid > 0 && f(tid, arg) < 0) r = -1;
+        }
+        closedir(task);
+    }
+    closedir(proc);
+    return r;
+}
+
+static int set_policy(pid_t tid, void *arg) {
+    struct sched_param sp = { .sched_priority = 0 };
+    return sched_setscheduler(tid, *(int *)arg, &sp);
+}
+
+/* le nice et l'E/S se règlent pour tout le groupe d'un coup (chaque
+   thread de chaque processus) ; la politique n'a que la version par
+   thread */
+int prio_set_pgrp(pid_t pgid, job_class c) {
+    int policy = class_policy(c), r = 0;
+
+    /* 0 voudrait dire notre propre groupe */
+    if (pgid <= 0) {
+        errno = ESRCH;
+        return -1;
+    }
+    if (setpriority(PRIO_PGRP, pgid, class_nice(c)) < 0) r = -1;
+    if (syscall(SYS_ioprio_set, IOPRIO_WHO_PGRP, pgid, class_ioprio(c)) < 0)
+        r = -1;
+    if (each_thread(&pgid, 1, set_policy, &policy) < 0) r = -1;
+    return r;
+}
+
+void prio_dim_pgrps(const pid_t *pgids, int n, int on) {
+    int policy = on ? SCHED_BATCH : SCHED_OTHER;
+    int io = on ? IOPRIO_VALUE(IOPRIO_CLASS_BE, 7)
+                : IOPRIO_VALUE(IOPRIO_CLASS_NONE, 0);
+
+    if (n == 0) return;
+    for (int i = 0; i < n; i++)
+        syscall(SYS_ioprio_set, IOPRIO_WHO_PGRP, pgids[i], io);
+    each_thread(pgids, n, set_policy, &policy);
+}
@@ -0,0 +1,37 @@
+#ifndef __PRIO_H__
+#define __PRIO_H__
+
+#include <sys/types.h>
+#include "jobs.h"
+
+/* ── Classes de priorité des jobs ──
+   cmd &batch, cmd &low, ou plus tard renice %2 batch :
+     normal  comme le shell
+     batch   nice +10, SCHED_BATCH, E/S best-effort au plus bas (7)
+     low     nice 19, SCHED_IDLE, E/S idle : ne tourne que quand
+             personne d’autre ne veut le processeur ou le disque
+   Au lancement, la classe est appliquée dans le fils avant l’exec (elle
+   passe aux processus qu’il crée). renice l’applique à tous les
+   processus du groupe du job, trouvés dans /proc.
+
+   Avec set autolow, pendant qu’une commande tourne au premier plan, les
+   jobs normal en arrière-plan passent en SCHED_BATCH et E/S
+   best-effort 7 (sans toucher au nice, qu’on ne pourrait pas remettre
+   sans privilège), et reviennent comme avant ensuite. */
+
+/* "normal", "batch", "low" (ou "idle") → classe, -1 si inconnu
+   (dans l’autre sens : class_to_str(), jobs.h) */
+int  str_to_class(const char *s);
+
+/* Dans le fils, avant exec */
+void prio_apply_self(job_class c);
+
+/* Tous les processus du groupe pgid → 0, -1 si l’un d’eux n’a pas pu
+   être changé (errno) */
+int  prio_set_pgrp(pid_t pgid, job_class c);
+
+/* set autolow : on = 1 pour baisser les n groupes pgids, 0 pour les
+   remettre (un seul passage sur /proc pour tous) */
+void prio_dim_pgrps(const pid_t *pgids, int n, int on);
+
+#endif
@@ -2,13 +2,25 @@
  * Copyright (C) 2002, Simon Nieuviarts
  */
 
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stddef.h>
 #include <stdlib.h>
 #include <errno.h>
 #include <limits.h>
+#include <stdint.h>
 #include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <poll.h>
 #include "readcmd.h"
+#include "brace.h"
+#include "wildcard.h"
+#include "scan.h"
+#include "vars.h"
+#include "jobs.h"
+
+#define VARNAME_MAX 128
 
 //affiche l'erreur et quitte le programme
 static void memory_error(void)
@@ -34,43 +46,264 @@ static void *xrealloc(void *ptr, size_t size)
 }
 
 
-/* Read a line from standard input and put it in a char[] */
-static char *readline(void)
+/* Input of the commands. The file is read by big read() chunks in buf,
+   lines are found with memchr and cut in place : no stdio, no copy and
+   no allocation per line. The buffer only grows when a line does not
+   fit, so it ends up the size of the longest line and stays there. */
+#define INPUT_CHUNK (64 * 1024)
+
+static struct {
+	int fd;
+	char *buf;
+	size_t size;
+	size_t start, end;	/* bytes not returned yet */
+	size_t scanned;		/* [start, scanned) has no newline */
+	int eof;
+} input;
+
+
+/* Timer watched while waiting for input (see readcmd_set_timer) */
+static struct {
+	int (*fd)(void);
+	void (*tick)(void);
+} timer;
+
+
+void readcmd_set_timer(int (*fd)(void), void (*tick)(void))
+{
+	timer.fd = fd;
+	timer.tick = tick;
+}
+
+
+/* Sleep until the input is readable, running the timer ticks that come
+   first. */
+static void input_wait(void)
+{
+	struct pollfd p[2];
+	int tfd;
+
+	while (timer.fd && (tfd = timer.fd()) >= 0) {
+		p[0].fd = input.fd;
+		p[0].events = POLLIN;
+		p[1].fd = tfd;
+		p[1].events = POLLIN;
+		if (poll(p, 2, -1) < 0) {
+			if (errno == EINTR) continue;	/* SIGCHLD */
+			return;
+		}
+		if (p[1].revents & POLLIN) timer.tick();
+		if (p[0].revents) return;
+	}
+}
+
+
+void readcmd_set_input(int fd)
 {
-	size_t buf_len = 16;
-	char *buf = xmalloc(buf_len * sizeof(char));
+	input.fd = fd;
+	input.start = input.end = input.scanned = 0;
+	input.eof = 0;
+}
+
+
+/* Read more input after the pending bytes. Return 0 at the end of the
+   input. */
+static int input_fill(void)
+{
+	ssize_t n;
+
+	if (input.eof)
+		return 0;
 
-	if (fgets(buf, buf_len, stdin) == NULL) {
-		free(buf);
-		return NULL;
+	if (input.start > 0) {
+		/* the returned lines are no longer used */
+		memmove(input.buf, input.buf + input.start,
+			input.end - input.start);
+		input.end -= input.start;
+		input.scanned -= input.start;
+		input.start = 0;
 	}
-	
-	if (feof(stdin)) { /* End of file (ctrl-d) */
-	    fflush(stdout);
-	    exit(0);
+	if (input.size - input.end < INPUT_CHUNK / 2) {
+		if (input.size >= SIZE_MAX / 2) memory_error();
+		input.size = input.size ? input.size * 2 : INPUT_CHUNK;
+		input.buf = xrealloc(input.buf, input.size);
 	}
 
+	input_wait();
+
+	/* one byte kept for the final 0 */
 	do {
-		size_t l = strlen(buf);
-		if ((l > 0) && (buf[l-1] == '\n')) {
-			l--;
-			buf[l] = 0;
-			return buf;
+		n = read(input.fd, input.buf + input.end,
+			 input.size - input.end - 1);
+	} while (n < 0 && errno == EINTR);
+
+	if (n <= 0) {
+		input.eof = 1;
+		return 0;
+	}
+	input.end += n;
+	return 1;
+}
+
+
+int readcmd_eof(void)
+{
+	return input.start == input.end && !input_fill();
+}
+
+
+/* Return the next line of the input, without its newline, or null at
+   the end of the input. The line is in the input buffer : it is valid
+   until the next call. */
+static char *readline(void)
+{
+	char *line, *nl;
+
+	for (;;) {
+		nl = 0;
+		if (input.scanned < input.end)
+			nl = memchr(input.buf + input.scanned, '\n',
+				    input.end - input.scanned);
+		if (nl) break;
+		input.scanned = input.end;
+		if (!input_fill()) {
+			/* last line, without a newline */
+			if (input.start == input.end) return 0;
+			nl = input.buf + input.end;
+			break;
+		}
+	}
+
+	line = input.buf + input.start;
+	*nl = 0;
+	input.start = nl - input.buf;
+	if (input.start < input.end) input.start++;
+	input.scanned = input.start;
+	return line;
+}
+
+
+char *readcmd_line(void)
+{
+	return readline();
+}
+
+
+/* Skip a quoted or substituted span starting at cur ('...', "...", `...`,
+   $(...), <(...) or >(...)). Return a pointer just after the span, or null if it is not
+   terminated. Delimiters inside the span do not end the word. */
+char *skip_span(char *cur)
+{
+	char c = *cur;
+	int depth;
+
+	switch (c) {
+	case '\\':
+		return cur[1] ? cur + 2 : cur + 1;
+	case '\'':
+	case '`':
+		cur = strchr(cur + 1, c);
+		return cur ? cur + 1 : 0;
+	case '"':
+		cur++;
+		while (*cur && *cur != '"') {
+			if (*cur == '\\' && cur[1]) cur += 2;
+			else if ((*cur == '$' && cur[1] == '(') || *cur == '`') {
+				cur = skip_span(cur);
+				if (!cur) return 0;
+			} else cur++;
+		}
+		return *cur ? cur + 1 : 0;
+	case '$':
+	case '<':
+	case '>':
+		/* $( ... ), <( ... ) et >( ... ) : on suit les parenthèses
+		   imbriquées et les quotes */
+		depth = 1;
+		cur += 2;
+		while (*cur && depth > 0) {
+			if (*cur == '(') depth++;
+			else if (*cur == ')') depth--;
+			if (depth == 0) break;
+			if (*cur == '\'' || *cur == '"' || *cur == '`' ||
+			    *cur == '\\' || (*cur == '$' && cur[1] == '(')) {
+				cur = skip_span(cur);
+				if (!cur) return 0;
+			} else cur++;
+		}
+		return *cur ? cur + 1 : 0;
+	}
+	return cur + 1;
+}
+
+
+int is_operator_word(const char *w)
+{
+	return w[0] && strchr("<>|;&()", w[0]) && w[1] != '(';
+}
+
+
+/* Free a null terminated array of words returned by split_in_words() */
+void free_words(char **words)
+{
+	for (int i = 0; words[i] != 0; i++)
+		if (!is_operator_word(words[i])) free(words[i]);
+	free(words);
+}
+
+
+/* '&' followed by a word : background with options */
+static const struct {
+	const char *op;
+	int pin;
+	int prio;
+	int capture;
+} background_ops[] = {
+	{ "&pin",   1, CLASS_NORMAL, 0 },
+	{ "&batch", 0, CLASS_BATCH,  0 },
+	{ "&low",   0, CLASS_LOW,    0 },
+	{ "&>>",    0, CLASS_NORMAL, 1 },
+};
+
+/* The background operator at the start of s ('&' then a name and a
+   delimiter), or null */
+static const char *background_op(const char *s)
+{
+	for (size_t i = 0; i < sizeof(background_ops) / sizeof(background_ops[0]); i++) {
+		const char *op = background_ops[i].op;
+		size_t n = strlen(op);
+		if (strncmp(s, op, n) == 0 &&
+		    (!s[n] || strchr(" \t\n;|&()", s[n])))
+			return op;
+	}
+	return 0;
+}
+
+void background_flags(const char *op, int *pin, int *prio, int *capture)
+{
+	*pin = 0;
+	*prio = CLASS_NORMAL;
+	*capture = 0;
+	for (size_t i = 0; i < sizeof(background_ops) / sizeof(background_ops[0]); i++) {
+		if (strcmp(op, background_ops[i].op) == 0) {
+			*pin = background_ops[i].pin;
+			*prio = background_ops[i].prio;
+			*capture = background_ops[i].capture;
 		}
-		if (buf_len >= (INT_MAX / 2)) memory_error();
-		buf_len *= 2;
-		buf = xrealloc(buf, buf_len * sizeof(char));
-		if (fgets(buf + l, buf_len - l, stdin) == NULL) return buf;
-	} while (1);
+	}
 }
 
 
-/* Split the string in words, according to the simple shell grammar. */
-static char **split_in_words(char *line)
+/* Split the string in words, according to the simple shell grammar.
+   Words are kept raw (quotes and substitutions are still in the text), they
+   are expanded later by expand_word(). If a quote or a substitution is not
+   terminated, *err is set. */
+char **split_in_words(char *line, char **err)
 {
 	char *cur = line;
+	char *end = line + strlen(line);
 	char **tab = 0;
-	size_t l = 0;
+	size_t l = 0, size = 0;
 	char c;
 
 	while ((c = *cur) != 0) {
@@ -83,45 +316,87 @@ static char **split_in_words(char *line)
 			cur++;
 			break;
 		case '<':
-			w = "<";
-			cur++;
-			break;
 		case '>':
-			w = ">";
+			if (cur[1] == '(') {
+				/* Process substitution : a word by itself */
+				start = cur;
+				cur = skip_span(cur);
+				if (!cur) {
+					*err = "unterminated process substitution";
+					cur = start + strlen(start);
+				}
+				w = strndup(start, cur - start);
+				if (!w) memory_error();
+				break;
+			}
+			w = (c == '<') ? "<" : ">";
 			cur++;
 			break;
 		case '|':
-			w = "|";
+		case '&':
+			/* "|", "||", "&", "&&", "&@" (remote background) or
+			   one of the background_ops ("&pin", "&low"...) */
+			if (cur[1] == c) {
+				w = (c == '|') ? "||" : "&&";
+				cur += 2;
+			} else if (c == '&' && cur[1] == '@') {
+				w = "&@";
+				cur += 2;
+			} else if (c == '&' && (w = (char *)background_op(cur))) {
+				cur += strlen(w);
+			} else {
+				w = (c == '|') ? "|" : "&";
+				cur++;
+			}
+			break;
+		case ';':
+		case '\n':
+			w = ";";
+			cur++;
+			break;
+		case '(':
+			w = "(";
+			cur++;
+			break;
+		case ')':
+			w = ")";
 			cur++;
 			break;
 		default:
-			/* Another word */
+			/* Another word : ordinary characters are skipped by
+			   scan_special(), only spans need a closer look */
 			start = cur;
-			while (c) {
-				c = *++cur;
-				switch (c) {
-				case 0:
-				case ' ':
-				case '\t':
-				case '<':
-				case '>':
-				case '|':
-					c = 0;
+			for (;;) {
+				cur = (char *)scan_special(cur, end);
+				c = *cur;
+				if (c == '\'' || c == '"' || c == '`' || c == '\\')
+					cur = skip_span(cur);
+				else if (c == '$')
+					cur = (cur[1] == '(') ? skip_span(cur) : cur + 1;
+				else
+					break;	/* a delimiter or the end of the line */
+				if (!cur) {
+					/* Unterminated span : keep the rest of the line
+					   in this word and report the error */
+					*err = "unterminated quote or substitution";
+					cur = end;
 					break;
-				default: ;
 				}
 			}
 			w = xmalloc((cur - start + 1) * sizeof(char));
-			strncpy(w, start, cur - start);
+			memcpy(w, start, cur - start);
 			w[cur - start] = 0;
 		}
 		if (w) {
-			tab = xrealloc(tab, (l + 1) * sizeof(char *));
+			if (l + 1 >= size) {
+				size = size ? size * 2 : 16;
+				tab = xrealloc(tab, size * sizeof(char *));
+			}
 			tab[l++] = w;
 		}
 	}
-	tab = xrealloc(tab, (l + 1) * sizeof(char *));
-	tab[l++] = 0;
+	if (!tab) tab = xmalloc(sizeof(char *));
+	tab[l] = 0;
 	return tab;
 }
 
@@ -146,30 +421,472 @@ static void freecmd(struct cmdline *s)
 	if (s->in) free(s->in);
 	if (s->out) free(s->out);
 	if (s->seq) freeseq(s->seq);
+	for (int k = 0; k < s->nprocsub; k++)
+		freecmdline(s->procsub[k].cmd);
+	free(s->procsub);
+	for (int k = 0; k < s->nassign; k++)
+		if (s->assign[k]) free_words(s->assign[k]);
+	free(s->assign);
 }
 
-//la fonction principale de ce fichier
-struct cmdline *readcmd(void)
+
+/* Append w to the null terminated array *tab of length *len */
+static void push_word(char ***tab, size_t *len, char *w)
+{
+	*tab = xrealloc(*tab, (*len + 2) * sizeof(char *));
+	(*tab)[(*len)++] = w;
+	(*tab)[*len] = 0;
+}
+
+
+/* Expansion des mots
+ *
+ * Substitution de commande $(...) et `...` : la sortie du fils est lue dans
+ * un pipe, directement dans cap_buf. Ce buffer ne fait que grossir pendant
+ * l'expansion d'une commande et sert à toutes ses substitutions ; il est
+ * libéré quand l'expansion la plus externe se termine. */
+
+#define CAPTURE_CHUNK 65536	/* taille minimale d'un read() dans le pipe */
+
+static const struct expand_ops *expand_ops;
+
+static char *cap_buf;
+static size_t cap_len, cap_size;
+static int expand_depth;	/* expansions en cours (imbriquées) */
+
+void readcmd_set_expand_ops(const struct expand_ops *ops)
+{
+	expand_ops = ops;
+}
+
+/* garantit au moins n octets libres à la fin de cap_buf */
+static void cap_reserve(size_t n)
+{
+	if (cap_len + n <= cap_size) return;
+	while (cap_len + n > cap_size)
+		cap_size = cap_size ? cap_size * 2 : CAPTURE_CHUNK;
+	cap_buf = xrealloc(cap_buf, cap_size);
+}
+
+static void cap_release(void)
+{
+	free(cap_buf);
+	cap_buf = 0;
+	cap_len = cap_size = 0;
+}
+
+static int is_ifs(char c)
+{
+	return c == ' ' || c == '\t' || c == '\n';
+}
+
+/* Push the words of str[0..n) (split on blanks) in tab */
+static void split_push(const char *str, size_t n, char ***tab, size_t *len)
+{
+	size_t start = 0;
+
+	for (size_t k = 0; k <= n; k++) {
+		if (k < n && !is_ifs(str[k])) continue;
+		if (k > start)
+			push_word(tab, len, strndup(str + start, k - start));
+		start = k + 1;
+	}
+}
+
+/* Run the command text[0..n) with its output in a pipe.
+   If tab is not null, the output is split in words while it is read and
+   each word is pushed in tab. Otherwise the output stays in cap_buf
+   (cap_len bytes, trailing newlines removed). */
+static void run_subst(const char *text, size_t n, char ***tab, size_t *len)
+{
+	char *inner = xmalloc(n + 1);
+	int fds[2];
+	size_t start = 0;	/* début du mot en cours dans cap_buf */
+	ssize_t r;
+
+	memcpy(inner, text, n);
+	inner[n] = 0;
+	cap_len = 0;
+
+	if (!expand_ops || pipe2(fds, O_CLOEXEC) < 0) {
+		free(inner);
+		return;
+	}
+
+	expand_ops->spawn(inner, fds[1]);
+	close(fds[1]);
+	free(inner);
+
+	for (;;) {
+		cap_reserve(CAPTURE_CHUNK);
+		r = read(fds[0], cap_buf + cap_len, cap_size - cap_len);
+		if (r < 0 && errno == EINTR) continue;
+		if (r <= 0) break;
+
+		if (!tab) {
+			cap_len += r;
+			continue;
+		}
+
+		/* découpage en mots au fil de la lecture */
+		size_t end = cap_len + r;
+		for (size_t k = cap_len; k < end; k++) {
+			if (!is_ifs(cap_buf[k])) continue;
+			if (k > start)
+				push_word(tab, len, strndup(cap_buf + start, k - start));
+			start = k + 1;
+		}
+		/* on garde le mot pas encore fini au début du buffer */
+		memmove(cap_buf, cap_buf + start, end - start);
+		cap_len = end - start;
+		start = 0;
+	}
+	close(fds[0]);
+	expand_ops->wait();
+
+	if (tab) {
+		if (cap_len > 0)
+			push_word(tab, len, strndup(cap_buf, cap_len));
+		cap_len = 0;
+	} else {
+		while (cap_len > 0 && cap_buf[cap_len - 1] == '\n')
+			cap_len--;
+	}
+}
+
+
+static int is_name_char(char c, int first)
+{
+	return c == '_' || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+	       (!first && c >= '0' && c <= '9');
+}
+
+/* If cur is a variable reference ($name, ${name}, $? or $$), copy the name
+   in name[] and return a pointer after the reference. Otherwise return
+   null. */
+static const char *var_ref(const char *cur, char *name, size_t size)
+{
+	const char *start, *end;
+
+	if (cur[0] != '$') return 0;
+	if (cur[1] == '?' || cur[1] == '$') {
+		name[0] = cur[1];
+		name[1] = 0;
+		return cur + 2;
+	}
+	if (cur[1] == '{') {
+		start = cur + 2;
+		end = strchr(start, '}');
+		if (!end || end == start) return 0;
+	} else {
+		start = cur + 1;
+		if (!is_name_char(*start, 1)) return 0;
+		for (end = start; is_name_char(*end, 0); end++) ;
+	}
+	if ((size_t)(end - start) >= size) return 0;
+	memcpy(name, start, end - start);
+	name[end - start] = 0;
+	return (cur[1] == '{') ? end + 1 : end;
+}
+
+static const char *lookup(const char *name)
+{
+	if (!expand_ops || !expand_ops->lookup) return 0;
+	return expand_ops->lookup(name);
+}
+
+
+/* Expand a raw word into a single string : quotes are removed, variables
+   and substitutions are replaced by their value (not split).
+   If pattern is set, the result is meant for wildcard_expand() : the
+   quoted characters that are special in a pattern, and all backslashes,
+   are protected by a backslash (wildcard_unescape() gives back the plain
+   string). */
+static char *expand_string(const char *raw, int pattern)
+{
+	size_t olen = 0, osize = strlen(raw) + 1;
+	char *out = xmalloc(osize);
+	const char *cur = raw, *next;
+	char name[VARNAME_MAX];
+	int dquote = 0;
+
+#define PUT(p, n) do { \
+		if (olen + (n) + 1 > osize) { \
+			osize = (olen + (n) + 1) * 2; \
+			out = xrealloc(out, osize); \
+		} \
+		memcpy(out + olen, (p), (n)); \
+		olen += (n); \
+	} while (0)
+
+/* quoted text : no wildcard inside */
+#define PUTQ(p, n) do { \
+		const char *q_ = (p); \
+		if (!pattern) PUT(q_, n); \
+		else for (size_t i_ = 0; i_ < (size_t)(n); i_++) { \
+			if (q_[i_] && strchr("*?[]\\", q_[i_])) PUT("\\", 1); \
+			PUT(q_ + i_, 1); \
+		} \
+	} while (0)
+
+/* value of a variable or substitution : its wildcards are active unless
+   it is between double quotes */
+#define PUTV(p, n) do { \
+		const char *v_ = (p); \
+		if (dquote || !pattern) PUTQ(v_, n); \
+		else for (size_t i_ = 0; i_ < (size_t)(n); i_++) { \
+			if (v_[i_] == '\\') PUT("\\", 1); \
+			PUT(v_ + i_, 1); \
+		} \
+	} while (0)
+
+	while (*cur) {
+		char c = *cur;
+		if (c == '\\' && cur[1]) {
+			/* dans les "..." le \ ne protège que $ ` " et \ */
+			if (dquote && !strchr("$`\"\\", cur[1]))
+				PUTQ(cur, 1);
+			PUTQ(cur + 1, 1);
+			cur += 2;
+		} else if (c == '\'' && !dquote) {
+			const char *end = strchr(cur + 1, '\'');
+			PUTQ(cur + 1, end - cur - 1);
+			cur = end + 1;
+		} else if (c == '"') {
+			dquote = !dquote;
+			cur++;
+		} else if ((c == '$' && cur[1] == '(') || c == '`') {
+			const char *end = skip_span((char *)cur);
+			size_t skip = (c == '$') ? 2 : 1;
+			run_subst(cur + skip, end - cur - skip - 1, 0, 0);
+			PUTV(cap_buf, cap_len);
+			cap_len = 0;
+			cur = end;
+		} else if ((next = var_ref(cur, name, sizeof(name))) != 0) {
+			const char *v = lookup(name);
+			if (v) PUTV(v, strlen(v));
+			cur = next;
+		} else if (dquote || c == '\\') {
+			PUTQ(cur, 1);
+			cur++;
+		} else {
+			PUT(cur, 1);
+			cur++;
+		}
+	}
+#undef PUTV
+#undef PUTQ
+#undef PUT
+	out[olen] = 0;
+	return out;
+}
+
+
+/* wildcard_expand() callback */
+struct found_ctx {
+	char ***tab;
+	size_t *len;
+};
+
+static int push_found(const char *path, void *arg)
+{
+	struct found_ctx *ctx = arg;
+	push_word(ctx->tab, ctx->len, strdup(path));
+	return 0;
+}
+
+/* wildcard_expand() callback of expand_words_each() */
+struct each_ctx {
+	int (*fn)(const char *w, void *arg);
+	void *arg;
+	int stop;
+};
+
+static int each_found(const char *path, void *arg)
+{
+	struct each_ctx *ctx = arg;
+	return ctx->stop = ctx->fn(path, ctx->arg);
+}
+
+
+/* True if raw is only an unquoted substitution or variable : its value
+   is split in words. */
+static int is_split_word(const char *raw)
+{
+	char name[VARNAME_MAX];
+	const char *end;
+
+	if ((raw[0] == '$' && raw[1] == '(') || raw[0] == '`') {
+		end = skip_span((char *)raw);
+		if (*end == 0)
+			return 1;
+	}
+	end = var_ref(raw, name, sizeof(name));
+	return end && *end == 0;
+}
+
+
+/* Expand a raw word and push the result(s) in tab. A word that is only an
+   unquoted substitution or variable gives one entry per word of its
+   value. */
+static void expand_word(const char *raw, char ***tab, size_t *len)
+{
+	char name[VARNAME_MAX];
+	const char *end;
+
+	if (brace_has(raw)) {
+		/* {a,b} and {1..N} first, each result is expanded in turn */
+		struct brace_gen g;
+		const char *w;
+
+		brace_open(&g, raw);
+		while ((w = brace_next(&g)) != 0)
+			expand_word(w, tab, len);
+		brace_close(&g);
+		return;
+	}
+
+	if ((raw[0] == '$' && raw[1] == '(') || raw[0] == '`') {
+		end = skip_span((char *)raw);
+		if (*end == 0) {
+			size_t skip = (raw[0] == '$') ? 2 : 1;
+			run_subst(raw + skip, end - raw - skip - 1, tab, len);
+			return;
+		}
+	}
+	end = var_ref(raw, name, sizeof(name));
+	if (end && *end == 0) {
+		const char *v = lookup(name);
+		if (v) split_push(v, strlen(v), tab, len);
+		return;
+	}
+	if (strpbrk(raw, "*?[$`")) {
+		/* maybe a pattern : replaced by the matching file names, kept
+		   as is when nothing matches */
+		struct found_ctx ctx = { tab, len };
+		char *pat = expand_string(raw, 1);
+
+		if (wildcard_has(pat) && wildcard_expand(pat, push_found, &ctx) > 0) {
+			free(pat);
+			return;
+		}
+		wildcard_unescape(pat);
+		push_word(tab, len, pat);
+		return;
+	}
+	push_word(tab, len, expand_string(raw, 0));
+}
+
+
+static void expand_begin(void)
+{
+	expand_depth++;
+}
+
+static void expand_end(void)
+{
+	if (--expand_depth == 0)
+		cap_release();
+}
+
+
+void expand_words(char **raw, char ***tab, size_t *len)
+{
+	expand_begin();
+	for (int i = 0; raw[i] != 0; i++)
+		expand_word(raw[i], tab, len);
+	expand_end();
+}
+
+
+int expand_words_each(char **raw, int (*fn)(const char *w, void *arg),
+		      void *arg)
+{
+	char **tab = 0;
+	size_t len = 0;
+	int stop = 0;
+
+	for (int i = 0; raw[i] != 0 && !stop; i++) {
+		/* the braces are generated one word at a time, so that
+		   {1..N} never exists as a whole */
+		struct brace_gen g;
+		const char *w;
+
+		brace_open(&g, raw[i]);
+		while (!stop && (w = brace_next(&g)) != 0) {
+			expand_begin();
+			if (!is_split_word(w) && strpbrk(w, "*?[$`")) {
+				/* a pattern : the matches are given to fn() as
+				   the walk finds them, a ** walk can be long */
+				struct each_ctx ctx = { fn, arg, 0 };
+				char *pat = expand_string(w, 1);
+
+				if (wildcard_has(pat) &&
+				    wildcard_expand(pat, each_found, &ctx) > 0) {
+					stop = ctx.stop;
+				} else {
+					wildcard_unescape(pat);
+					stop = fn(pat, arg);
+				}
+				free(pat);
+			} else {
+				expand_word(w, &tab, &len);
+			}
+			expand_end();
+			for (size_t k = 0; k < len; k++) {
+				if (!stop) stop = fn(tab[k], arg);
+				free(tab[k]);
+			}
+			len = 0;
+		}
+		brace_close(&g);
+	}
+	free(tab);
+	return stop;
+}
+
+
+/* Record the process substitution w (<(cmd) or >(cmd)) of the command
+   number stage. Its argv entry is pushed in cmd with the raw text, the
+   launcher replaces it by /dev/fd/N. w is consumed. */
+static void add_procsub(struct cmdline *s, char *w, size_t stage,
+			char ***cmd, size_t *cmd_len)
+{
+	size_t n = strlen(w);
+	struct procsub *ps;
+	struct cmdline *inner;
+
+	w[n - 1] = 0;		/* on enlève la ')' finale */
+	inner = parsecmd(w + 2);
+	w[n - 1] = ')';
+	if (inner->err || !inner->seq[0]) {
+		s->err = inner->err ? inner->err : "empty process substitution";
+		freecmdline(inner);
+		free(w);
+		return;
+	}
+
+	s->procsub = xrealloc(s->procsub,
+			      (s->nprocsub + 1) * sizeof(struct procsub));
+	ps = &s->procsub[s->nprocsub++];
+	ps->cmd = inner;
+	ps->output = (w[0] == '>');
+	ps->stage = stage;
+	ps->arg = *cmd_len;
+	push_word(cmd, cmd_len, w);
+}
+
+
+/* Build s from words (see split_in_words()). The words and the array are
+   consumed. The fields of s must be free. */
+static void parse_words(char **words, char *split_err, struct cmdline *s)
 {
-	static struct cmdline *static_cmdline = 0;
-	struct cmdline *s = static_cmdline;
-	char *line;
-	char **words;
 	int i;
 	char *w;
 	char **cmd;
 	char ***seq;
 	size_t cmd_len, seq_len;
 
-	line = readline();
-	if (line == NULL) {
-		if (s) {
-			freecmd(s);
-			free(s);
-		}
-		return static_cmdline = 0;
-	}
-
 	cmd = xmalloc(sizeof(char *));
 	cmd[0] = 0;
 	cmd_len = 0;
@@ -177,41 +894,60 @@ struct cmdline *readcmd(void)
 	seq[0] = 0;
 	seq_len = 0;
 
-	words = split_in_words(line);
-	free(line);
-
-	if (!s)
-		static_cmdline = s = xmalloc(sizeof(struct cmdline));
-	else
-		freecmd(s);
 	s->err = 0;
 	s->in = 0;
 	s->out = 0;
 	s->seq = 0;
 	s->background = 0; //etape 8 : par défaut, pas d'arrière-plan
+	s->pin = 0;
+	s->prio = 0;
+	s->capture = 0;
+	s->procsub = 0;
+	s->nprocsub = 0;
+	s->assign = 0;
+	s->nassign = 0;
 
 	i = 0;
+	if (split_err) {
+		s->err = split_err;
+		goto error;
+	}
+
 	while ((w = words[i++]) != 0) {
+		if (is_operator_word(w) && strlen(w) > 1) {
+			s->err = "unexpected && or ||";
+			goto error;
+		}
 		switch (w[0]) {
 		case '<':
+			if (w[1] == '(') {
+				add_procsub(s, w, seq_len, &cmd, &cmd_len);
+				if (s->err) goto error;
+				break;
+			}
 			/* Tricky : the word can only be "<" */
 			if (s->in) {
 				s->err = "only one input file supported";
 				goto error;
 			}
-			if (words[i] == 0) {
+			if (words[i] == 0 || is_operator_word(words[i])) {
 				s->err = "filename missing for input redirection";
 				goto error;
 			}
 			s->in = words[i++];
 			break;
 		case '>':
+			if (w[1] == '(') {
+				add_procsub(s, w, seq_len, &cmd, &cmd_len);
+				if (s->err) goto error;
+				break;
+			}
 			/* Tricky : the word can only be ">" */
 			if (s->out) {
 				s->err = "only one output file supported";
 				goto error;
 			}
-			if (words[i] == 0) {
+			if (words[i] == 0 || is_operator_word(words[i])) {
 				s->err = "filename missing for output redirection";
 				goto error;
 			}
@@ -238,11 +974,15 @@ struct cmdline *readcmd(void)
 					goto error;
 				}
 				s->background = 1;
+				background_flags(w, &s->pin, &s->prio, &s->capture);
 				break;
+		case ';':
+		case '(':
+		case ')':
+			s->err = "unexpected ; ( or )";
+			goto error;
 		default:
-			cmd = xrealloc(cmd, (cmd_len + 2) * sizeof(char *));
-			cmd[cmd_len++] = w;
-			cmd[cmd_len] = 0;
+			push_word(&cmd, &cmd_len, w);
 		}
 	}
 
@@ -258,17 +998,10 @@ struct cmdline *readcmd(void)
 		free(cmd);
 	free(words);
 	s->seq = seq;
-	return s;
+	return;
 error:
 	while ((w = words[i++]) != 0) {
-		switch (w[0]) {
-		case '<':
-		case '>':
-		case '|':
-			break;
-		default:
-			free(w);
-		}
+		if (!is_operator_word(w)) free(w);
 	}
 	free(words);
 	freeseq(seq);
@@ -282,5 +1015,149 @@ error:
 		free(s->out);
 		s->out = 0;
 	}
+	for (i = 0; i < s->nprocsub; i++)
+		freecmdline(s->procsub[i].cmd);
+	free(s->procsub);
+	s->procsub = 0;
+	s->nprocsub = 0;
+}
+
+
+struct cmdline *cmdline_from_words(char **words)
+{
+	struct cmdline *s = xmalloc(sizeof(struct cmdline));
+	parse_words(words, 0, s);
+	return s;
+}
+
+
+struct cmdline *parsecmd(char *line)
+{
+	struct cmdline *s = xmalloc(sizeof(struct cmdline));
+	char *split_err = 0;
+	char **words = split_in_words(line, &split_err);
+
+	parse_words(words, split_err, s);
 	return s;
 }
+
+
+void freecmdline(struct cmdline *s)
+{
+	freecmd(s);
+	free(s);
+}
+
+
+static int find_procsub(struct cmdline *raw, int stage, int arg)
+{
+	for (int k = 0; k < raw->nprocsub; k++)
+		if (raw->procsub[k].stage == stage && raw->procsub[k].arg == arg)
+			return k;
+	return -1;
+}
+
+
+struct cmdline *expand_cmdline(struct cmdline *raw)
+{
+	struct cmdline *s = xmalloc(sizeof(struct cmdline));
+	size_t seq_len = 0;
+
+	memset(s, 0, sizeof(struct cmdline));
+	s->background = raw->background;
+	s->pin = raw->pin;
+	s->prio = raw->prio;
+	s->capture = raw->capture;
+	s->seq = xmalloc(sizeof(char **));
+	s->seq[0] = 0;
+
+	expand_begin();
+	if (raw->in) s->in = expand_string(raw->in, 0);
+	if (raw->out) s->out = expand_string(raw->out, 0);
+
+	for (int i = 0; raw->seq[i] != 0; i++) {
+		char **cmd = xmalloc(sizeof(char *));
+		size_t cmd_len = 0;
+		char **assign = 0;
+		size_t assign_len = 0;
+		int j = 0, nl;
+
+		/* NAME=value words in front of the command */
+		for (; raw->seq[i][j] != 0 &&
+		       var_is_assign(raw->seq[i][j], &nl); j++) {
+			char *v = expand_string(raw->seq[i][j] + nl + 1, 0);
+			char *a = xmalloc(nl + strlen(v) + 2);
+			memcpy(a, raw->seq[i][j], nl + 1);
+			strcpy(a + nl + 1, v);
+			free(v);
+			push_word(&assign, &assign_len, a);
+		}
+
+		cmd[0] = 0;
+		for (; raw->seq[i][j] != 0; j++) {
+			int k = find_procsub(raw, i, j);
+			if (k < 0) {
+				expand_word(raw->seq[i][j], &cmd, &cmd_len);
+				continue;
+			}
+			/* l'argument sera remplacé par /dev/fd/N au lancement */
+			s->procsub = xrealloc(s->procsub,
+				(s->nprocsub + 1) * sizeof(struct procsub));
+			s->procsub[s->nprocsub].cmd =
+				expand_cmdline(raw->procsub[k].cmd);
+			s->procsub[s->nprocsub].output = raw->procsub[k].output;
+			s->procsub[s->nprocsub].stage = seq_len;
+			s->procsub[s->nprocsub].arg = cmd_len;
+			s->nprocsub++;
+			push_word(&cmd, &cmd_len, strdup(raw->seq[i][j]));
+		}
+
+		if (cmd_len == 0 && !(assign && raw->seq[1] == 0)) {
+			/* $(...) vide : la commande disparaît si elle est seule */
+			free(cmd);
+			if (assign) free_words(assign);
+			if (raw->seq[1] != 0) s->err = "empty command in pipeline";
+			continue;
+		}
+		s->seq = xrealloc(s->seq, (seq_len + 2) * sizeof(char **));
+		s->seq[seq_len] = cmd;
+		if (assign) {
+			/* seq[i] may be empty : only assignments */
+			s->assign = xrealloc(s->assign,
+					     (seq_len + 1) * sizeof(char **));
+			for (size_t k = s->nassign; k < seq_len; k++)
+				s->assign[k] = 0;
+			s->assign[seq_len] = assign;
+			s->nassign = seq_len + 1;
+		}
+		s->seq[++seq_len] = 0;
+	}
+	expand_end();
+	return s;
+}
+
+
+//la fonction principale de ce fichier
+struct cmdline *readcmd(void)
+{
+	static struct cmdline *static_cmdline = 0;
+	struct cmdline *raw;
+	char *line;
+
+	if (static_cmdline) {
+		freecmdline(static_cmdline);
+		static_cmdline = 0;
+	}
+
+	line = readline();
+	if (line == NULL)
+		return 0;
+
+	raw = parsecmd(line);
+	if (raw->err)
+		return static_cmdline = raw;
+
+	static_cmdline = expand_cmdline(raw);
+	freecmdline(raw);
+	return static_cmdline;
+}
@@ -5,10 +5,70 @@
 #ifndef __READCMD_H
 #define __READCMD_H
 
+#include <stddef.h>
+#include <stdio.h>
+
 /* Read a command line from input stream. Return null when input closed.
-Display an error and call exit() in case of memory exhaustion. */
+Display an error and call exit() in case of memory exhaustion.
+The words are expanded (see expand_cmdline()). */
 struct cmdline *readcmd(void);
 
+/* Read a line from input stream, without parsing it. Return null when
+input closed. The line is in the input buffer : it is only valid until the
+next read, and must not be freed. */
+char *readcmd_line(void);
+
+/* Read the commands from the descriptor fd instead of standard input
+(0 : back to standard input). */
+void readcmd_set_input(int fd);
+
+/* Return non zero if there is nothing left to read on the input stream.
+May block until some input is available. */
+int readcmd_eof(void);
+
+/* Split line (not modified) in raw words. Operators ("<", ">", "|", "&",
+";", "&&", "||", "(", ")") are static strings, a newline gives ";". Other
+words are allocated and keep their quotes, substitutions and variables.
+*err is set if a quote or a substitution is not terminated. */
+char **split_in_words(char *line, char **err);
+int is_operator_word(const char *w);
+
+/* Skip the quoted or substituted span starting at cur (\x, '...', "...",
+`...`, $(...), <(...) or >(...)). Return a pointer just after it, or null
+if it is not terminated. */
+char *skip_span(char *cur);
+void free_words(char **words);
+
+/* Parse the string line (which is not modified) into a new structure.
+Only pipes, redirections and '&' are allowed. The words are not expanded.
+The result must be freed with freecmdline(). */
+struct cmdline *parsecmd(char *line);
+
+/* Same as parsecmd() on words returned by split_in_words(). The words and
+the array are consumed. */
+struct cmdline *cmdline_from_words(char **words);
+
+/* Return a new structure with the words of raw expanded : quotes removed,
+$name, ${name}, $(...) and `...` replaced by their value. The NAME=value
+words in front of a command are moved to assign. */
+struct cmdline *expand_cmdline(struct cmdline *raw);
+
+/* Expand the null terminated list of raw words and push the results in
+*tab (null terminated array of *len words, reallocated). */
+void expand_words(char **raw, char ***tab, size_t *len);
+
+/* Same, but the words are given one at a time to fn() instead of being
+stored : {1..N} and {a,b} are generated lazily, in constant memory.
+Stop as soon as fn() returns non zero, and return that value. */
+int expand_words_each(char **raw, int (*fn)(const char *w, void *arg),
+		      void *arg);
+
+void freecmdline(struct cmdline *l);
+
+/* Options of the background operator op ("&", "&pin", "&batch",
+"&low", "&>>") : pinned to cores, priority class, output captured */
+void background_flags(const char *op, int *pin, int *prio, int *capture);
+
 
 /* Structure returned by readcmd() */
 struct cmdline {
@@ -18,6 +78,29 @@ struct cmdline {
 	char *out;	/* If not null : name of file for output redirection. */
 	char ***seq;	/* See comment below */
 	int background; /* If the command line ends with '&' (etape 8) */
+	int pin;	/* If it ends with '&pin' : background, pinned to
+			   cores (see cpumap.h) */
+	int prio;	/* '&batch' or '&low' : background, with that
+			   priority class (job_class, see prio.h) */
+	int capture;	/* '&>>' : background, its output is kept by the
+			   shell (see capture.h) */
+	struct procsub *procsub; /* Process substitutions, see below */
+	int nprocsub;
+	char ***assign;	/* If not null, assign[i] (i < nassign) holds the
+			   NAME=value words found in front of seq[i], or is
+			   null. seq[0] may then be empty : the line is only
+			   assignments. Set by expand_cmdline(). */
+	int nassign;
+};
+
+/* A process substitution <(cmd) or >(cmd) found in the command number
+stage of seq. seq[stage][arg] holds the raw text until the launcher replaces
+it by the /dev/fd/N path of the pipe connected to cmd. */
+struct procsub {
+	struct cmdline *cmd;	/* The inner command line */
+	int output;		/* 0 for <(cmd), 1 for >(cmd) */
+	int stage;
+	int arg;
 };
 
 /* Field seq of struct cmdline :
@@ -28,4 +111,24 @@ A sequence is an array of commands (char ***), whose last item is a null
 pointer.
 When a struct cmdline is returned by readcmd(), seq[0] is never null.
 */
+
+/* Hooks used by the expansion, provided by the shell.
+Command substitution $(...) and `...` : the text of the inner command is
+given to spawn(), which must start it with its standard output on fd_out
+(and not wait for it). Once the output has been read until end of file,
+wait() is called.
+lookup() gives the value of a variable, or null if it is not set. */
+struct expand_ops {
+	void (*spawn)(char *text, int fd_out);
+	void (*wait)(void);
+	const char *(*lookup)(const char *name);
+};
+
+void readcmd_set_expand_ops(const struct expand_ops *ops);
+
+/* Timer of the shell, run while it waits for a command line : fd() gives
+the file descriptor to watch (negative if there is none right now), and
+tick() is called each time it is readable. */
+void readcmd_set_timer(int (*fd)(void), void (*tick)(void));
+
 #endif
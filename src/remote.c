@@ -0,0 +1,381 @@
+/*
+ * Exécution chez des agents (voir remote.h).
+ *
+ * Côté shell, un job distant est un sous-shell (le relais) connecté à
+ * l'agent : il est dans jobs[] comme les autres, stop / fg / bg lui
+ * envoient leurs signaux et il les fait suivre.
+ *
+ * Côté agent, chaque connexion a son fils, qui lance la commande comme
+ * le fait le mode serveur (launch_node, sortie dans un pipe) et attend
+ * avec pselect la sortie, les lignes SIG et la fin du job.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/select.h>
+#include "csapp.h"
+#include "exec.h"
+#include "vars.h"
+#include "remote.h"
+
+#define REMOTE_MAXTEXT  (64 * 1024)     /* commande la plus longue */
+#define LINE            64              /* lignes du protocole */
+
+
+/* ── côté shell ── */
+
+int remote_agents(char *hosts[MAXAGENTS]) {
+    static char *buf = NULL;
+    const char *v = var_get("AGENTS");
+    int n = 0;
+
+    free(buf);
+    buf = v ? strdup(v) : NULL;
+    for (char *s = buf ? strtok(buf, " \t\n") : NULL; s && n < MAXAGENTS;
+         s = strtok(NULL, " \t\n"))
+        hosts[n++] = s;
+    return n;
+}
+
+int remote_send(const char *host, const char *text) {
+    char name[MAXHOST], line[LINE];
+
+    snprintf(name, sizeof(name), "%s", host);
+    char *port = strrchr(name, ':');
+    if (!port) {
+        fprintf(stderr, "%s: il manque le port\n", host);
+        return -1;
+    }
+    *port++ = '\0';
+
+    int fd = open_clientfd(name, port);
+    if (fd < 0) {
+        fprintf(stderr, "%s: agent injoignable\n", host);
+        return -1;
+    }
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+    size_t len = strlen(text);
+    int n = snprintf(line, sizeof(line), "RUN %zu\n", len);
+    if (rio_writen(fd, line, n) < 0 || rio_writen(fd, (void *)text, len) < 0) {
+        fprintf(stderr, "%s: %s\n", host, strerror(errno));
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/* socket du relais, pour les handlers */
+static int relay_fd = -1;
+
+/* envoie "SIG n" (dans un handler : pas de stdio) */
+static void send_sig(int sig) {
+    char msg[16] = "SIG ";
+    int k = 4;
+
+    if (sig >= 10) msg[k++] = '0' + sig / 10;
+    msg[k++] = '0' + sig % 10;
+    msg[k++] = '\n';
+    rio_writen(relay_fd, msg, k);
+}
+
+static void relay_handler(int sig) {
+    int olderrno = errno;
+
+    if (sig == SIGTSTP) {
+        /* la commande s'arrête là-bas, le relais ici : jobs le voit
+           Stopped, et fg / bg le relanceront avec SIGCONT */
+        send_sig(SIGSTOP);
+        raise(SIGSTOP);
+    } else {
+        send_sig(sig);
+    }
+    errno = olderrno;
+}
+
+int remote_wait(int fd) {
+    static char buf[RIO_BUFSIZE];
+    static const int sigs[] = { SIGINT, SIGTERM, SIGHUP, SIGTSTP, SIGCONT };
+    char line[LINE];
+    rio_t rio;
+    long n;
+
+    struct sigaction sa;
+    sa.sa_handler = relay_handler;
+    sigemptyset(&sa.sa_mask);
+    sa.sa_flags = SA_RESTART;
+    relay_fd = fd;
+    for (size_t k = 0; k < sizeof(sigs) / sizeof(sigs[0]); k++)
+        sigaction(sigs[k], &sa, NULL);
+
+    rio_readinitb(&rio, fd);
+    while (rio_readlineb(&rio, line, sizeof(line)) > 0) {
+        if (sscanf(line, "EXIT %ld", &n) == 1) {
+            close(fd);
+            return n;
+        }
+        if (sscanf(line, "OUT %ld", &n) != 1 || n < 0) break;
+        while (n > 0) {
+            size_t k = n < (long)sizeof(buf) ? (size_t)n : sizeof(buf);
+            if (rio_readnb(&rio, buf, k) != (ssize_t)k) goto lost;
+            rio_writen(STDOUT_FILENO, buf, k);
+            n -= k;
+        }
+    }
+lost:
+    fprintf(stderr, "connexion avec l'agent perdue\n");
+    close(fd);
+    return 255;
+}
+
+char *remote_quote(char **argv) {
+    size_t size = 1;
+    for (int i = 0; argv[i]; i++) size += 4 * strlen(argv[i]) + 3;
+
+    char *text = Malloc(size), *p = text;
+    for (int i = 0; argv[i]; i++) {
+        if (i > 0) *p++ = ' ';
+        *p++ = '\'';
+        for (const char *c = argv[i]; *c; c++) {
+            if (*c == '\'') {
+                memcpy(p, "'\\''", 4);      // ' → '\''
+                p += 4;
+            } else {
+                *p++ = *c;
+            }
+        }
+        *p++ = '\'';
+    }
+    *p = '\0';
+    return text;
+}
+
+static int relay_body(void *arg) {
+    return remote_wait(*(int *)arg);
+}
+
+int launch_remote(struct node *n) {
+    static char text[REMOTE_MAXTEXT];
+    char *hosts[MAXAGENTS];
+    int tried[MAXAGENTS] = { 0 };
+
+    int nh = remote_agents(hosts);
+    if (nh == 0) {
+        fprintf(stderr, "&@: aucun agent (variable AGENTS)\n");
+        return -1;
+    }
+
+    /* le texte de la commande, sans le &@ */
+    n->background = n->remote = 0;
+    ast_format(n, text, sizeof(text));
+    n->background = n->remote = 1;
+
+    /* l'agent qui a le moins de jobs en cours ; s'il ne répond pas,
+       le suivant */
+    for (int t = 0; t < nh; t++) {
+        int best = -1, load = 0;
+        for (int k = 0; k < nh; k++) {
+            if (tried[k]) continue;
+            int l = count_host_jobs(hosts[k]);
+            if (best < 0 || l < load) {
+                best = k;
+                load = l;
+            }
+        }
+        tried[best] = 1;
+
+        int fd = remote_send(hosts[best], text);
+        if (fd < 0) continue;
+
+        sigset_t prev;
+        block_sigchld(&prev);       // il a la machine avant de pouvoir finir
+        int jid = launch_function(text, -1, RUNNING, relay_body, &fd);
+        if (jid > 0)
+            snprintf(get_job_by_jid(jid)->host, MAXHOST, "%s", hosts[best]);
+        unblock_sigchld(&prev);
+        close(fd);
+        return jid;
+    }
+    return -1;
+}
+
+
+/* ── côté agent ── */
+
+static int agent_jid = 0;
+static volatile sig_atomic_t agent_done = 0, agent_code = 0;
+
+/* appelé par le handler SIGCHLD (donc pendant pselect) */
+static void agent_job_done(job_t *j, int code) {
+    if (j->jid == agent_jid) {
+        agent_done = 1;
+        agent_code = code;
+    }
+}
+
+static void send_exit(int fd, int code) {
+    char line[LINE];
+    int n = snprintf(line, sizeof(line), "EXIT %d\n", code);
+    rio_writen(fd, line, n);
+}
+
+/* une ligne du shell : un signal pour la commande. → 0, -1 si le shell
+   est parti (la commande est alors tuée) */
+static int agent_line(rio_t *rio, pid_t pgid) {
+    char line[LINE];
+    int sig;
+
+    if (rio_readlineb(rio, line, sizeof(line)) <= 0) {
+        if (!agent_done) kill(-pgid, SIGKILL);
+        return -1;
+    }
+    if (sscanf(line, "SIG %d", &sig) != 1 || agent_done) return 0;
+
+    /* comme stop / bg : l'état du job suit, pour que sa fin soit vue */
+    job_t *j = get_job_by_jid(agent_jid);
+    if (j && sig == SIGSTOP) j->state = STOPPED;
+    if (j && sig == SIGCONT) j->state = RUNNING;
+    kill(-pgid, sig);
+    return 0;
+}
+
+/* une connexion, dans un fils de l'agent */
+static void agent_conn(int fd) {
+    static char buf[RIO_BUFSIZE];
+    char line[LINE], *err;
+    struct node *root;
+    rio_t rio;
+    long len;
+    int p[2];
+
+    rio_readinitb(&rio, fd);
+    if (rio_readlineb(&rio, line, sizeof(line)) <= 0 ||
+        sscanf(line, "RUN %ld", &len) != 1 || len < 0 || len > REMOTE_MAXTEXT)
+        return;
+    char *text = Malloc(len + 1);
+    if (rio_readnb(&rio, text, len) != len) return;
+    text[len] = '\0';
+
+    int r = ast_parse(text, &root, &err);
+    if (r != AST_OK) {
+        fprintf(stderr, "error: %s\n",
+                r == AST_MORE ? "unexpected end of file" : err);
+        send_exit(fd, 2);
+        return;
+    }
+    if (!root || pipe(p) < 0) {
+        send_exit(fd, root ? 1 : 0);
+        return;
+    }
+    fcntl(p[0], F_SETFD, FD_CLOEXEC);
+    fcntl(p[1], F_SETFD, FD_CLOEXEC);
+
+    exec_job_done = agent_job_done;
+    sigset_t wait_mask;
+    block_sigchld(&wait_mask);      // débloqué seulement dans pselect
+    sigdelset(&wait_mask, SIGCHLD);
+
+    agent_jid = launch_node(root, p[1], RUNNING);
+    close(p[1]);
+    if (agent_jid < 0) {
+        send_exit(fd, 1);
+        return;
+    }
+    pid_t pgid = get_job_by_jid(agent_jid)->pgid;
+    int out = p[0], client = fd;
+
+    while (!agent_done || out >= 0) {
+        /* des lignes déjà lues par rio n'ont pas à attendre pselect */
+        if (client >= 0 && rio.rio_cnt > 0) {
+            if (agent_line(&rio, pgid) < 0) client = -1;
+            continue;
+        }
+
+        fd_set rfds;
+        int maxfd = -1;
+        FD_ZERO(&rfds);
+        if (client >= 0) { FD_SET(client, &rfds); maxfd = client; }
+        if (out >= 0) { FD_SET(out, &rfds); if (out > maxfd) maxfd = out; }
+
+        if (maxfd < 0) {
+            sigsuspend(&wait_mask);     // plus que la fin du job
+            continue;
+        }
+        if (pselect(maxfd + 1, &rfds, NULL, NULL, NULL, &wait_mask) < 0)
+            continue;                   // EINTR : un job a fini
+
+        if (out >= 0 && FD_ISSET(out, &rfds)) {
+            ssize_t n = read(out, buf, sizeof(buf));
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) {
+                close(out);
+                out = -1;
+            } else if (client >= 0) {
+                int k = snprintf(line, sizeof(line), "OUT %zd\n", n);
+                if (rio_writen(client, line, k) < 0 ||
+                    rio_writen(client, buf, n) < 0) {
+                    if (!agent_done) kill(-pgid, SIGKILL);
+                    client = -1;
+                }
+            }
+        }
+        if (client >= 0 && FD_ISSET(client, &rfds))
+            if (agent_line(&rio, pgid) < 0) client = -1;
+    }
+    if (client >= 0) send_exit(client, agent_code);
+}
+
+int agent(char *where) {
+    /* [ADDR:]PORT, ADDR éventuellement entre crochets (IPv6) */
+    char buf[256], *host = AGENT_ADDR, *port = buf;
+    snprintf(buf, sizeof(buf), "%s", where);
+    char *colon = strrchr(buf, ':');
+    if (colon) {
+        *colon = '\0';
+        host = buf;
+        port = colon + 1;
+        size_t n = strlen(host);
+        if (n >= 2 && host[0] == '[' && host[n - 1] == ']') {
+            host[n - 1] = '\0';
+            host++;
+        }
+        if (strcmp(host, "*") == 0) host = NULL;
+    }
+
+    int listenfd = open_host_listenfd(host, port);
+    if (listenfd < 0) {
+        if (listenfd == -1)
+            fprintf(stderr, "%s: %s\n", where, strerror(errno));
+        return 1;
+    }
+    fcntl(listenfd, F_SETFD, FD_CLOEXEC);
+    signal(SIGPIPE, SIG_IGN);
+
+    for (;;) {
+        int fd = accept(listenfd, NULL, NULL);
+        if (fd < 0) {
+            if (errno == EINTR) continue;
+            fprintf(stderr, "accept: %s\n", strerror(errno));
+            return 1;
+        }
+        fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+        /* les fils finis sont ramassés par le handler SIGCHLD (ils ne
+           sont pas dans jobs[]) */
+        fflush(stdout);
+        pid_t pid = fork();
+        if (pid == 0) {
+            close(listenfd);
+            agent_conn(fd);
+            close(fd);
+            _exit(0);
+        }
+        if (pid < 0) fprintf(stderr, "fork: failed\n");
+        close(fd);
+    }
+}
@@ -0,0 +1,61 @@
+#ifndef __REMOTE_H__
+#define __REMOTE_H__
+
+#include "ast.h"
+
+/* ── Exécution chez des agents, par TCP ──
+   shell --agent [ADDR:]PORT attend des commandes sur PORT et les exécute
+   sur sa machine, chacune dans un fils (plusieurs connexions à la fois).
+
+   Confiance : l’agent exécute avec sh, sous son utilisateur, tout ce
+   qu’on lui envoie, sans authentification ni chiffrement. Quiconque peut
+   ouvrir une connexion vers le port a un shell sur la machine. Par
+   défaut l’agent n’écoute donc que sur la boucle locale (127.0.0.1) ;
+   ADDR l’ouvre sur une autre adresse ("*" : toutes), à réserver à un
+   réseau où tous ceux qui peuvent joindre le port ont déjà ce droit
+   (sinon, passer par un tunnel ssh vers 127.0.0.1).
+
+   Côté shell, la variable AGENTS donne la liste des agents
+   ("machine:port machine:port ..."). cmd &@ envoie le texte de cmd (pas
+   encore expansé : $x est celui de l’agent) à l’agent qui a le moins de
+   jobs en cours, pmap --remote fait pareil pour chaque mot.
+
+   Chaque job distant a un relais local : un job ordinaire de jobs[]
+   (avec la machine en plus) qui recopie la sortie de l’agent et sort
+   avec le code de la commande. Les signaux qu’il reçoit (stop, fg, bg,
+   Ctrl-C) sont transmis à l’agent, qui les envoie au groupe de la
+   commande ; s’il meurt, la commande est tuée.
+
+   Protocole, par lignes (csapp rio) :
+     shell → agent  RUN <n>\n puis les n octets de la commande
+                    SIG <numéro>\n
+     agent → shell  OUT <n>\n puis n octets de sortie
+                    EXIT <code>\n */
+
+#define MAXAGENTS 64
+#define AGENT_ADDR "127.0.0.1"  /* adresse d'écoute par défaut */
+
+/* Agents de la variable AGENTS → leur nombre, hosts[] pointe dans un
+   tampon statique (valable jusqu’au prochain appel) */
+int  remote_agents(char *hosts[MAXAGENTS]);
+
+/* Se connecte à host ("machine:port") et envoie text → la socket, -1 si
+   l’agent ne répond pas */
+int  remote_send(const char *host, const char *text);
+
+/* Le relais : recopie la sortie sur stdout et transmet les signaux
+   jusqu’à la fin → code de retour de la commande, 255 si la connexion
+   est perdue */
+int  remote_wait(int fd);
+
+/* argv sous forme de texte pour sh, chaque mot entre quotes (à libérer) */
+char *remote_quote(char **argv);
+
+/* cmd &@ : lance le noeud n chez le moins chargé des agents
+   → jid du relais, -1 si échec */
+int  launch_remote(struct node *n);
+
+/* shell --agent [ADDR:]PORT. Ne revient qu’en cas d’erreur → code */
+int  agent(char *where);
+
+#endif
@@ -0,0 +1,108 @@
+/*
+ * Recherche vectorielle des caractères spéciaux (voir scan.h).
+ *
+ * Chaque caractère spécial est comparé à 16 ou 32 octets d'un coup ; les
+ * comparaisons sont combinées par des OU puis réduites en un masque d'un
+ * bit par octet : le premier bit à 1 donne la position. Les versions
+ * SSE2 et AVX2 sont compilées avec l'attribut target, le reste du fichier
+ * n'a pas besoin d'options particulières ; le choix se fait au premier
+ * appel avec __builtin_cpu_supports. La fin de la zone (moins d'un bloc)
+ * est toujours traitée octet par octet, on ne lit jamais après end.
+ *
+ * Sans optimisation, les intrinsèques passent par la pile et la version
+ * vectorielle perd contre la boucle simple : le Makefile compile ce
+ * fichier en -O2.
+ */
+
+#include <stddef.h>
+#include "scan.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SCAN_X86
+#include <immintrin.h>
+#endif
+
+/* un octet non nul par caractère spécial */
+static const unsigned char special[256] = {
+    [' '] = 1, ['\t'] = 1, ['\n'] = 1,
+    ['<'] = 1, ['>'] = 1, ['|'] = 1, ['&'] = 1, [';'] = 1,
+    ['('] = 1, [')'] = 1,
+    ['\''] = 1, ['"'] = 1, ['`'] = 1, ['\\'] = 1, ['$'] = 1,
+};
+
+static const char *scan_scalar(const char *s, const char *end) {
+    while (s < end && !special[(unsigned char)*s]) s++;
+    return s;
+}
+
+#ifdef SCAN_X86
+
+static const char special_chars[15] = " \t\n<>|&;()'\"`\\$";
+
+__attribute__((target("sse2")))
+static const char *scan_sse2(const char *s, const char *end) {
+    __m128i set[15];
+
+    for (int k = 0; k < 15; k++) set[k] = _mm_set1_epi8(special_chars[k]);
+
+    while (end - s >= 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)s);
+        __m128i m = _mm_cmpeq_epi8(v, set[0]);
+        for (int k = 1; k < 15; k++)
+            m = _mm_or_si128(m, _mm_cmpeq_epi8(v, set[k]));
+        unsigned bits = _mm_movemask_epi8(m);
+        if (bits) return s + __builtin_ctz(bits);
+        s += 16;
+    }
+    return scan_scalar(s, end);
+}
+
+__attribute__((target("avx2")))
+static const char *scan_avx2(const char *s, const char *end) {
+    __m256i set[15];
+
+    for (int k = 0; k < 15; k++) set[k] = _mm256_set1_epi8(special_chars[k]);
+
+    while (end - s >= 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)s);
+        __m256i m = _mm256_cmpeq_epi8(v, set[0]);
+        for (int k = 1; k < 15; k++)
+            m = _mm256_or_si256(m, _mm256_cmpeq_epi8(v, set[k]));
+        unsigned bits = _mm256_movemask_epi8(m);
+        if (bits) return s + __builtin_ctz(bits);
+        s += 32;
+    }
+    return scan_sse2(s, end);
+}
+
+#endif
+
+static const char *scan_first(const char *s, const char *end);
+
+static const char *(*scan_impl)(const char *, const char *) = scan_first;
+
+int scan_set_level(int level) {
+#ifdef SCAN_X86
+    __builtin_cpu_init();
+    if (level >= SCAN_AVX2 && __builtin_cpu_supports("avx2")) {
+        scan_impl = scan_avx2;
+        return SCAN_AVX2;
+    }
+    if (level >= SCAN_SSE2 && __builtin_cpu_supports("sse2")) {
+        scan_impl = scan_sse2;
+        return SCAN_SSE2;
+    }
+#endif
+    scan_impl = scan_scalar;
+    return SCAN_SCALAR;
+}
+
+/* premier appel : on choisit la meilleure version */
+static const char *scan_first(const char *s, const char *end) {
+    scan_set_level(SCAN_AVX2);
+    return scan_impl(s, end);
+}
+
+const char *scan_special(const char *s, const char *end) {
+    return scan_impl(s, end);
+}
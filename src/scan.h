@@ -0,0 +1,22 @@
+#ifndef __SCAN_H__
+#define __SCAN_H__
+
+/* ── Recherche des caractères spéciaux d’une ligne ──
+   split_in_words() passe la plus grande partie d’une longue ligne à
+   avancer sur des caractères ordinaires. scan_special() saute ces
+   caractères 16 (SSE2) ou 32 (AVX2) à la fois quand le processeur le
+   permet (testé au premier appel), un octet à la fois sinon : les trois
+   versions donnent exactement le même résultat. */
+
+enum { SCAN_SCALAR, SCAN_SSE2, SCAN_AVX2 };
+
+/* Premier caractère de [s, end) qui termine un mot ou doit être examiné
+   de près : blancs, fin de ligne, < > | & ; ( ), quotes, \ et $.
+   → end s’il n’y en a pas */
+const char *scan_special(const char *s, const char *end);
+
+/* Choisit la version utilisée : la meilleure disponible qui ne dépasse
+   pas level (pour les tests et les mesures) → version retenue */
+int scan_set_level(int level);
+
+#endif
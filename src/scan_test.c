@@ -0,0 +1,127 @@
+/*
+ * Vérification et mesure de scan_special() (voir scan.h).
+ *
+ *   make scan_test
+ *   ./scan_test [N]     compare les versions sur N lignes aléatoires
+ *   ./scan_test -b [MO] mesure split_in_words() sur une ligne de MO Mo
+ *
+ * La comparaison porte sur scan_special() à chaque position de chaque
+ * ligne, puis sur les mots rendus par split_in_words() : la version
+ * scalaire sert de référence.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "readcmd.h"
+#include "scan.h"
+
+static const char *level_name[] = { "scalaire", "SSE2", "AVX2" };
+
+/* surtout des lettres, assez de spéciaux pour tomber partout dans un bloc */
+static void random_line(char *buf, int len) {
+    static const char alpha[] = "abcdefghij0123456789-_./= \t<>|&;()'\"`\\$\n{}*";
+    int dense = rand() % 4 == 0;
+
+    for (int i = 0; i < len; i++) {
+        if (dense || rand() % 8 == 0)
+            buf[i] = alpha[rand() % (sizeof(alpha) - 1)];
+        else
+            buf[i] = 'a' + rand() % 26;
+        if (rand() % 64 == 0) buf[i] = (char)(128 + rand() % 128);
+    }
+    buf[len] = '\0';
+}
+
+static int same_words(char **a, char **b) {
+    int i;
+    for (i = 0; a[i] && b[i]; i++)
+        if (strcmp(a[i], b[i])) return 0;
+    return !a[i] && !b[i];
+}
+
+static int fuzz(int n) {
+    char buf[300];
+    int top = scan_set_level(SCAN_AVX2);
+
+    printf("versions comparées : scalaire à %s\n", level_name[top]);
+    for (int k = 0; k < n; k++) {
+        int len = rand() % (sizeof(buf) - 1);
+        const char *end = buf + len;
+        random_line(buf, len);
+
+        for (int i = 0; i <= len; i++) {
+            scan_set_level(SCAN_SCALAR);
+            const char *ref = scan_special(buf + i, end);
+            for (int lv = SCAN_SSE2; lv <= top; lv++) {
+                scan_set_level(lv);
+                if (scan_special(buf + i, end) != ref) {
+                    printf("ÉCHEC %s, position %d de « %s »\n",
+                           level_name[lv], i, buf);
+                    return 1;
+                }
+            }
+        }
+
+        char *err_ref = 0;
+        scan_set_level(SCAN_SCALAR);
+        char **ref = split_in_words(buf, &err_ref);
+        for (int lv = SCAN_SSE2; lv <= top; lv++) {
+            char *err = 0;
+            scan_set_level(lv);
+            char **words = split_in_words(buf, &err);
+            if (!same_words(ref, words) || err != err_ref) {
+                printf("ÉCHEC split_in_words %s sur « %s »\n", level_name[lv], buf);
+                return 1;
+            }
+            free_words(words);
+        }
+        free_words(ref);
+    }
+    printf("%d lignes : identiques\n", n);
+    return 0;
+}
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* une longue liste d'arguments, comme celles produites par un script */
+static int bench(int mo) {
+    size_t size = (size_t)mo << 20, len = 0;
+    char *line = malloc(size + 64);
+    int i = 0;
+
+    while (len < size) {
+        len += sprintf(line + len, "build/obj/module_%06d/source_file.o ", i++);
+        if (i % 50 == 0) len += sprintf(line + len, "'quoted arg %d' | ", i);
+    }
+    line[len] = '\0';
+
+    int top = scan_set_level(SCAN_AVX2);
+    for (int lv = SCAN_SCALAR; lv <= top; lv++) {
+        char *err = 0;
+        scan_set_level(lv);
+        double t = now();
+        char **words = split_in_words(line, &err);
+        t = now() - t;
+
+        size_t n = 0;
+        while (words[n]) n++;
+        printf("%-9s %8zu mots  %7.1f ms  %6.1f Mmots/s  %6.0f Mo/s\n",
+               level_name[lv], n, t * 1e3, n / t / 1e6, len / t / 1e6);
+        free_words(words);
+    }
+    free(line);
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    srand(42);
+    if (argc > 1 && strcmp(argv[1], "-b") == 0)
+        return bench(argc > 2 ? atoi(argv[2]) : 64);
+    return fuzz(argc > 1 ? atoi(argv[1]) : 20000);
+}
@@ -0,0 +1,423 @@
+/*
+ * Mode serveur (voir serve.h).
+ *
+ * Une seule boucle pselect : la socket d'écoute, les clients et les
+ * pipes de capture des commandes en cours. SIGCHLD reste bloqué en
+ * dehors de pselect, qui le débloque le temps d'attendre : le handler ne
+ * tourne jamais au milieu de la boucle. Il prévient le serveur par
+ * exec_job_done à la fin d'un job ; la réponse 'S' part quand le job
+ * est fini et que sa sortie est lue jusqu'au bout.
+ *
+ * Les sockets des clients ne bloquent pas : ce qui leur est envoyé
+ * attend dans une file par client, vidée quand pselect les dit prêtes
+ * en écriture. Tant que la file d'un client dépasse CLIENT_QUEUE, on ne
+ * lit plus la sortie de ses commandes : elles bloquent sur leur pipe,
+ * comme derrière un lecteur lent, sans ralentir les autres clients.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <signal.h>
+#include <stdint.h>
+#include <sys/select.h>
+#include <arpa/inet.h>
+#include "csapp.h"
+#include "exec.h"
+#include "ast.h"
+#include "serve.h"
+
+#define FRAME_HDR   9               /* longueur, numéro, type */
+#define FRAME_MAX   (1024 * 1024)   /* commande la plus longue acceptée */
+#define OUTPUT_BUF  (64 * 1024)
+#define CLIENT_QUEUE (256 * 1024)   /* au-delà, sa sortie attend */
+
+/* au plus autant de jobs : chacun a son pipe de capture dans les fd_set
+   de pselect, il faut laisser la place aux clients */
+#define SERVE_MAXJOBS (FD_SETSIZE / 4)
+
+enum { F_RUN = 'C', F_CAPTURE = 'R', F_OUTPUT = 'O', F_STATUS = 'S' };
+
+struct client {
+    int            fd;          /* -1 : parti */
+    char          *buf;         /* trames reçues pas encore traitées */
+    size_t         len, size;
+    char          *out;         /* trames à envoyer, depuis out_off */
+    size_t         out_off, out_len, out_size;
+    int            nsubs;       /* demandes pas encore terminées */
+    struct client *next;
+};
+
+struct sub {
+    struct client *c;
+    uint32_t       id;
+    char          *text;
+    int            capture;
+    int            jid;         /* 0 : en attente de lancement */
+    int            out;         /* pipe de capture, -1 une fois lu */
+    int            done, code;
+    char          *msg;         /* erreur à renvoyer avant le code */
+    struct sub    *next;
+};
+
+static struct client *clients = NULL;
+static struct sub    *subs = NULL;      /* dans l'ordre d'arrivée */
+
+
+/* ── trames ── */
+
+static int send_frame(int fd, uint32_t id, char type, const void *data,
+                      uint32_t len) {
+    char hdr[FRAME_HDR];
+    uint32_t nlen = htonl(len), nid = htonl(id);
+
+    memcpy(hdr, &nlen, 4);
+    memcpy(hdr + 4, &nid, 4);
+    hdr[8] = type;
+    if (rio_writen(fd, hdr, FRAME_HDR) < 0) return -1;
+    if (len && rio_writen(fd, (void *)data, len) < 0) return -1;
+    return 0;
+}
+
+/* met la trame dans la file de c, et en envoie ce qui peut partir */
+static void client_flush(struct client *c);
+
+static void client_send(struct client *c, uint32_t id, char type,
+                        const void *data, uint32_t len) {
+    uint32_t nlen = htonl(len), nid = htonl(id);
+
+    if (c->fd < 0) return;
+    if (c->out_len + FRAME_HDR + len > c->out_size) {
+        /* on tasse avant d'agrandir */
+        memmove(c->out, c->out + c->out_off, c->out_len - c->out_off);
+        c->out_len -= c->out_off;
+        c->out_off = 0;
+        while (c->out_len + FRAME_HDR + len > c->out_size)
+            c->out_size = c->out_size ? 2 * c->out_size : 8192;
+        c->out = Realloc(c->out, c->out_size);
+    }
+    char *hdr = c->out + c->out_len;
+    memcpy(hdr, &nlen, 4);
+    memcpy(hdr + 4, &nid, 4);
+    hdr[8] = type;
+    if (len) memcpy(hdr + FRAME_HDR, data, len);
+    c->out_len += FRAME_HDR + len;
+    client_flush(c);
+}
+
+/* une trame complète au début de buf → sa longueur totale, 0 s'il en
+   manque, -1 si elle est trop longue */
+static long frame_ready(const char *buf, size_t len) {
+    uint32_t dlen;
+
+    if (len < FRAME_HDR) return 0;
+    memcpy(&dlen, buf, 4);
+    dlen = ntohl(dlen);
+    if (dlen > FRAME_MAX) return -1;
+    return (len >= FRAME_HDR + dlen) ? FRAME_HDR + dlen : 0;
+}
+
+
+/* ── côté serveur ── */
+
+static void sub_reply(struct sub *s, const char *out, int code) {
+    if (out && s->capture)
+        client_send(s->c, s->id, F_OUTPUT, out, strlen(out));
+
+    uint32_t ncode = htonl(code);
+    client_send(s->c, s->id, F_STATUS, &ncode, 4);
+}
+
+/* appelé par le handler SIGCHLD (donc pendant pselect) */
+static void job_done(job_t *j, int code) {
+    for (struct sub *s = subs; s; s = s->next) {
+        if (s->jid == j->jid && !s->done) {
+            s->done = 1;
+            s->code = code;
+            return;
+        }
+    }
+}
+
+/* lance la demande s. si elle n'a pas pu partir (erreur d'analyse,
+   ligne vide, échec du lancement), elle est finie tout de suite */
+static void sub_start(struct sub *s) {
+    struct node *root;
+    char *err, msg[256];
+    int p[2] = { -1, -1 };
+
+    int r = ast_parse_cached(s->text, &root, &err);
+    if (r != AST_OK) {
+        snprintf(msg, sizeof(msg), "error: %s\n",
+                 r == AST_MORE ? "unexpected end of file" : err);
+        fputs(msg, stderr);
+        s->msg = strdup(msg);
+        s->done = 1;
+        s->code = 2;
+        return;
+    }
+    if (!root) {
+        s->done = 1;
+        return;
+    }
+
+    if (s->capture && pipe(p) == 0) {
+        if (p[0] >= FD_SETSIZE) {
+            /* pselect ne saurait pas l'attendre */
+            close(p[0]);
+            close(p[1]);
+            ast_release(root);
+            s->msg = strdup("error: trop de descripteurs ouverts\n");
+            s->done = 1;
+            s->code = 1;
+            return;
+        }
+        fcntl(p[0], F_SETFD, FD_CLOEXEC);
+        fcntl(p[1], F_SETFD, FD_CLOEXEC);
+    }
+    s->jid = launch_node(root, p[1], RUNNING);
+    ast_release(root);
+    if (p[1] >= 0) close(p[1]);
+    s->out = p[0];
+
+    if (s->jid < 0) {
+        s->done = 1;
+        s->code = 1;
+    }
+}
+
+/* c est parti (ou on ne le suit plus) : ses commandes continuent, leur
+   sortie est perdue */
+static void client_close(struct client *c) {
+    close(c->fd);
+    c->fd = -1;
+    c->len = 0;
+    c->out_off = c->out_len = 0;
+}
+
+static void client_flush(struct client *c) {
+    while (c->fd >= 0 && c->out_off < c->out_len) {
+        ssize_t n = write(c->fd, c->out + c->out_off,
+                          c->out_len - c->out_off);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return;
+        if (n < 0) {
+            client_close(c);
+            return;
+        }
+        c->out_off += n;
+    }
+    c->out_off = c->out_len = 0;
+}
+
+/* trop de sortie en attente chez c : on ne lit plus celle de ses
+   commandes */
+static int client_behind(const struct client *c) {
+    return c->out_len - c->out_off >= CLIENT_QUEUE;
+}
+
+/* trames arrivées de c */
+static void client_frames(struct client *c) {
+    long n;
+    size_t off = 0;
+
+    while ((n = frame_ready(c->buf + off, c->len - off)) > 0) {
+        char *f = c->buf + off;
+        uint32_t id, dlen = n - FRAME_HDR;
+
+        memcpy(&id, f + 4, 4);
+        if (f[8] == F_RUN || f[8] == F_CAPTURE) {
+            struct sub *s = Calloc(1, sizeof(*s)), **tail = &subs;
+            s->c = c;
+            s->id = ntohl(id);
+            s->capture = (f[8] == F_CAPTURE);
+            s->text = Malloc(dlen + 1);
+            memcpy(s->text, f + FRAME_HDR, dlen);
+            s->text[dlen] = '\0';
+            s->out = -1;
+            while (*tail) tail = &(*tail)->next;
+            *tail = s;
+            c->nsubs++;
+        }
+        off += n;
+    }
+    if (n < 0) {
+        /* trame impossible : on ne peut plus suivre ce client */
+        client_close(c);
+        return;
+    }
+    memmove(c->buf, c->buf + off, c->len - off);
+    c->len -= off;
+}
+
+static void client_read(struct client *c) {
+    if (c->size - c->len < 4096) {
+        c->size = c->size ? c->size * 2 : 8192;
+        c->buf = Realloc(c->buf, c->size);
+    }
+    ssize_t n = read(c->fd, c->buf + c->len, c->size - c->len);
+    if (n < 0 && (errno == EINTR || errno == EAGAIN)) return;
+    if (n <= 0) {
+        client_close(c);
+        return;
+    }
+    c->len += n;
+    client_frames(c);
+}
+
+static void sub_read_output(struct sub *s) {
+    static char buf[OUTPUT_BUF];
+
+    ssize_t n = read(s->out, buf, sizeof(buf));
+    if (n < 0 && errno == EINTR) return;
+    if (n <= 0) {
+        close(s->out);
+        s->out = -1;
+        return;
+    }
+    client_send(s->c, s->id, F_OUTPUT, buf, n);
+}
+
+/* retire les demandes finies (réponse envoyée) et les clients partis
+   qui n'attendent plus rien */
+static void cleanup(void) {
+    for (struct sub **p = &subs; *p; ) {
+        struct sub *s = *p;
+        if (s->done && s->out < 0) {
+            sub_reply(s, s->msg, s->code);
+            free(s->msg);
+            s->c->nsubs--;
+            *p = s->next;
+            free(s->text);
+            free(s);
+        } else {
+            p = &s->next;
+        }
+    }
+    for (struct client **p = &clients; *p; ) {
+        struct client *c = *p;
+        if (c->fd < 0 && c->nsubs == 0) {
+            *p = c->next;
+            free(c->buf);
+            free(c->out);
+            free(c);
+        } else {
+            p = &c->next;
+        }
+    }
+}
+
+int serve(char *path, int maxjobs) {
+    int listenfd = open_unix_listenfd(path);
+    if (listenfd < 0) {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        return 1;
+    }
+    fcntl(listenfd, F_SETFD, FD_CLOEXEC);
+
+    if (maxjobs > SERVE_MAXJOBS) maxjobs = SERVE_MAXJOBS;
+    if (maxjobs < 1) maxjobs = 1;
+
+    signal(SIGPIPE, SIG_IGN);
+    exec_job_done = job_done;
+
+    sigset_t wait_mask;
+    block_sigchld(&wait_mask);      // débloqué seulement dans pselect
+    sigdelset(&wait_mask, SIGCHLD);
+
+    for (;;) {
+        /* les demandes en attente, tant qu'il y a de la place */
+        for (struct sub *s = subs; s && count_jobs() < maxjobs; s = s->next)
+            if (!s->jid && !s->done) sub_start(s);
+        cleanup();
+
+        fd_set rfds, wfds;
+        int maxfd = listenfd;
+        FD_ZERO(&rfds);
+        FD_ZERO(&wfds);
+        FD_SET(listenfd, &rfds);
+        for (struct client *c = clients; c; c = c->next) {
+            if (c->fd < 0) continue;
+            FD_SET(c->fd, &rfds);
+            if (c->out_off < c->out_len) FD_SET(c->fd, &wfds);
+            if (c->fd > maxfd) maxfd = c->fd;
+        }
+        for (struct sub *s = subs; s; s = s->next) {
+            if (s->out < 0 || client_behind(s->c)) continue;
+            FD_SET(s->out, &rfds);
+            if (s->out > maxfd) maxfd = s->out;
+        }
+
+        if (pselect(maxfd + 1, &rfds, &wfds, NULL, NULL, &wait_mask) < 0) {
+            if (errno == EINTR) continue;   // un job a fini
+            fprintf(stderr, "pselect: %s\n", strerror(errno));
+            return 1;
+        }
+
+        for (struct client *c = clients; c; c = c->next)
+            if (c->fd >= 0 && FD_ISSET(c->fd, &wfds)) client_flush(c);
+
+        for (struct sub *s = subs; s; s = s->next)
+            if (s->out >= 0 && FD_ISSET(s->out, &rfds)) sub_read_output(s);
+
+        for (struct client *c = clients; c; c = c->next)
+            if (c->fd >= 0 && FD_ISSET(c->fd, &rfds)) client_read(c);
+
+        if (FD_ISSET(listenfd, &rfds)) {
+            int fd = accept(listenfd, NULL, NULL);
+            if (fd >= 0 && fd >= FD_SETSIZE) {
+                close(fd);          // pselect ne saurait pas l'attendre
+            } else if (fd >= 0) {
+                fcntl(fd, F_SETFD, FD_CLOEXEC);
+                fcntl(fd, F_SETFL, O_NONBLOCK);
+                struct client *c = Calloc(1, sizeof(*c));
+                c->fd = fd;
+                c->next = clients;
+                clients = c;
+            }
+        }
+    }
+}
+
+
+/* ── côté client ── */
+
+int submit(char *path, char *cmd) {
+    char hdr[FRAME_HDR];
+    static char buf[OUTPUT_BUF];
+
+    int fd = open_unix_clientfd(path);
+    if (fd < 0) {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        return 1;
+    }
+    if (send_frame(fd, 1, F_CAPTURE, cmd, strlen(cmd)) < 0) {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        return 1;
+    }
+
+    while (rio_readn(fd, hdr, FRAME_HDR) == FRAME_HDR) {
+        uint32_t len;
+        memcpy(&len, hdr, 4);
+        len = ntohl(len);
+
+        if (hdr[8] == F_STATUS && len == 4) {
+            uint32_t code;
+            if (rio_readn(fd, &code, 4) != 4) break;
+            close(fd);
+            return ntohl(code);
+        }
+        while (len > 0) {
+            size_t n = len < sizeof(buf) ? len : sizeof(buf);
+            if (rio_readn(fd, buf, n) != (ssize_t)n) break;
+            if (hdr[8] == F_OUTPUT) rio_writen(STDOUT_FILENO, buf, n);
+            len -= n;
+        }
+    }
+    fprintf(stderr, "%s: connexion perdue\n", path);
+    close(fd);
+    return 1;
+}
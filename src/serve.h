@@ -0,0 +1,29 @@
+#ifndef __SERVE_H__
+#define __SERVE_H__
+
+/* ── Mode serveur ──
+   shell --serve /chemin.sock [-j N] attend des commandes sur une socket
+   Unix, de plusieurs clients à la fois. Chaque commande passe par
+   l’analyse habituelle (avec le cache de ast.c : une commande envoyée
+   souvent n’est analysée qu’une fois) et tourne comme un job en
+   arrière-plan dans jobs[] ; au plus N jobs à la fois (N ramené à
+   FD_SETSIZE / 4 au plus, pour pselect), tous clients confondus, les
+   autres attendent leur tour. Un client qui ne lit pas sa sortie ne
+   retarde que ses propres commandes.
+
+   Trames, dans les deux sens : longueur (4 octets), numéro de la
+   demande (4 octets, choisi par le client), type (1 octet), puis la
+   longueur d’octets de données. Entiers dans l’ordre réseau.
+     client → serveur  'C' commande, sortie sur celle du serveur
+                       'R' commande, sortie renvoyée au client
+     serveur → client  'O' morceau de sortie (au fur et à mesure)
+                       'S' fin : code de retour (4 octets) */
+
+/* Sert les commandes sur path. Ne revient qu’en cas d’erreur → code */
+int serve(char *path, int maxjobs);
+
+/* shell --submit /chemin.sock commande : envoie la commande, recopie sa
+   sortie sur stdout → son code de retour */
+int submit(char *path, char *cmd);
+
+#endif
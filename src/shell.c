@@ -5,188 +5,120 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <fcntl.h>
 #include <unistd.h>
-#include <sys/wait.h>
+#include <fcntl.h>
 #include "readcmd.h"
 #include <errno.h>
 #include "csapp.h"
 #include <signal.h>
 #include "jobs.h"
-
-/* on bloque SIGCHLD pour éviter que jobs[] soit modifié en même temps */
-static void block_sigchld(sigset_t *prev) {
-    sigset_t mask;
-    sigemptyset(&mask);
-    sigaddset(&mask, SIGCHLD);
-    sigprocmask(SIG_BLOCK, &mask, prev);
-}
-
-/* on remet le masque comme avant */
-static void unblock_sigchld(sigset_t *prev) {
-    sigprocmask(SIG_SETMASK, prev, NULL);
+#include "ast.h"
+#include "exec.h"
+#include "vars.h"
+#include "zygote.h"
+#include "serve.h"
+#include "remote.h"
+#include "timers.h"
+#include "history.h"
+#include "lineedit.h"
+
+/* lit une commande complète : tant que l'arbre n'est pas fini (if sans
+   fi, quote ouverte...) on lit la ligne suivante avec le prompt "> ".
+   retourne le texte (valable jusqu'à l'appel suivant), NULL en fin
+   d'entrée */
+static int interactive = 1;    /* 0 : on lit un script */
+static int editing = 0;        /* sur un terminal : voir lineedit.h */
+
+/* la ligne suivante, après prompt si on est interactif */
+static char *next_line(const char *prompt) {
+    if (editing) return lineedit_read(prompt);
+    if (interactive) {
+        printf("%s", prompt);
+        fflush(stdout);
+    }
+    return readcmd_line();
 }
 
-/* handler appelé quand un fils change d'état */
-void sigchld_handler(int signum) {
-    (void)signum;
-    int status;
-    pid_t pid;
-
-    /* on récupère tous les fils terminés ou stoppés */
-    while ((pid = waitpid(-1, &status, WNOHANG | WUNTRACED)) > 0) {
-        job_t *j = get_job_by_pid(pid);
-        if (!j) continue;
-
-        if (WIFSTOPPED(status)) {
-            j->state = STOPPED;
-            printf("\n[%d] %d Stopped %s\n", j->jid, (int)pid, j->cmd);
-            printf("shell> ");
-            fflush(stdout);
-
-        } else if (WIFEXITED(status) || WIFSIGNALED(status)) {
-            /* si c'était un bg on affiche Done */
-            if (j->state == RUNNING) {
-                printf("\n[%d] %d Done %s\n", j->jid, (int)pid, j->cmd);
-                printf("shell> ");
-                fflush(stdout);
+static char *read_command(struct node **root, char **err, int *r) {
+    static char *cmd;           /* commande sur plusieurs lignes */
+    static size_t cmd_size;
+    size_t len = 0;
+
+    char *text = next_line("shell> ");
+    if (!text) return NULL;
+
+    while ((*r = ast_parse_cached(text, root, err)) == AST_MORE) {
+        /* la ligne est dans le tampon d'entrée : on la garde avant de
+           lire la suivante */
+        if (text != cmd) {
+            len = strlen(text);
+            if (len + 1 > cmd_size) {
+                cmd_size = 2 * (len + 1);
+                cmd = Realloc(cmd, cmd_size);
             }
-            delete_job_by_pid(pid);
+            memcpy(cmd, text, len + 1);
+            text = cmd;
         }
-    }
-}
 
-/* dans le fils on remet les signaux normaux */
-static void reset_signals_in_child(void) {
-    sigset_t empty;
-    sigemptyset(&empty);
-    sigprocmask(SIG_SETMASK, &empty, NULL);
-
-    signal(SIGCHLD, SIG_DFL);
-    signal(SIGINT,  SIG_DFL);
-    signal(SIGTSTP, SIG_DFL);
-    signal(SIGQUIT, SIG_DFL);
-    signal(SIGTERM, SIG_DFL);
-}
-
-/* on attend qu'il n'y ait plus de job en foreground */
-static void wait_fg_job(void) {
-    while (get_fg_job() != NULL) {
-        sleep(1);  // simple boucle, pas optimal mais ok
-    }
-}
-
-/* quit ou q pour quitter */
-static void quitteCommande(struct cmdline *l) {
-    if (l->seq && l->seq[0] && l->seq[0][0] &&
-        (strcmp(l->seq[0][0], "quit") == 0 ||
-         strcmp(l->seq[0][0], "q")    == 0)) {
-        printf("exit prog shell\n");
-        exit(0);
-    }
-}
-
-/* on reconstruit la commande en string pour l'affichage jobs */
-static void build_cmd_str(struct cmdline *l, char *buf, int buflen) {
-    buf[0] = '\0';
-
-    for (int i = 0; l->seq[i] != NULL; i++) {
-        for (int j = 0; l->seq[i][j] != NULL; j++) {
-            strncat(buf, l->seq[i][j], buflen - strlen(buf) - 2);
-            strncat(buf, " ", buflen - strlen(buf) - 1);
+        char *next = next_line("> ");
+        if (!next) {
+            /* fin d'entrée au milieu d'une commande */
+            *r = AST_ERROR;
+            *err = "unexpected end of file";
+            break;
         }
 
-        if (l->seq[i+1] != NULL)
-            strncat(buf, "| ", buflen - strlen(buf) - 1);
-    }
-}
-
-/* affiche tous les jobs */
-static void builtin_jobs(void) {
-    list_jobs();
-}
-
-/* met un job en foreground */
-static void builtin_fg(const char *id_str) {
-    if (!id_str) { fprintf(stderr, "fg: argument manquant\n"); return; }
-
-    sigset_t prev;
-    block_sigchld(&prev);
-
-    job_t *j = get_job_by_id_str(id_str);
-    if (!j) {
-        fprintf(stderr, "fg: job introuvable : %s\n", id_str);
-        unblock_sigchld(&prev);
-        return;
+        size_t nlen = strlen(next);
+        if (len + nlen + 2 > cmd_size) {
+            cmd_size = 2 * (len + nlen + 2);
+            cmd = Realloc(cmd, cmd_size);
+        }
+        cmd[len] = '\n';
+        memcpy(cmd + len + 1, next, nlen + 1);
+        len += nlen + 1;
+        text = cmd;
     }
-
-    printf("%s\n", j->cmd);
-    j->state = FG;
-
-    unblock_sigchld(&prev);
-
-    kill(-(j->pgid), SIGCONT);
-    wait_fg_job();
+    return text;
 }
 
-/* met un job en background */
-static void builtin_bg(const char *id_str) {
-    if (!id_str) { fprintf(stderr, "bg: argument manquant\n"); return; }
+/* shell -c "commande" : tout le texte est la dernière chose à faire */
+static int run_string(char *text) {
+    struct node *root;
+    char *err;
 
-    sigset_t prev;
-    block_sigchld(&prev);
-
-    job_t *j = get_job_by_id_str(id_str);
-    if (!j) {
-        fprintf(stderr, "bg: job introuvable : %s\n", id_str);
-        unblock_sigchld(&prev);
-        return;
+    int r = ast_parse(text, &root, &err);
+    if (r != AST_OK) {
+        fprintf(stderr, "error: %s\n",
+                r == AST_MORE ? "unexpected end of file" : err);
+        return 2;
     }
-
-    j->state = RUNNING;
-    printf("[%d] %d %s\n", j->jid, (int)j->pid, j->cmd);
-
-    unblock_sigchld(&prev);
-
-    kill(-(j->pgid), SIGCONT);
+    run_node(root, 1);
+    fflush(stdout);
+    wait_shell_duties();
+    return last_status;
 }
 
-/* stop un job */
-static void builtin_stop(const char *id_str) {
-    if (!id_str) { fprintf(stderr, "stop: argument manquant\n"); return; }
-
-    sigset_t prev;
-    block_sigchld(&prev);
-
-    job_t *j = get_job_by_id_str(id_str);
-    if (!j) {
-        fprintf(stderr, "stop: job introuvable : %s\n", id_str);
-        unblock_sigchld(&prev);
-        return;
+/* programme principal :
+   shell                  interactif (prompt, affichage de debug)
+   shell -c "commande"    exécute la commande puis sort
+   shell script           exécute les lignes du fichier puis sort
+   shell -z ...           pareil, les commandes sont lancées par un
+                          zygote (voir zygote.h)
+   shell --serve sock [-j N]   serveur de commandes (voir serve.h)
+   shell --submit sock "commande"   client du serveur
+   shell --agent [ADDR:]PORT   agent pour cmd &@ (voir remote.h),
+                          sur 127.0.0.1 si ADDR n'est pas donnée */
+int main(int argc, char **argv)
+{
+    /* -z : le zygote, créé tant que le shell est petit */
+    if (argc >= 2 && strcmp(argv[1], "-z") == 0) {
+        zygote_start();
+        argv++;
+        argc--;
     }
 
-    unblock_sigchld(&prev);
-    kill(-(j->pgid), SIGTSTP);
-}
-
-/* check si c'est une commande builtin */
-static int handle_builtins(struct cmdline *l) {
-    if (!l->seq || !l->seq[0] || !l->seq[0][0]) return 0;
-
-    char *cmd = l->seq[0][0];
-
-    if (strcmp(cmd, "jobs") == 0) { builtin_jobs(); return 1; }
-    if (strcmp(cmd, "fg")   == 0) { builtin_fg(l->seq[0][1]); return 1; }
-    if (strcmp(cmd, "bg")   == 0) { builtin_bg(l->seq[0][1]); return 1; }
-    if (strcmp(cmd, "stop") == 0) { builtin_stop(l->seq[0][1]); return 1; }
-
-    return 0;
-}
-
-/* programme principal */
-int main()
-{
     init_jobs();
+    vars_init(environ);
 
     /* on installe le handler SIGCHLD */
     struct sigaction sa;
@@ -199,164 +131,63 @@ int main()
         exit(1);
     }
 
-    while (1) {
-        struct cmdline *l;
-        int i, j;
-
-        printf("shell> ");
-        fflush(stdout);
-
-        l = readcmd();
-
-        if (!l) {
-            printf("exit\n");
-            exit(0);
-        }
-
-        quitteCommande(l);
-
-        if (l->err) {
-            fprintf(stderr, "error: %s\n", l->err);
-            continue;
-        }
+    readcmd_set_expand_ops(&shell_expand_ops);
+    readcmd_set_timer(timers_fd, timers_run);
 
-        /* debug affichage */
-        if (l->in)  printf("in: %s\n", l->in);
-        if (l->out) printf("out: %s\n", l->out);
+    if (argc >= 3 && strcmp(argv[1], "-c") == 0)
+        exit(run_string(argv[2]));
 
-        for (i = 0; l->seq[i] != 0; i++) {
-            char **cmd = l->seq[i];
-            printf("seq[%d]: ", i);
-            for (j = 0; cmd[j] != 0; j++) printf("%s ", cmd[j]);
-            printf("\n");
+    if (argc >= 3 && strcmp(argv[1], "--serve") == 0) {
+        int maxjobs = sysconf(_SC_NPROCESSORS_ONLN);
+        if (argc >= 5 && strcmp(argv[3], "-j") == 0) maxjobs = atoi(argv[4]);
+        exit(serve(argv[2], maxjobs));
+    }
+    if (argc >= 4 && strcmp(argv[1], "--submit") == 0)
+        exit(submit(argv[2], argv[3]));
+    if (argc >= 3 && strcmp(argv[1], "--agent") == 0)
+        exit(agent(argv[2]));
+
+    if (argc >= 2) {
+        int fd = open(argv[1], O_RDONLY | O_CLOEXEC);  // pas pour les commandes
+        if (fd < 0) {
+            fprintf(stderr, "%s: %s\n", argv[1], strerror(errno));
+            exit(127);
         }
+        readcmd_set_input(fd);
+        interactive = 0;
+    } else {
+        exec_debug = 1;
+        exec_interactive = 1;
+        editing = lineedit_usable();
+    }
 
-        if (handle_builtins(l)) continue;
-
-        int nb_cmd = 0;
-        if (l->seq[0] == NULL) continue;
-        while (l->seq[nb_cmd] != NULL) nb_cmd++;
-
-        char cmd_str[MAXCMD];
-        build_cmd_str(l, cmd_str, MAXCMD);
-
-        /* cas simple */
-        if (nb_cmd == 1) {
-            sigset_t prev;
-            block_sigchld(&prev);  // important avant fork
-
-            pid_t pid = fork();
-
-            if (pid < 0) {
-                fprintf(stderr, "fork: failed\n");
-                unblock_sigchld(&prev);
-                continue;
-            }
-
-            if (pid == 0) {
-                reset_signals_in_child();
-                setpgid(0, 0);
-
-                /* redirection entrée */
-                if (l->in) {
-                    int fd_in = open(l->in, O_RDONLY);
-                    if (fd_in < 0) {
-                        fprintf(stderr, "%s: %s\n", l->in, strerror(errno));
-                        exit(1);
-                    }
-                    dup2(fd_in, STDIN_FILENO);
-                    close(fd_in);
-                }
-
-                /* redirection sortie */
-                if (l->out) {
-                    int fd_out = open(l->out, O_WRONLY | O_CREAT | O_TRUNC, 0644);
-                    if (fd_out < 0) {
-                        fprintf(stderr, "%s: %s\n", l->out, strerror(errno));
-                        exit(1);
-                    }
-                    dup2(fd_out, STDOUT_FILENO);
-                    close(fd_out);
-                }
-
-                execvp(l->seq[0][0], l->seq[0]);
-
-                fprintf(stderr, "%s: command not found\n", l->seq[0][0]);
-                exit(127);
-            }
+    while (1) {
+        struct node *root;
+        char *err;
+        int r;
 
-            setpgid(pid, pid);
+        char *text = read_command(&root, &err, &r);
 
-            if (!l->background) {
-                add_job(pid, pid, FG, cmd_str);
-                unblock_sigchld(&prev);
-                wait_fg_job();
-            } else {
-                int jid = add_job(pid, pid, RUNNING, cmd_str);
-                unblock_sigchld(&prev);
-                printf("[%d] %d\n", jid, (int)pid);
+        if (!text) {
+            if (!interactive) {
+                wait_shell_duties();
+                exit(last_status);
             }
+            printf("exit\n");
+            exit(0);
         }
 
-        /* pipeline */
-        else if (nb_cmd > 1) {
-            int pipefd[nb_cmd-1][2];
-
-            for (int i = 0; i < nb_cmd-1; i++) {
-                if (pipe(pipefd[i]) < 0) {
-                    fprintf(stderr, "pipe failed\n");
-                    continue;
-                }
-            }
-
-            sigset_t prev;
-            block_sigchld(&prev);
-
-            pid_t first_pid = -1;
-
-            for (int i = 0; i < nb_cmd; i++) {
-                pid_t pid = fork();
-
-                if (pid == 0) {
-                    reset_signals_in_child();
-
-                    if (first_pid == -1) setpgid(0, 0);
-                    else setpgid(0, first_pid);
+        /* une commande tapée (même fausse) va dans l'historique */
+        if (interactive && (isatty(STDIN_FILENO) || var_get("HISTFILE")))
+            history_add(text);
 
-                    if (i > 0) {
-                        dup2(pipefd[i-1][0], STDIN_FILENO);
-                    }
-
-                    if (i < nb_cmd-1) {
-                        dup2(pipefd[i][1], STDOUT_FILENO);
-                    }
-
-                    execvp(l->seq[i][0], l->seq[i]);
-                    exit(127);
-                }
-
-                if (first_pid == -1) {
-                    first_pid = pid;
-                    setpgid(pid, pid);
-                } else {
-                    setpgid(pid, first_pid);
-                }
-            }
-
-            for (int i = 0; i < nb_cmd-1; i++) {
-                close(pipefd[i][0]);
-                close(pipefd[i][1]);
-            }
-
-            if (!l->background) {
-                add_job(first_pid, first_pid, FG, cmd_str);
-                unblock_sigchld(&prev);
-                wait_fg_job();
-            } else {
-                int jid = add_job(first_pid, first_pid, RUNNING, cmd_str);
-                unblock_sigchld(&prev);
-                printf("[%d] %d\n", jid, (int)first_pid);
-            }
+        if (r != AST_OK) {
+            fprintf(stderr, "error: %s\n", err);
+            continue;
         }
+
+        /* dernière ligne d'un script : exec sans fork possible */
+        run_node(root, !interactive && readcmd_eof());
+        ast_release(root);
     }
-}
\ No newline at end of file
+}
@@ -0,0 +1,21 @@
+#ifndef __SHELL_PLUGIN_H__
+#define __SHELL_PLUGIN_H__
+
+/* ── Commandes chargées par enable -f lib.so nom ──
+   La bibliothèque exporte pour chaque commande nom une fonction
+   nom_builtin de type shell_builtin_fn. Elle est appelée avec les
+   arguments (argv[0] = nom, argv[argc] = NULL), l’entrée et la sortie à
+   utiliser, et retourne le code de retour de la commande.
+
+   Seule, la commande tourne dans le shell lui-même : elle ne doit pas
+   appeler exit(), ni garder de mémoire ou de descripteurs d’un appel à
+   l’autre sans le vouloir, et doit écrire sur fd_out et pas sur stdout.
+   Dans un pipeline, elle tourne dans le fils de l’étage.
+
+   Compilation : gcc -fPIC -shared -o lib.so lib.c */
+
+#define SHELL_BUILTIN_SUFFIX "_builtin"
+
+typedef int (*shell_builtin_fn)(int argc, char **argv, int fd_in, int fd_out);
+
+#endif
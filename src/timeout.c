@@ -0,0 +1,248 @@
+/*
+ * timeout (voir timeout.h).
+ *
+ * Le tas ne contient que (échéance, jid). Une entrée n'est plus valable
+ * si le job a disparu ou si son échéance a changé (fini avant, SIGKILL
+ * reporté...) : on ne la cherche pas dans le tas pour l'enlever, elle est
+ * ignorée quand elle arrive en haut.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <signal.h>
+#include <stdint.h>
+#include <sys/timerfd.h>
+#include "csapp.h"
+#include "exec.h"
+#include "jobs.h"
+#include "timers.h"
+#include "timeout.h"
+
+struct entry {
+    long long when;     /* timers_now() */
+    int       jid;
+};
+
+static struct entry *heap = NULL;
+static int nheap = 0, heap_size = 0;
+static int tfd = -1;
+static pid_t owner = 0;         /* un sous-shell repart de zéro */
+
+static void heap_swap(int a, int b) {
+    struct entry e = heap[a];
+    heap[a] = heap[b];
+    heap[b] = e;
+}
+
+static void heap_push(long long when, int jid) {
+    if (nheap == heap_size) {
+        heap_size = heap_size ? 2 * heap_size : 16;
+        heap = Realloc(heap, heap_size * sizeof(struct entry));
+    }
+    int i = nheap++;
+    heap[i].when = when;
+    heap[i].jid = jid;
+    while (i > 0 && heap[(i - 1) / 2].when > heap[i].when) {
+        heap_swap(i, (i - 1) / 2);
+        i = (i - 1) / 2;
+    }
+}
+
+static struct entry heap_pop(void) {
+    struct entry top = heap[0];
+    heap[0] = heap[--nheap];
+    for (int i = 0;;) {
+        int m = i, l = 2 * i + 1, r = 2 * i + 2;
+        if (l < nheap && heap[l].when < heap[m].when) m = l;
+        if (r < nheap && heap[r].when < heap[m].when) m = r;
+        if (m == i) break;
+        heap_swap(i, m);
+        i = m;
+    }
+    return top;
+}
+
+/* le timer sur l'échéance la plus proche (désarmé si le tas est vide) */
+static void arm(void) {
+    struct itimerspec it;
+    memset(&it, 0, sizeof(it));
+    if (nheap > 0) {
+        it.it_value.tv_sec = heap[0].when / 1000;
+        it.it_value.tv_nsec = (heap[0].when % 1000) * 1000000;
+        if (heap[0].when <= 0) it.it_value.tv_nsec = 1;
+    }
+    timerfd_settime(tfd, TFD_TIMER_ABSTIME, &it, NULL);
+}
+
+/* le job j est arrivé à son échéance */
+static void expire(job_t *j, long long now) {
+    if (j->timed_out) {
+        kill(-(j->pgid), SIGKILL);
+        j->deadline = 0;
+        return;
+    }
+
+    j->timed_out = 1;
+    kill(-(j->pgid), j->deadline_sig);
+    /* arrêté (stop, Ctrl-Z, gang) : il doit pouvoir recevoir le signal */
+    if (j->state == STOPPED || j->state == PAUSED) {
+        kill(-(j->pgid), SIGCONT);
+        j->state = RUNNING;
+    }
+    if (j->kill_after > 0) {
+        j->deadline = now + j->kill_after;
+        heap_push(j->deadline, j->jid);
+    } else {
+        j->deadline = 0;
+    }
+}
+
+static void timeout_tick(void) {
+    uint64_t ticks;
+
+    if (read(tfd, &ticks, sizeof(ticks)) != sizeof(ticks)) return;
+
+    sigset_t prev;
+    block_sigchld(&prev);
+
+    long long now = timers_now();
+    while (nheap > 0 && heap[0].when <= now) {
+        struct entry e = heap_pop();
+        job_t *j = get_job_by_jid(e.jid);
+        if (j && j->deadline == e.when && j->state != DONE) expire(j, now);
+    }
+    arm();
+
+    unblock_sigchld(&prev);
+}
+
+void timeout_set(int jid, const struct timeout_spec *t) {
+    sigset_t prev;
+    block_sigchld(&prev);
+
+    if (owner != getpid()) {
+        /* le tas et le timer sont ceux du père (timers_forget a fermé
+           notre copie du timer) */
+        nheap = 0;
+        tfd = -1;
+        owner = getpid();
+    }
+    if (tfd < 0) {
+        tfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        if (tfd >= 0 && timers_add(tfd, timeout_tick) < 0) {
+            close(tfd);
+            tfd = -1;
+        }
+        if (tfd < 0) perror("timeout");
+    }
+
+    job_t *j = get_job_by_jid(jid);
+    if (j && tfd >= 0) {
+        j->deadline = timers_now() + t->ms;
+        j->deadline_sig = t->sig;
+        j->kill_after = t->kill_ms;
+        j->timed_out = 0;
+        heap_push(j->deadline, jid);
+        arm();
+    }
+
+    unblock_sigchld(&prev);
+}
+
+int timeout_pending(void) {
+    if (owner != getpid()) return 0;
+
+    /* le tas garde les échéances des jobs finis jusqu'à leur tour */
+    sigset_t prev;
+    block_sigchld(&prev);
+    int live = 0;
+    for (int i = 0; i < nheap && !live; i++) {
+        job_t *j = get_job_by_jid(heap[i].jid);
+        live = j && j->deadline == heap[i].when && j->state != DONE;
+    }
+    unblock_sigchld(&prev);
+    return live;
+}
+
+long parse_duration(const char *s) {
+    char *end;
+    double v = strtod(s, &end);
+
+    if (end == s || v < 0) return -1;
+    if (strcmp(end, "") == 0 || strcmp(end, "s") == 0) v *= 1000;
+    else if (strcmp(end, "m") == 0) v *= 60 * 1000;
+    else if (strcmp(end, "h") == 0) v *= 3600 * 1000;
+    else if (strcmp(end, "d") == 0) v *= 86400 * 1000;
+    else return -1;
+    return (long)v;
+}
+
+/* "TERM", "SIGTERM" ou "15" → numéro, -1 si inconnu */
+static int parse_signal(const char *s) {
+    static const struct { const char *name; int sig; } sigs[] = {
+        { "HUP", SIGHUP }, { "INT", SIGINT }, { "QUIT", SIGQUIT },
+        { "KILL", SIGKILL }, { "USR1", SIGUSR1 }, { "USR2", SIGUSR2 },
+        { "ALRM", SIGALRM }, { "TERM", SIGTERM }, { "CONT", SIGCONT },
+        { "STOP", SIGSTOP }, { "TSTP", SIGTSTP },
+    };
+    char *end;
+    long n = strtol(s, &end, 10);
+
+    if (end != s && *end == '\0') return n > 0 && n < NSIG ? n : -1;
+    if (strncasecmp(s, "SIG", 3) == 0) s += 3;
+    for (size_t k = 0; k < sizeof(sigs) / sizeof(sigs[0]); k++)
+        if (strcasecmp(s, sigs[k].name) == 0) return sigs[k].sig;
+    return -1;
+}
+
+int is_timeout(struct cmdline *l) {
+    return l->seq[0] && l->seq[0][0] && strcmp(l->seq[0][0], "timeout") == 0;
+}
+
+int timeout_parse(struct cmdline *l, struct timeout_spec *t) {
+    char **w = l->seq[0];
+    int i = 1;
+
+    t->ms = -1;
+    t->sig = SIGTERM;
+    t->kill_ms = TIMEOUT_KILL_MS;
+
+    /* les options avant ou après la durée */
+    for (; w[i]; i++) {
+        if (strcmp(w[i], "-s") == 0 && w[i + 1]) {
+            if ((t->sig = parse_signal(w[++i])) < 0) {
+                fprintf(stderr, "timeout: signal inconnu : %s\n", w[i]);
+                return -1;
+            }
+        } else if (strcmp(w[i], "-k") == 0 && w[i + 1]) {
+            if ((t->kill_ms = parse_duration(w[++i])) < 0) {
+                fprintf(stderr, "timeout: durée invalide : %s\n", w[i]);
+                return -1;
+            }
+        } else if (t->ms < 0) {
+            if ((t->ms = parse_duration(w[i])) < 0) {
+                fprintf(stderr, "timeout: durée invalide : %s\n", w[i]);
+                return -1;
+            }
+        } else {
+            break;
+        }
+    }
+    if (t->ms < 0 || !w[i]) {
+        fprintf(stderr, "timeout: usage : timeout DURÉE [-s SIG] "
+                        "[-k DURÉE] cmd\n");
+        return -1;
+    }
+
+    /* on enlève les i premiers mots (les <(...) du premier étage suivent) */
+    int rest = 0;
+    while (w[i + rest]) rest++;
+    for (int k = 0; k < i; k++) free(w[k]);
+    memmove(w, w + i, (rest + 1) * sizeof(char *));
+    for (int k = 0; k < l->nprocsub; k++)
+        if (l->procsub[k].stage == 0) l->procsub[k].arg -= i;
+    return 0;
+}
@@ -0,0 +1,51 @@
+#ifndef __TIMEOUT_H__
+#define __TIMEOUT_H__
+
+#include "readcmd.h"
+
+/* ── timeout DURÉE [-s SIG] [-k DURÉE] cmd ──
+   cmd (une commande ou un pipeline, au premier plan ou avec &) est
+   lancée comme d’habitude, sans processus de plus : l’échéance est
+   gardée dans le job (jobs montre le temps qui reste). À l’échéance, le
+   groupe du job reçoit SIG (TERM par défaut), et SIGCONT s’il était
+   arrêté ; s’il est encore là après la durée de -k (5 s par défaut,
+   -k 0 : jamais), SIGKILL. Le job sort alors avec 124, comme avec
+   timeout(1). Une commande interne tourne dans le shell : elle est
+   exécutée sans échéance.
+
+   Une durée est un nombre (décimales permises) de secondes, ou suivi de
+   s, m, h ou d.
+
+   Toutes les échéances sont dans un tas, la plus proche en haut, et un
+   seul timerfd (voir timers.h) est armé sur celle-ci. C’est le shell qui
+   les applique : un script (ou un -c) qui finit avant attend la dernière,
+   et sa dernière commande n’est pas lancée par exec à sa place. */
+
+#define TIMEOUT_STATUS   124    /* code d’un job arrêté par son échéance */
+#define TIMEOUT_FAILED   125    /* timeout mal utilisé */
+#define TIMEOUT_KILL_MS 5000    /* -k par défaut */
+
+struct timeout_spec {
+    long ms;        /* durée */
+    int  sig;       /* -s */
+    long kill_ms;   /* -k, 0 : pas de SIGKILL */
+};
+
+/* Vrai si la ligne l (expansée) commence par timeout */
+int  is_timeout(struct cmdline *l);
+
+/* Lit "timeout DURÉE [-s SIG] [-k DURÉE]" au début de l et l’enlève :
+   il reste la commande → 0, -1 si erreur (message déjà affiché) */
+int  timeout_parse(struct cmdline *l, struct timeout_spec *t);
+
+/* Donne au job jid l’échéance t, à partir de maintenant */
+void timeout_set(int jid, const struct timeout_spec *t);
+
+/* Vrai s’il reste un job avec une échéance : le shell doit être là
+   pour l’appliquer (voir wait_shell_duties, exec.h) */
+int  timeout_pending(void);
+
+/* "1.5", "90s", "2m", "1h", "1d" → millisecondes, -1 si invalide */
+long parse_duration(const char *s);
+
+#endif
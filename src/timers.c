@@ -0,0 +1,82 @@
+/*
+ * Les timers du shell (voir timers.h) : un epoll et la liste des
+ * timerfd qu'il contient, avec leur fonction.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/epoll.h>
+#include "csapp.h"
+#include "timers.h"
+
+#define MAXTIMERS 8
+
+struct timer {
+    int  fd;
+    void (*tick)(void);
+};
+
+static int epfd = -1;
+static struct timer timers[MAXTIMERS];
+static int ntimers = 0;
+
+int timers_add(int fd, void (*tick)(void)) {
+    if (ntimers == MAXTIMERS) return -1;
+    if (epfd < 0 && (epfd = epoll_create1(EPOLL_CLOEXEC)) < 0) return -1;
+
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.fd = fd;
+    if (epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev) < 0) return -1;
+
+    timers[ntimers].fd = fd;
+    timers[ntimers].tick = tick;
+    ntimers++;
+    return 0;
+}
+
+void timers_remove(int fd) {
+    for (int i = 0; i < ntimers; i++) {
+        if (timers[i].fd == fd) {
+            epoll_ctl(epfd, EPOLL_CTL_DEL, fd, NULL);
+            timers[i] = timers[--ntimers];
+            return;
+        }
+    }
+}
+
+int timers_fd(void) {
+    return ntimers > 0 ? epfd : -1;
+}
+
+void timers_run(void) {
+    struct epoll_event ev[MAXTIMERS];
+
+    if (ntimers == 0) return;
+    int n = epoll_wait(epfd, ev, MAXTIMERS, 0);
+    for (int i = 0; i < n; i++) {
+        /* un tick peut retirer des timers (gang off) : on le recherche */
+        for (int k = 0; k < ntimers; k++) {
+            if (timers[k].fd == ev[i].data.fd) {
+                timers[k].tick();
+                break;
+            }
+        }
+    }
+}
+
+void timers_forget(void) {
+    /* fermer nos copies ne touche pas aux timers du père */
+    for (int i = 0; i < ntimers; i++) close(timers[i].fd);
+    if (epfd >= 0) close(epfd);
+    epfd = -1;
+    ntimers = 0;
+}
+
+long long timers_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
@@ -0,0 +1,34 @@
+#ifndef __TIMERS_H__
+#define __TIMERS_H__
+
+/* ── Les timers du shell ──
+   gang, timeout et every ont chacun leur timerfd, after un eventfd que
+   le handler SIGCHLD rend lisible ; ils sont tous dans un même epoll.
+   Quand le shell dort (il lit une commande, attend un job au premier
+   plan ou un wait), il ne surveille que timers_fd() et appelle
+   timers_run() quand il est lisible : chaque timer arrivé à échéance
+   voit sa fonction tick appelée.
+
+   Un sous-shell (fils) ne doit pas consommer les échéances du shell
+   (mêmes descripteurs) : il appelle timers_forget(). */
+
+/* Ajoute le timerfd fd, tick() sera appelée quand il est lisible
+   → 0, -1 si erreur */
+int  timers_add(int fd, void (*tick)(void));
+
+/* Le retire (sans le fermer) */
+void timers_remove(int fd);
+
+/* Descripteur à surveiller, -1 s’il n’y a aucun timer */
+int  timers_fd(void);
+
+/* Appelle les tick() des timers arrivés à échéance, sans attendre */
+void timers_run(void);
+
+/* Dans un fils : oublie les timers du père */
+void timers_forget(void);
+
+/* Horloge des timers (CLOCK_MONOTONIC), en millisecondes */
+long long timers_now(void);
+
+#endif
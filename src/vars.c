@@ -0,0 +1,227 @@
+/*
+ * Variables du shell (voir vars.h).
+ *
+ * Chaque variable garde sa chaîne "NAME=valeur" telle qu'elle ira dans
+ * l'environnement : la valeur n'est qu'un pointeur après le '='. Le
+ * tableau envp pointe directement sur ces chaînes ; env_dirty dit s'il
+ * faut le refaire, il n'est mis que par un changement sur une variable
+ * exportée.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "csapp.h"
+#include "vars.h"
+
+#define VARS_BUCKETS 256
+
+struct var {
+    char       *str;        /* "NAME=valeur", NULL si pas de valeur */
+    char       *name;
+    int         exported;
+    struct var *next;
+};
+
+static struct var *table[VARS_BUCKETS];
+
+static char **envp;         /* environnement des commandes */
+static int    env_count;
+static int    env_dirty = 1;
+
+static char **stale;        /* anciennes chaînes encore dans envp */
+static int    nstale, stale_size;
+
+static unsigned long hash_name(const char *s) {
+    unsigned long h = 1469598103934665603UL;
+    for (; *s; s++) {
+        h ^= (unsigned char)*s;
+        h *= 1099511628211UL;
+    }
+    return h;
+}
+
+static struct var *find(const char *name, int create) {
+    struct var **head = &table[hash_name(name) % VARS_BUCKETS];
+
+    for (struct var *v = *head; v; v = v->next)
+        if (strcmp(v->name, name) == 0) return v;
+    if (!create) return NULL;
+
+    struct var *v = Calloc(1, sizeof(*v));
+    v->name = strdup(name);
+    v->next = *head;
+    *head = v;
+    return v;
+}
+
+int var_is_assign(const char *s, int *len) {
+    int i = 0;
+
+    if (!(s[0] == '_' || (s[0] >= 'a' && s[0] <= 'z') ||
+          (s[0] >= 'A' && s[0] <= 'Z')))
+        return 0;
+    while (s[i] == '_' || (s[i] >= 'a' && s[i] <= 'z') ||
+           (s[i] >= 'A' && s[i] <= 'Z') || (s[i] >= '0' && s[i] <= '9'))
+        i++;
+    if (s[i] != '=') return 0;
+    *len = i;
+    return 1;
+}
+
+void vars_init(char **env) {
+    for (int i = 0; env && env[i]; i++) {
+        char *eq = strchr(env[i], '=');
+        if (!eq) continue;
+
+        char name[eq - env[i] + 1];
+        memcpy(name, env[i], eq - env[i]);
+        name[eq - env[i]] = '\0';
+        var_set(name, eq + 1, 1);
+    }
+}
+
+const char *var_get(const char *name) {
+    struct var *v = find(name, 0);
+    return (v && v->str) ? v->str + strlen(v->name) + 1 : NULL;
+}
+
+size_t var_get_size(const char *name, size_t def) {
+    const char *v = var_get(name);
+    char *end;
+
+    if (!v) return def;
+    double n = strtod(v, &end);
+    if (end == v || n < 1) return def;
+    if (*end == 'k' || *end == 'K') n *= 1024, end++;
+    else if (*end == 'm' || *end == 'M') n *= 1024 * 1024, end++;
+    else if (*end == 'g' || *end == 'G') n *= 1024 * 1024 * 1024, end++;
+    return *end ? def : (size_t)n;
+}
+
+/* s est peut-être encore dans envp : libérée quand le tableau est refait */
+static void retire(char *s) {
+    if (!s) return;
+    if (nstale >= stale_size) {
+        stale_size = stale_size ? stale_size * 2 : 16;
+        stale = Realloc(stale, stale_size * sizeof(char *));
+    }
+    stale[nstale++] = s;
+}
+
+void var_set(const char *name, const char *value, int export) {
+    struct var *v = find(name, 1);
+    size_t nl = strlen(name), vl = strlen(value);
+
+    if (v->exported) {
+        retire(v->str);
+        env_dirty = 1;
+    } else {
+        free(v->str);
+    }
+
+    v->str = Malloc(nl + vl + 2);
+    memcpy(v->str, name, nl);
+    v->str[nl] = '=';
+    memcpy(v->str + nl + 1, value, vl + 1);
+
+    if (export >= 0 && export != v->exported) {
+        v->exported = export;
+        env_dirty = 1;
+    }
+}
+
+void var_export(const char *name) {
+    struct var *v = find(name, 1);
+
+    if (!v->exported) {
+        v->exported = 1;
+        if (v->str) env_dirty = 1;
+    }
+}
+
+void var_unset(const char *name) {
+    struct var **p = &table[hash_name(name) % VARS_BUCKETS];
+
+    for (; *p; p = &(*p)->next) {
+        struct var *v = *p;
+        if (strcmp(v->name, name) != 0) continue;
+
+        *p = v->next;
+        if (v->exported && v->str) {
+            retire(v->str);
+            env_dirty = 1;
+        } else {
+            free(v->str);
+        }
+        free(v->name);
+        free(v);
+        return;
+    }
+}
+
+char **vars_envp(void) {
+    if (!env_dirty) return environ = envp;
+
+    env_count = 0;
+    for (int b = 0; b < VARS_BUCKETS; b++)
+        for (struct var *v = table[b]; v; v = v->next)
+            if (v->exported && v->str) env_count++;
+
+    envp = Realloc(envp, (env_count + 1) * sizeof(char *));
+    int n = 0;
+    for (int b = 0; b < VARS_BUCKETS; b++)
+        for (struct var *v = table[b]; v; v = v->next)
+            if (v->exported && v->str) envp[n++] = v->str;
+    envp[n] = NULL;
+
+    for (int i = 0; i < nstale; i++) free(stale[i]);
+    nstale = 0;
+    env_dirty = 0;
+    return environ = envp;
+}
+
+/* même nom de variable : s1 et s2 commencent par "NAME=" */
+static int same_name(const char *s1, const char *s2) {
+    while (*s1 == *s2 && *s1 != '=') s1++, s2++;
+    return *s1 == '=' && *s2 == '=';
+}
+
+char **vars_merge(char **base, char **assign) {
+    int n = 0, k = 0, count = 0;
+
+    while (base[count]) count++;
+    while (assign[k]) k++;
+
+    char **env = Malloc((count + k + 1) * sizeof(char *));
+    for (int i = 0; i < count; i++) {
+        int hidden = 0;
+        for (int j = 0; j < k && !hidden; j++)
+            hidden = same_name(base[i], assign[j]);
+        if (!hidden) env[n++] = base[i];
+    }
+    for (int j = 0; j < k; j++) env[n++] = assign[j];
+    env[n] = NULL;
+    return env;
+}
+
+char **vars_overlay(char **assign) {
+    return environ = vars_merge(vars_envp(), assign);
+}
+
+static int cmp_str(const void *a, const void *b) {
+    return strcmp(*(char * const *)a, *(char * const *)b);
+}
+
+void vars_print_exported(void) {
+    char **env = vars_envp();
+    char **sorted = Malloc((env_count + 1) * sizeof(char *));
+
+    memcpy(sorted, env, (env_count + 1) * sizeof(char *));
+    qsort(sorted, env_count, sizeof(char *), cmp_str);
+    for (int i = 0; i < env_count; i++) {
+        const char *eq = strchr(sorted[i], '=');
+        printf("export %.*s=\"%s\"\n", (int)(eq - sorted[i]), sorted[i], eq + 1);
+    }
+    free(sorted);
+}
@@ -0,0 +1,53 @@
+#ifndef __VARS_H__
+#define __VARS_H__
+
+#include <stddef.h>
+
+/* ── Variables du shell ──
+   Une table de hachage nom → valeur, avec un drapeau export. Les
+   variables exportées forment l’environnement des commandes : le tableau
+   envp est gardé entre deux commandes et n’est refait que si une
+   variable exportée a changé.
+   Pour NAME=valeur cmd, le fils part de ce tableau et remplace les
+   entrées concernées (vars_overlay) : rien n’est recopié dans le shell. */
+
+/* Importe l’environnement reçu (tout est exporté) */
+void        vars_init(char **envp);
+
+/* Valeur de name, NULL si elle n’existe pas */
+const char *var_get(const char *name);
+
+/* Taille en octets donnée par name ("4096", "64k", "2m", "1g"), def si
+   elle n’existe pas ou n’en est pas une */
+size_t      var_get_size(const char *name, size_t def);
+
+/* Donne la valeur value à name (créée si besoin). export : 1 pour
+   l’exporter, 0 pour ne plus l’exporter, -1 pour ne pas changer */
+void        var_set(const char *name, const char *value, int export);
+
+/* Exporte name sans changer sa valeur (elle n’est dans l’environnement
+   qu’une fois définie) */
+void        var_export(const char *name);
+
+void        var_unset(const char *name);
+
+/* Vrai si le mot s est de la forme NAME=..., et alors *len = longueur
+   de NAME */
+int         var_is_assign(const char *s, int *len);
+
+/* Environnement des commandes (aussi mis dans environ) : refait seulement
+   si une variable exportée a changé depuis le dernier appel */
+char      **vars_envp(void);
+
+/* Environnement avec en plus les NAME=valeur de assign (tableau terminé
+   par NULL) : à appeler dans le fils, juste avant exec */
+char      **vars_overlay(char **assign);
+
+/* Nouveau tableau : base (un envp) avec les NAME=valeur de assign à la
+   place des entrées de même nom. Les chaînes ne sont pas recopiées */
+char      **vars_merge(char **base, char **assign);
+
+/* Affiche les variables exportées sous la forme export NAME=valeur */
+void        vars_print_exported(void);
+
+#endif
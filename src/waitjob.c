@@ -0,0 +1,161 @@
+/*
+ * Builtin wait (voir waitjob.h).
+ *
+ * Les jobs attendus sont marqués (waited) : à leur fin, le handler
+ * SIGCHLD les met dans l'état Done au lieu de les retirer. SIGCHLD reste
+ * bloqué pendant qu'on regarde jobs[] ; pselect le débloque le temps de
+ * dormir, comme sigsuspend dans wait_fg_job : pas de fin de job perdue
+ * entre le test et l'attente.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <signal.h>
+#include <stdint.h>
+#include <sys/select.h>
+#include <sys/syscall.h>
+#include <sys/timerfd.h>
+#include "csapp.h"
+#include "exec.h"
+#include "jobs.h"
+#include "timers.h"
+#include "waitjob.h"
+
+#ifndef SYS_pidfd_open
+#define SYS_pidfd_open 434
+#endif
+
+/* les pidfd des processus encore vivants des jobs attendus (select n'en
+   surveille pas plus de FD_SETSIZE) */
+struct pidfds {
+    int fd[FD_SETSIZE];
+    int n;
+};
+
+static void open_pidfds(struct pidfds *p, const int *sel, int nsel) {
+    p->n = 0;
+    for (int s = 0; s < nsel; s++) {
+        job_t *j = get_job_by_jid(sel[s]);
+        if (!j || j->state == DONE) continue;
+        for (int k = 0; k < j->nprocs; k++) {
+            int fd = syscall(SYS_pidfd_open, j->procs[k], 0);
+            /* sans pidfd (noyau < 5.3, ou trop de processus), c'est
+               SIGCHLD qui réveille */
+            if (fd < 0) continue;
+            if (fd >= FD_SETSIZE || p->n == FD_SETSIZE) close(fd);
+            else p->fd[p->n++] = fd;
+        }
+    }
+}
+
+static void close_pidfds(struct pidfds *p) {
+    for (int i = 0; i < p->n; i++) close(p->fd[i]);
+    p->n = 0;
+}
+
+/* timer de -t (un seul coup), -1 sans limite */
+static int open_timeout(long timeout_ms) {
+    if (timeout_ms < 0) return -1;
+
+    int fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (fd < 0) return -1;
+
+    struct itimerspec it;
+    memset(&it, 0, sizeof(it));
+    it.it_value.tv_sec = timeout_ms / 1000;
+    it.it_value.tv_nsec = (timeout_ms % 1000) * 1000000;
+    if (timeout_ms == 0) it.it_value.tv_nsec = 1;   /* 0 désarmerait */
+    timerfd_settime(fd, 0, &it, NULL);
+    return fd;
+}
+
+static void add_fd(int fd, fd_set *rd, int *maxfd) {
+    if (fd < 0) return;
+    FD_SET(fd, rd);
+    if (fd > *maxfd) *maxfd = fd;
+}
+
+int wait_jobs(const int *jids, int n, int any, long timeout_ms) {
+    int sel[MAXJOBS], nsel = 0;
+    int code = n == 0 && !any ? 0 : WAIT_NOJOB;
+    int last = 0;       /* sans -n, le code est celui du dernier de la liste */
+
+    sigset_t prev;
+    block_sigchld(&prev);
+
+    /* les jobs à attendre (pas celui du premier plan : c'est nous) */
+    if (n == 0) {
+        for (job_t *j = first_job(); j; j = next_job(j))
+            if (j->state != FG) sel[nsel++] = j->jid;
+    } else {
+        for (int i = 0; i < n && nsel < MAXJOBS; i++) {
+            job_t *j = get_job_by_jid(jids[i]);
+            if (j && j->state != FG) sel[nsel++] = j->jid;
+        }
+        last = jids[n - 1];
+    }
+    for (int s = 0; s < nsel; s++)
+        get_job_by_jid(sel[s])->waited = 1;
+
+    /* pendant qu'on dort, le masque d'avant, SIGCHLD en moins (--serve le
+       bloque pour de bon) */
+    sigset_t sleep_mask = prev;
+    sigdelset(&sleep_mask, SIGCHLD);
+
+    int tfd = open_timeout(timeout_ms);
+    int left = nsel;
+    struct pidfds *p = Malloc(sizeof(struct pidfds));
+
+    while (left > 0) {
+        /* ceux qui ont fini : leur code, et on les retire */
+        for (int s = 0; s < nsel; s++) {
+            job_t *j = sel[s] ? get_job_by_jid(sel[s]) : NULL;
+            if (!j || j->state != DONE) continue;
+
+            if (any || j->jid == last) code = job_code(j);
+            delete_job_by_jid(j->jid);
+            sel[s] = 0;
+            left--;
+            if (any) break;
+        }
+        if (left == 0 || (any && left < nsel)) break;
+
+        fd_set rd;
+        int maxfd = -1, gfd = timers_fd();
+        FD_ZERO(&rd);
+        open_pidfds(p, sel, nsel);
+        for (int i = 0; i < p->n; i++) add_fd(p->fd[i], &rd, &maxfd);
+        add_fd(tfd, &rd, &maxfd);
+        add_fd(gfd, &rd, &maxfd);
+
+        int r = pselect(maxfd + 1, &rd, NULL, NULL, NULL, &sleep_mask);
+        close_pidfds(p);
+        if (r < 0 && errno != EINTR) break;
+        if (r <= 0) continue;
+
+        if (gfd >= 0 && FD_ISSET(gfd, &rd)) timers_run();
+        if (tfd >= 0 && FD_ISSET(tfd, &rd)) {
+            code = WAIT_TIMEOUT;
+            break;
+        }
+        /* un pidfd : le processus est fini, le handler le ramasse dès que
+           SIGCHLD est débloqué */
+        sigprocmask(SIG_SETMASK, &sleep_mask, NULL);
+        block_sigchld(NULL);
+    }
+
+    /* ceux qui tournent encore redeviennent des jobs ordinaires ; ceux qui
+       ont fini en même temps (-n) restent Done pour le wait suivant */
+    for (int s = 0; s < nsel; s++) {
+        job_t *j = sel[s] ? get_job_by_jid(sel[s]) : NULL;
+        if (j && j->state != DONE) j->waited = 0;
+    }
+
+    free(p);
+    if (tfd >= 0) close(tfd);
+    unblock_sigchld(&prev);
+    return code;
+}
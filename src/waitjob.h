@@ -0,0 +1,27 @@
+#ifndef __WAITJOB_H__
+#define __WAITJOB_H__
+
+/* ── wait [-n] [-t secondes] [%n|pid ...] ──
+   Attend la fin des jobs donnés (sans argument : de tous les jobs en
+   arrière-plan), ou du premier d’entre eux avec -n, au plus le temps
+   donné par -t. Un job attendu ne donne pas de message Done : quand il
+   se termine, le handler SIGCHLD le laisse dans jobs[] (état Done) avec
+   son status, et c’est wait qui le retire en rendant son code.
+
+   Le shell dort dans un seul pselect, sur les pidfd (pidfd_open) des
+   processus attendus, le timerfd du -t et les timers du shell (voir
+   timers.h) : il est réveillé à la fin d’un processus ou à l’échéance,
+   jamais avant.
+
+   Avec -n, si plusieurs jobs finissent ensemble, les autres restent Done
+   pour le wait suivant (jobs les montre une fois, puis les oublie). */
+
+#define WAIT_TIMEOUT 124    /* code de wait si -t a expiré (comme timeout) */
+#define WAIT_NOJOB   127    /* rien à attendre, ou job inconnu */
+
+/* Attend les jobs jids[0..n-1] (n = 0 : tous), le premier seulement si
+   any, au plus timeout_ms (< 0 : sans limite)
+   → code du job qui a fini avec any, sinon du dernier de la liste */
+int wait_jobs(const int *jids, int n, int any, long timeout_ms);
+
+#endif
@@ -0,0 +1,740 @@
+/*
+ * Développement des motifs de noms de fichiers (*, ?, [...], **).
+ *
+ * Le motif est coupé aux '/' ; chaque morceau est compilé une fois en
+ * une suite de jetons, avec à part sa partie fixe du début et de la fin :
+ * la plupart des noms sont rejetés par un simple memcmp, et un motif
+ * comme *.log n'a même pas besoin du reste.
+ *
+ * Les répertoires sont lus par getdents64 dans un tampon de DENTS_BUF
+ * (peu d'appels système même avec 100000 entrées) et gardés dans un
+ * cache de DIRCACHE_SIZE listes. Une liste est réutilisée tant que le
+ * répertoire a le même inode et la même date de modification. Une date
+ * trop proche du moment de la lecture ne prouve rien (deux changements
+ * dans la même seconde sur certains systèmes de fichiers) : dans ce cas
+ * le répertoire est relu la fois suivante.
+ *
+ * Les motifs avec ** sont parcourus en parallèle (voir plus bas).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include "csapp.h"
+#include "wspool.h"
+#include "wildcard.h"
+
+#define DENTS_BUF     (256 * 1024)  /* taille d'une lecture getdents64 */
+#define DIRCACHE_SIZE 16            /* répertoires gardés en mémoire */
+
+struct linux_dirent64 {
+    uint64_t       d_ino;
+    int64_t        d_off;
+    unsigned short d_reclen;
+    unsigned char  d_type;
+    char           d_name[];
+};
+
+
+/* ── motif compilé : un morceau entre deux '/' ── */
+
+typedef enum { T_CHAR, T_ANY, T_STAR, T_CLASS } tok_kind;
+
+struct tok {
+    tok_kind      kind;
+    unsigned char c;            /* T_CHAR */
+    unsigned char set[32];      /* T_CLASS : un bit par octet */
+};
+
+struct comp {
+    char       *lit;        /* pas de joker : le nom tel quel */
+    int         globstar;   /* ** */
+    struct tok *toks;
+    int         ntoks;
+    char       *prefix, *suffix;    /* parties fixes du début et de la fin */
+    size_t      plen, slen;
+    int         simple;     /* prefix*suffix : les memcmp suffisent */
+    int         dot;        /* commence par '.' : peut prendre les .x */
+};
+
+static void set_bit(unsigned char *set, unsigned char c) {
+    set[c >> 3] |= 1 << (c & 7);
+}
+
+/* [...] qui commence en s ('[') → fin de la classe, NULL si pas fermée */
+static const char *parse_class(const char *s, const char *end, struct tok *t) {
+    const char *p = s + 1;
+    int negate = 0;
+
+    memset(t, 0, sizeof(*t));
+    t->kind = T_CLASS;
+
+    if (p < end && (*p == '!' || *p == '^')) { negate = 1; p++; }
+
+    int first = 1;
+    while (p < end && (*p != ']' || first)) {
+        unsigned char lo = *p;
+        if (*p == '\\' && p + 1 < end) lo = *++p;
+        p++;
+
+        unsigned char hi = lo;
+        if (p + 1 < end && *p == '-' && p[1] != ']') {
+            p++;
+            if (*p == '\\' && p + 1 < end) p++;
+            hi = *p++;
+        }
+        for (int c = lo; c <= hi; c++) set_bit(t->set, c);
+        first = 0;
+    }
+    if (p >= end) return NULL;
+
+    if (negate)
+        for (int i = 0; i < 32; i++) t->set[i] = ~t->set[i];
+    return p + 1;
+}
+
+static void compile(struct comp *c, const char *s, size_t len) {
+    const char *end = s + len;
+    int wild = 0;
+
+    memset(c, 0, sizeof(*c));
+    if (len == 2 && s[0] == '*' && s[1] == '*') {
+        c->globstar = 1;
+        return;
+    }
+
+    c->toks = Malloc((len + 1) * sizeof(struct tok));
+    while (s < end) {
+        struct tok *t = &c->toks[c->ntoks];
+        const char *next;
+
+        if (*s == '\\' && s + 1 < end) {
+            t->kind = T_CHAR;
+            t->c = s[1];
+            s += 2;
+        } else if (*s == '*') {
+            while (s < end && *s == '*') s++;
+            t->kind = T_STAR;
+            wild = 1;
+        } else if (*s == '?') {
+            t->kind = T_ANY;
+            s++;
+            wild = 1;
+        } else if (*s == '[' && (next = parse_class(s, end, t)) != NULL) {
+            s = next;
+            wild = 1;
+        } else {
+            t->kind = T_CHAR;
+            t->c = *s++;
+        }
+        c->ntoks++;
+    }
+
+    /* sans joker c'est un nom : pas besoin de lire le répertoire */
+    if (!wild) {
+        c->lit = Malloc(c->ntoks + 1);
+        for (int i = 0; i < c->ntoks; i++) c->lit[i] = c->toks[i].c;
+        c->lit[c->ntoks] = '\0';
+        free(c->toks);
+        c->toks = NULL;
+        return;
+    }
+
+    int i = 0, j = c->ntoks;
+    while (c->toks[i].kind == T_CHAR) i++;
+    while (c->toks[j-1].kind == T_CHAR) j--;
+
+    c->plen = i;
+    c->slen = c->ntoks - j;
+    c->prefix = Malloc(c->plen + 1);
+    c->suffix = Malloc(c->slen + 1);
+    for (int k = 0; k < i; k++) c->prefix[k] = c->toks[k].c;
+    for (int k = j; k < c->ntoks; k++) c->suffix[k - j] = c->toks[k].c;
+
+    c->simple = (j == i + 1 && c->toks[i].kind == T_STAR);
+    c->dot = (c->toks[0].kind == T_CHAR && c->toks[0].c == '.');
+}
+
+static void comp_free(struct comp *c) {
+    free(c->lit);
+    free(c->toks);
+    free(c->prefix);
+    free(c->suffix);
+}
+
+static int tok_match(const struct tok *t, unsigned char ch) {
+    switch (t->kind) {
+    case T_CHAR:  return t->c == ch;
+    case T_ANY:   return 1;
+    case T_CLASS: return (t->set[ch >> 3] >> (ch & 7)) & 1;
+    default:      return 0;
+    }
+}
+
+/* * avec retour arrière sur la dernière étoile seulement : linéaire en
+   pratique, jamais exponentiel */
+static int match_toks(const struct tok *toks, int ntoks,
+                      const char *name, size_t nlen) {
+    int ti = 0, star_ti = -1;
+    size_t ni = 0, star_ni = 0;
+
+    while (ni < nlen) {
+        if (ti < ntoks && toks[ti].kind == T_STAR) {
+            star_ti = ti++;
+            star_ni = ni;
+        } else if (ti < ntoks && tok_match(&toks[ti], name[ni])) {
+            ti++;
+            ni++;
+        } else if (star_ti >= 0) {
+            ti = star_ti + 1;
+            ni = ++star_ni;
+        } else {
+            return 0;
+        }
+    }
+    while (ti < ntoks && toks[ti].kind == T_STAR) ti++;
+    return ti == ntoks;
+}
+
+static int comp_match(const struct comp *c, const char *name, size_t nlen) {
+    if (name[0] == '.' && !c->dot) return 0;
+    if (nlen < c->plen + c->slen) return 0;
+    if (memcmp(name, c->prefix, c->plen) != 0) return 0;
+    if (memcmp(name + nlen - c->slen, c->suffix, c->slen) != 0) return 0;
+    if (c->simple) return 1;
+    return match_toks(c->toks, c->ntoks, name, nlen);
+}
+
+
+/* ── cache des répertoires ── */
+
+struct dir_list {
+    char           *path;       /* NULL : case libre */
+    dev_t           dev;
+    ino_t           ino;
+    struct timespec mtime;
+    time_t          scanned;    /* quand on l'a lu */
+    char           *names;      /* les noms à la suite, chacun avec son \0 */
+    unsigned char  *types;      /* d_type de chaque nom */
+    int             n;
+    unsigned long   used;       /* pour remplacer le moins récent */
+    int             pins;       /* en cours de parcours : on n'y touche pas */
+    int             tmp;        /* hors cache, libéré par dir_put() */
+};
+
+static struct dir_list dircache[DIRCACHE_SIZE];
+static unsigned long   use_clock;
+static char           *dents_buf;
+
+static void dir_clear(struct dir_list *d) {
+    free(d->path);
+    free(d->names);
+    free(d->types);
+    memset(d, 0, sizeof(*d));
+}
+
+/* lit le répertoire ouvert fd par getdents64 dans le tampon buf (de
+   DENTS_BUF octets) : les noms à la suite dans *names, leurs d_type dans
+   *types, sans . ni .. → nombre de noms */
+static int read_dir(int fd, char *buf, char **names, unsigned char **types) {
+    size_t nsize = 0, ncap = 4096;
+    int n = 0, tcap = 256;
+
+    *names = Malloc(ncap);
+    *types = Malloc(tcap);
+
+    for (;;) {
+        long r = syscall(SYS_getdents64, fd, buf, DENTS_BUF);
+        if (r <= 0) break;
+
+        for (long off = 0; off < r; ) {
+            struct linux_dirent64 *e = (struct linux_dirent64 *)(buf + off);
+            off += e->d_reclen;
+
+            const char *name = e->d_name;
+            if (name[0] == '.' &&
+                (name[1] == '\0' || (name[1] == '.' && name[2] == '\0')))
+                continue;
+
+            size_t len = strlen(name) + 1;
+            if (nsize + len > ncap) {
+                while (nsize + len > ncap) ncap *= 2;
+                *names = Realloc(*names, ncap);
+            }
+            memcpy(*names + nsize, name, len);
+            nsize += len;
+
+            if (n >= tcap) {
+                tcap *= 2;
+                *types = Realloc(*types, tcap);
+            }
+            (*types)[n++] = e->d_type;
+        }
+    }
+    return n;
+}
+
+/* lit le répertoire path dans d → 0, -1 si impossible */
+static int dir_scan(struct dir_list *d, const char *path, struct stat *st) {
+    int fd = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) return -1;
+
+    if (!dents_buf) dents_buf = Malloc(DENTS_BUF);
+    d->n = read_dir(fd, dents_buf, &d->names, &d->types);
+    close(fd);
+
+    d->path = strdup(path);
+    d->dev = st->st_dev;
+    d->ino = st->st_ino;
+    d->mtime = st->st_mtim;
+    d->scanned = time(NULL);
+    return 0;
+}
+
+/* la liste de path, à rendre avec dir_put() → NULL si pas un répertoire */
+static struct dir_list *dir_get(const char *path) {
+    struct stat st;
+    struct dir_list *d, *slot = NULL;
+    int busy = 0;
+
+    if (stat(path, &st) < 0 || !S_ISDIR(st.st_mode)) return NULL;
+
+    for (int i = 0; i < DIRCACHE_SIZE; i++) {
+        d = &dircache[i];
+        if (!d->path || strcmp(d->path, path) != 0) continue;
+
+        if (d->dev == st.st_dev && d->ino == st.st_ino &&
+            d->mtime.tv_sec == st.st_mtim.tv_sec &&
+            d->mtime.tv_nsec == st.st_mtim.tv_nsec &&
+            d->mtime.tv_sec < d->scanned - 1) {
+            d->used = ++use_clock;
+            d->pins++;
+            return d;
+        }
+        /* périmée : on la relit à sa place, sauf si elle est parcourue */
+        if (d->pins == 0) slot = d;
+        else busy = 1;
+        break;
+    }
+
+    /* sinon une case libre, ou la moins récente qui n'est pas parcourue */
+    for (int i = 0; !slot && !busy && i < DIRCACHE_SIZE; i++) {
+        d = &dircache[i];
+        if (d->pins) continue;
+        if (!d->path) {
+            slot = d;
+            break;
+        }
+        if (!slot || d->used < slot->used) slot = d;
+    }
+
+    if (slot) {
+        dir_clear(slot);
+    } else {
+        /* tout le cache est en cours de parcours (** très profond) */
+        slot = Calloc(1, sizeof(*slot));
+        slot->tmp = 1;
+    }
+
+    if (dir_scan(slot, path, &st) < 0) {
+        if (slot->tmp) free(slot);
+        else dir_clear(slot);
+        return NULL;
+    }
+    slot->used = ++use_clock;
+    slot->pins = 1;
+    return slot;
+}
+
+static void dir_put(struct dir_list *d) {
+    if (--d->pins > 0 || !d->tmp) return;
+    free(d->path);
+    free(d->names);
+    free(d->types);
+    free(d);
+}
+
+
+/* ── parcours ── */
+
+struct walk {
+    struct comp *comps;
+    int          ncomps;
+    char       **res;
+    int          nres, cap;
+    char         path[PATH_MAX];
+};
+
+static void add_result(struct walk *w) {
+    if (w->nres >= w->cap) {
+        w->cap = w->cap ? w->cap * 2 : 64;
+        w->res = Realloc(w->res, w->cap * sizeof(char *));
+    }
+    w->res[w->nres++] = strdup(w->path);
+}
+
+/* w->path (qui vient de recevoir un nom de type type) est-il un
+   répertoire ? follow : les liens symboliques comptent */
+static int is_dir(struct walk *w, unsigned char type, int follow) {
+    struct stat st;
+
+    if (type == DT_DIR) return 1;
+    if (type != DT_UNKNOWN && (type != DT_LNK || !follow)) return 0;
+    if ((follow ? stat(w->path, &st) : lstat(w->path, &st)) < 0) return 0;
+    return S_ISDIR(st.st_mode);
+}
+
+/* w->path[0..len) est fait, il reste les morceaux ci et suivants */
+static void walk(struct walk *w, size_t len, int ci) {
+    struct comp *c = &w->comps[ci];
+    int last = (ci == w->ncomps - 1);
+
+    w->path[len] = '\0';
+
+    if (c->lit) {
+        size_t l = strlen(c->lit);
+        struct stat st;
+
+        if (len + l + 2 > PATH_MAX) return;
+        memcpy(w->path + len, c->lit, l + 1);
+        if (last) {
+            if (lstat(w->path, &st) == 0) add_result(w);
+            return;
+        }
+        w->path[len + l] = '/';
+        walk(w, len + l + 1, ci + 1);
+        return;
+    }
+
+    /* ** devant autre chose : peut ne prendre aucun répertoire */
+    if (c->globstar && !last) {
+        walk(w, len, ci + 1);
+        w->path[len] = '\0';
+    }
+
+    struct dir_list *d = dir_get(len ? w->path : ".");
+    if (!d) return;
+
+    const char *name = d->names;
+    for (int i = 0; i < d->n; name += strlen(name) + 1, i++) {
+        size_t nl = strlen(name);
+
+        if (len + nl + 2 > PATH_MAX) continue;
+        memcpy(w->path + len, name, nl + 1);
+
+        if (c->globstar) {
+            /* comme *, à tous les niveaux, sans suivre les liens */
+            if (name[0] == '.') continue;
+            if (last) add_result(w);
+            if (is_dir(w, d->types[i], 0)) {
+                w->path[len + nl] = '/';
+                walk(w, len + nl + 1, ci);
+            }
+            continue;
+        }
+
+        if (!comp_match(c, name, nl)) continue;
+        if (last) {
+            add_result(w);
+        } else if (is_dir(w, d->types[i], 1)) {
+            w->path[len + nl] = '/';
+            walk(w, len + nl + 1, ci + 1);
+        }
+    }
+    dir_put(d);
+}
+
+static int cmp_str(const void *a, const void *b) {
+    return strcmp(*(char * const *)a, *(char * const *)b);
+}
+
+/* ── ** en parallèle ──
+   Les motifs avec ** sont suivis comme un automate : un répertoire est
+   visité avec l'ensemble des morceaux du motif qui peuvent encore s'y
+   appliquer (** y reste et peut aussi passer au suivant). Chaque
+   répertoire est une tâche du pool : elle le lit, trie ses résultats et
+   ses sous-répertoires, et pousse ces derniers comme nouvelles tâches.
+   Le thread du shell parcourt l'arbre dans l'ordre en attendant chaque
+   répertoire : les chemins sortent triés (un sous-répertoire d/ forme un
+   bloc contigu dans l'ordre de strcmp) dès que le début de l'arbre est
+   lu, sans attendre la fin du parcours. */
+
+#define PWALK_THREADS 8     /* threads au plus pour un ** */
+
+typedef unsigned long long stateset;    /* un bit par morceau du motif */
+#define PWALK_MAXCOMPS 64
+
+struct pnode;
+
+struct pitem {
+    char         *path;     /* un résultat, ou NULL */
+    struct pnode *child;    /* ou un sous-répertoire à parcourir */
+};
+
+struct pnode {
+    char         *path;     /* avec le '/' final, "" pour le répertoire courant */
+    stateset      states;
+    sem_t         done;     /* V() quand items est rempli */
+    struct pitem *items;
+    int           nitems;
+    int           self;     /* motif en '/' : le répertoire est un résultat */
+};
+
+struct pwalk {
+    struct comp   *comps;
+    int            ncomps;
+    struct wspool *pool;
+    char         **bufs;    /* un tampon getdents64 par thread */
+    volatile int   abort;   /* le consommateur ne veut plus rien */
+    int            count;
+};
+
+/* ** peut ne prendre aucun répertoire : il active aussi le morceau suivant */
+static stateset closure(struct pwalk *pw, stateset s) {
+    for (int k = 0; k < pw->ncomps - 1; k++)
+        if (((s >> k) & 1) && pw->comps[k].globstar) s |= 1ULL << (k + 1);
+    return s;
+}
+
+static struct pnode *pnode_new(char *path, stateset states) {
+    struct pnode *n = Calloc(1, sizeof(*n));
+    n->path = path;
+    n->states = states;
+    Sem_init(&n->done, 0, 0);
+    return n;
+}
+
+static void pnode_add(struct pnode *n, int *cap, char *path, struct pnode *child) {
+    if (n->nitems >= *cap) {
+        *cap = *cap ? *cap * 2 : 16;
+        n->items = Realloc(n->items, *cap * sizeof(struct pitem));
+    }
+    n->items[n->nitems].path = path;
+    n->items[n->nitems].child = child;
+    n->nitems++;
+}
+
+static int cmp_item(const void *a, const void *b) {
+    const struct pitem *x = a, *y = b;
+    return strcmp(x->child ? x->child->path : x->path,
+                  y->child ? y->child->path : y->path);
+}
+
+/* lecture d'un répertoire, dans un thread du pool */
+static void pscan(struct pwalk *pw, struct pnode *n, int self) {
+    int last = pw->ncomps - 1;
+    struct comp *lastc = &pw->comps[last];
+
+    if (((n->states >> last) & 1) && lastc->lit && !lastc->lit[0] && n->path[0])
+        n->self = 1;
+
+    int fd = open(n->path[0] ? n->path : ".", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) return;
+
+    char *names;
+    unsigned char *types;
+    int count = read_dir(fd, pw->bufs[self], &names, &types);
+    close(fd);
+
+    size_t plen = strlen(n->path);
+    char full[plen + NAME_MAX + 2];
+    memcpy(full, n->path, plen);
+
+    const char *name = names;
+    int cap = 0;
+    for (int i = 0; i < count; name += strlen(name) + 1, i++) {
+        size_t nl = strlen(name);
+        stateset follow = 0, stay = 0;
+        int result = 0;
+
+        for (int k = 0; k <= last; k++) {
+            if (!((n->states >> k) & 1)) continue;
+            struct comp *c = &pw->comps[k];
+
+            if (c->globstar) {
+                if (name[0] == '.') continue;
+                if (k == last) result = 1;
+                stay |= 1ULL << k;
+            } else if (c->lit ? strcmp(name, c->lit) == 0
+                              : comp_match(c, name, nl)) {
+                if (k == last) result = 1;
+                else follow |= 1ULL << (k + 1);
+            }
+        }
+        if (!result && !follow && !stay) continue;
+
+        memcpy(full + plen, name, nl + 1);
+        if (result) pnode_add(n, &cap, strdup(full), NULL);
+
+        /* on descend : en suivant les liens pour un nom donné, jamais
+           pour ** (pas de boucle) */
+        struct stat st;
+        int dir_real = types[i] == DT_DIR, dir_follow = dir_real;
+        if (types[i] == DT_UNKNOWN && lstat(full, &st) == 0) {
+            dir_real = dir_follow = S_ISDIR(st.st_mode);
+            if (S_ISLNK(st.st_mode)) types[i] = DT_LNK;
+        }
+        if (types[i] == DT_LNK && follow)
+            dir_follow = stat(full, &st) == 0 && S_ISDIR(st.st_mode);
+
+        stateset next = closure(pw, (dir_follow ? follow : 0) |
+                                    (dir_real ? stay : 0));
+        if (next) {
+            char *cpath = Malloc(plen + nl + 2);
+            memcpy(cpath, full, plen + nl);
+            cpath[plen + nl] = '/';
+            cpath[plen + nl + 1] = '\0';
+            pnode_add(n, &cap, NULL, pnode_new(cpath, next));
+        }
+    }
+    free(names);
+    free(types);
+
+    qsort(n->items, n->nitems, sizeof(struct pitem), cmp_item);
+
+    /* à l'envers : le propriétaire reprend la sienne en premier, c'est la
+       première dont le consommateur aura besoin */
+    for (int i = n->nitems - 1; i >= 0; i--)
+        if (n->items[i].child) wspool_push(pw->pool, self, n->items[i].child);
+}
+
+static void pwalk_run(void *task, int self, void *ctx) {
+    struct pwalk *pw = ctx;
+    struct pnode *n = task;
+
+    if (!pw->abort) pscan(pw, n, self);
+    V(&n->done);
+}
+
+/* parcours dans l'ordre, dans le thread du shell */
+static void pwalk_emit(struct pwalk *pw, struct pnode *n,
+                       int (*found)(const char *path, void *arg), void *arg) {
+    P(&n->done);
+
+    if (n->self && !pw->abort) {
+        pw->count++;
+        if (found(n->path, arg)) pw->abort = 1;
+    }
+    for (int i = 0; i < n->nitems; i++) {
+        struct pitem *it = &n->items[i];
+        if (it->child) {
+            pwalk_emit(pw, it->child, found, arg);
+        } else {
+            if (!pw->abort) {
+                pw->count++;
+                if (found(it->path, arg)) pw->abort = 1;
+            }
+            free(it->path);
+        }
+    }
+    sem_destroy(&n->done);
+    free(n->items);
+    free(n->path);
+    free(n);
+}
+
+static int pwalk(struct comp *comps, int ncomps,
+                 int (*found)(const char *path, void *arg), void *arg) {
+    struct pwalk pw;
+    int p = 0;
+    size_t blen = 0;
+
+    memset(&pw, 0, sizeof(pw));
+    pw.comps = comps;
+    pw.ncomps = ncomps;
+
+    /* les morceaux fixes du début ne demandent pas de lecture */
+    for (int k = 0; k < ncomps - 1 && comps[k].lit; k++)
+        blen += strlen(comps[k].lit) + 1;
+    char *base = Malloc(blen + 1);
+    base[0] = '\0';
+    while (p < ncomps - 1 && comps[p].lit) {
+        strcat(base, comps[p].lit);
+        strcat(base, "/");
+        p++;
+    }
+
+    int nthreads = sysconf(_SC_NPROCESSORS_ONLN);
+    if (nthreads < 1) nthreads = 1;
+    if (nthreads > PWALK_THREADS) nthreads = PWALK_THREADS;
+
+    pw.bufs = Malloc(nthreads * sizeof(char *));
+    for (int i = 0; i < nthreads; i++) pw.bufs[i] = Malloc(DENTS_BUF);
+
+    struct pnode *root = pnode_new(base, closure(&pw, 1ULL << p));
+    pw.pool = wspool_create(nthreads, pwalk_run, &pw);
+    wspool_push(pw.pool, -1, root);
+    pwalk_emit(&pw, root, found, arg);
+    wspool_destroy(pw.pool);
+
+    for (int i = 0; i < nthreads; i++) free(pw.bufs[i]);
+    free(pw.bufs);
+    return pw.count;
+}
+
+
+int wildcard_expand(const char *pattern,
+                    int (*found)(const char *path, void *arg), void *arg) {
+    struct walk *w = Calloc(1, sizeof(*w));
+    const char *s = pattern;
+    int globstar = 0, n = 0;
+
+    /* un morceau par '/' */
+    for (;;) {
+        const char *e = s;
+        while (*e && *e != '/') e += (*e == '\\' && e[1]) ? 2 : 1;
+
+        w->comps = Realloc(w->comps, (w->ncomps + 1) * sizeof(struct comp));
+        compile(&w->comps[w->ncomps], s, e - s);
+        globstar |= w->comps[w->ncomps++].globstar;
+        if (!*e) break;
+        s = e + 1;
+    }
+
+    if (globstar && w->ncomps <= PWALK_MAXCOMPS) {
+        n = pwalk(w->comps, w->ncomps, found, arg);
+    } else {
+        walk(w, 0, 0);
+
+        qsort(w->res, w->nres, sizeof(char *), cmp_str);
+        int stop = 0;
+        for (int i = 0; i < w->nres; i++) {
+            if (!stop) stop = found(w->res[i], arg);
+            free(w->res[i]);
+        }
+        n = w->nres;
+    }
+
+    for (int i = 0; i < w->ncomps; i++) comp_free(&w->comps[i]);
+    free(w->comps);
+    free(w->res);
+    free(w);
+    return n;
+}
+
+int wildcard_has(const char *pattern) {
+    for (const char *s = pattern; *s; s++) {
+        if (*s == '\\' && s[1]) s++;
+        else if (*s == '*' || *s == '?') return 1;
+        else if (*s == '[' && strchr(s + 1, ']')) return 1;
+    }
+    return 0;
+}
+
+void wildcard_unescape(char *s) {
+    char *out = s;
+
+    for (; *s; s++) {
+        if (*s == '\\' && s[1]) s++;
+        *out++ = *s;
+    }
+    *out = '\0';
+}
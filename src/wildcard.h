@@ -0,0 +1,27 @@
+#ifndef __WILDCARD_H__
+#define __WILDCARD_H__
+
+/* ── Développement des motifs de noms de fichiers ──
+   *, ?, [abc], [a-z], [!x] et ** (n’importe quel nombre de répertoires).
+   Un caractère précédé de \ est pris tel quel (c’est comme ça que
+   readcmd passe les parties entre quotes). Comme dans sh, * et ? ne
+   prennent pas le '.' du début d’un nom, et . / .. ne sortent jamais.
+
+   Les répertoires sont lus avec getdents64 dans un grand tampon et
+   gardés dans un petit cache : tant que la date de modification d’un
+   répertoire n’a pas changé, il n’est pas relu. */
+
+/* Vrai si pattern contient un *, ? ou [ non protégé */
+int  wildcard_has(const char *pattern);
+
+/* Développe pattern : les chemins trouvés sont passés à found() dans
+   l’ordre alphabétique, au fur et à mesure pour un motif avec ** (lu par
+   plusieurs threads). found() retourne non nul pour arrêter
+   → nombre de chemins trouvés */
+int  wildcard_expand(const char *pattern,
+                     int (*found)(const char *path, void *arg), void *arg);
+
+/* Retire les \ de protection de s (en place) */
+void wildcard_unescape(char *s);
+
+#endif
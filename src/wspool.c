@@ -0,0 +1,131 @@
+/*
+ * Pool de threads à vol de tâches, sur les enveloppes Pthread_* et
+ * Sem_init / P / V de csapp.
+ *
+ * Le sémaphore tasks compte les tâches en file, toutes files confondues :
+ * un thread qui réussit P(&tasks) est sûr d'en trouver une quelque part.
+ * Chaque file est protégée par son propre sémaphore (utilisé comme un
+ * mutex), le vol ne bloque donc que la file visée.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include "csapp.h"
+#include "wspool.h"
+
+struct deque {
+    sem_t   mutex;
+    void  **tasks;
+    int     top, bottom;    /* tâches dans [top, bottom) */
+    int     size;
+};
+
+struct worker {
+    struct wspool *pool;
+    int            self;
+    pthread_t      tid;
+};
+
+struct wspool {
+    int             n;
+    struct deque   *dq;
+    struct worker  *workers;
+    sem_t           tasks;
+    volatile int    stop;
+    void          (*run)(void *task, int self, void *ctx);
+    void           *ctx;
+};
+
+static void dq_push(struct deque *d, void *task) {
+    P(&d->mutex);
+    if (d->top == d->bottom) d->top = d->bottom = 0;
+    if (d->bottom >= d->size) {
+        d->size = d->size ? d->size * 2 : 64;
+        d->tasks = Realloc(d->tasks, d->size * sizeof(void *));
+    }
+    d->tasks[d->bottom++] = task;
+    V(&d->mutex);
+}
+
+/* côté propriétaire : la plus récente */
+static void *dq_pop(struct deque *d) {
+    void *task = NULL;
+
+    P(&d->mutex);
+    if (d->bottom > d->top) task = d->tasks[--d->bottom];
+    V(&d->mutex);
+    return task;
+}
+
+/* côté voleur : la plus ancienne */
+static void *dq_steal(struct deque *d) {
+    void *task = NULL;
+
+    P(&d->mutex);
+    if (d->bottom > d->top) task = d->tasks[d->top++];
+    V(&d->mutex);
+    return task;
+}
+
+static void *worker_main(void *arg) {
+    struct worker *w = arg;
+    struct wspool *p = w->pool;
+
+    for (;;) {
+        P(&p->tasks);
+        if (p->stop) break;
+
+        void *task = dq_pop(&p->dq[w->self]);
+        for (int k = 1; !task; k++)
+            task = dq_steal(&p->dq[(w->self + k) % p->n]);
+
+        p->run(task, w->self, p->ctx);
+    }
+    return NULL;
+}
+
+struct wspool *wspool_create(int n, void (*run)(void *task, int self, void *ctx),
+                             void *ctx) {
+    struct wspool *p = Calloc(1, sizeof(*p));
+    sigset_t all, prev;
+
+    p->n = n;
+    p->run = run;
+    p->ctx = ctx;
+    p->dq = Calloc(n, sizeof(struct deque));
+    p->workers = Calloc(n, sizeof(struct worker));
+    Sem_init(&p->tasks, 0, 0);
+
+    /* les threads héritent du masque : SIGCHLD & co restent au shell */
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &prev);
+    for (int i = 0; i < n; i++) {
+        Sem_init(&p->dq[i].mutex, 0, 1);
+        p->workers[i].pool = p;
+        p->workers[i].self = i;
+        Pthread_create(&p->workers[i].tid, NULL, worker_main, &p->workers[i]);
+    }
+    pthread_sigmask(SIG_SETMASK, &prev, NULL);
+    return p;
+}
+
+void wspool_push(struct wspool *p, int self, void *task) {
+    dq_push(&p->dq[self < 0 ? 0 : self], task);
+    V(&p->tasks);
+}
+
+void wspool_destroy(struct wspool *p) {
+    p->stop = 1;
+    for (int i = 0; i < p->n; i++) V(&p->tasks);
+    for (int i = 0; i < p->n; i++) Pthread_join(p->workers[i].tid, NULL);
+
+    for (int i = 0; i < p->n; i++) {
+        sem_destroy(&p->dq[i].mutex);
+        free(p->dq[i].tasks);
+    }
+    sem_destroy(&p->tasks);
+    free(p->dq);
+    free(p->workers);
+    free(p);
+}
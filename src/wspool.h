@@ -0,0 +1,26 @@
+#ifndef __WSPOOL_H__
+#define __WSPOOL_H__
+
+/* ── Petit pool de threads à vol de tâches ──
+   Chaque thread a sa file de tâches : il prend les siennes par la fin
+   (la dernière poussée d’abord) et, quand elle est vide, en vole une au
+   début de la file d’un autre. Une tâche peut en pousser d’autres.
+   Pendant que le pool tourne, les signaux sont bloqués dans ses
+   threads : seul le thread du shell les reçoit. */
+
+struct wspool;
+
+/* Démarre n threads qui exécutent run(task, self, ctx) pour chaque tâche
+   (self : numéro du thread, de 0 à n-1) */
+struct wspool *wspool_create(int n, void (*run)(void *task, int self, void *ctx),
+                             void *ctx);
+
+/* Ajoute une tâche dans la file du thread self (-1 : depuis l’extérieur
+   du pool, elle va dans la file 0) */
+void wspool_push(struct wspool *p, int self, void *task);
+
+/* Arrête les threads et libère le pool. Les tâches encore en file ne
+   sont pas exécutées : à n’appeler que quand le travail est fini */
+void wspool_destroy(struct wspool *p);
+
+#endif
@@ -0,0 +1,238 @@
+/*
+ * Zygote (voir zygote.h).
+ *
+ * Une demande est un seul message SOCK_SEQPACKET : l'en-tête struct
+ * zreq puis les chaînes à la suite (argv, envp, assign), et les trois
+ * descripteurs en SCM_RIGHTS. La réponse est le pid créé (ou l'errno).
+ * Tout ce qui ne tient pas dans un message, ou n'importe quelle erreur
+ * de la socket, fait revenir le shell à fork : le zygote n'est qu'un
+ * raccourci.
+ *
+ * Le processus est créé par clone(CLONE_PARENT | SIGCHLD) : même chose
+ * que fork, mais son père est celui du zygote, le shell. Le zygote ne
+ * voit donc jamais ces processus finir, c'est le shell qui les attend.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sched.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include "vars.h"
+#include "zygote.h"
+
+#define ZYGOTE_MSG_MAX (64 * 1024)  /* au-delà, le shell fait le fork */
+#define ZYGOTE_MAXFD   1024         /* descripteurs fermés au démarrage */
+
+struct zreq {
+    pid_t  pgid;
+    int    argc, envc, nassign;
+    size_t len;                 /* octets de chaînes après l'en-tête */
+};
+
+struct zrep {
+    pid_t  pid;
+    int    err;
+};
+
+static int   zygote_fd = -1;    /* côté shell de la socketpair */
+
+
+/* ── côté zygote ── */
+
+/* n chaînes à la suite à partir de *p → tableau terminé par NULL */
+static char **unpack(char **p, int n) {
+    char **tab = malloc((n + 1) * sizeof(char *));
+    if (!tab) _exit(1);
+    for (int i = 0; i < n; i++) {
+        tab[i] = *p;
+        *p += strlen(*p) + 1;
+    }
+    tab[n] = NULL;
+    return tab;
+}
+
+/* le processus demandé : fait ce que fait le fils de spawn_pipeline() */
+static void zygote_child(int sock, struct zreq *req, char *strings, int fd[3]) {
+    char *p = strings;
+    char **argv = unpack(&p, req->argc);
+    char **envp = unpack(&p, req->envc);
+    char **assign = unpack(&p, req->nassign);
+
+    sigset_t empty;
+    sigemptyset(&empty);
+    sigprocmask(SIG_SETMASK, &empty, NULL);
+    signal(SIGINT,  SIG_DFL);
+    signal(SIGTSTP, SIG_DFL);
+    signal(SIGQUIT, SIG_DFL);
+    signal(SIGTTIN, SIG_DFL);
+    signal(SIGTTOU, SIG_DFL);
+
+    setpgid(0, req->pgid);
+
+    for (int k = 0; k < 3; k++) dup2(fd[k], k);
+    for (int k = 0; k < 3; k++) if (fd[k] > 2) close(fd[k]);
+    close(sock);
+
+    if (req->nassign) envp = vars_merge(envp, assign);
+    execvpe(argv[0], argv, envp);
+
+    fprintf(stderr, "%s: command not found\n", argv[0]);
+    _exit(127);
+}
+
+static void zygote_main(int sock) {
+    char *buf = malloc(ZYGOTE_MSG_MAX);
+    char cbuf[CMSG_SPACE(3 * sizeof(int))];
+
+    if (!buf) _exit(1);
+
+    for (;;) {
+        struct iovec iov = { buf, ZYGOTE_MSG_MAX };
+        struct msghdr msg;
+        int fd[3];
+
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = cbuf;
+        msg.msg_controllen = sizeof(cbuf);
+
+        ssize_t n = recvmsg(sock, &msg, MSG_CMSG_CLOEXEC);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) _exit(0);           /* le shell est parti */
+
+        struct cmsghdr *c = CMSG_FIRSTHDR(&msg);
+        struct zreq *req = (struct zreq *)buf;
+        struct zrep rep = { -1, EINVAL };
+
+        if (c && c->cmsg_type == SCM_RIGHTS &&
+            c->cmsg_len == CMSG_LEN(3 * sizeof(int)) &&
+            (size_t)n == sizeof(*req) + req->len) {
+            memcpy(fd, CMSG_DATA(c), sizeof(fd));
+
+            pid_t pid = syscall(SYS_clone, CLONE_PARENT | SIGCHLD, 0, 0, 0, 0);
+            if (pid == 0) zygote_child(sock, req, buf + sizeof(*req), fd);
+            rep.pid = pid;
+            rep.err = pid < 0 ? errno : 0;
+            for (int k = 0; k < 3; k++) close(fd[k]);
+        } else if (c && c->cmsg_type == SCM_RIGHTS) {
+            int nfd = (c->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+            int *cfd = (int *)CMSG_DATA(c);
+            for (int k = 0; k < nfd; k++) close(cfd[k]);
+        }
+
+        while (send(sock, &rep, sizeof(rep), 0) < 0 && errno == EINTR) ;
+    }
+}
+
+
+/* ── côté shell ── */
+
+int zygote_start(void) {
+    int sv[2];
+
+    if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, sv) < 0)
+        return -1;
+
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid < 0) {
+        close(sv[0]);
+        close(sv[1]);
+        return -1;
+    }
+
+    if (pid == 0) {
+        /* à l'abri de Ctrl-C / Ctrl-Z, qui visent le groupe du shell */
+        setpgid(0, 0);
+        signal(SIGINT,  SIG_IGN);
+        signal(SIGTSTP, SIG_IGN);
+        signal(SIGQUIT, SIG_IGN);
+        signal(SIGTTIN, SIG_IGN);
+        signal(SIGTTOU, SIG_IGN);
+        signal(SIGCHLD, SIG_DFL);
+
+        for (int fd = 3; fd < ZYGOTE_MAXFD; fd++)
+            if (fd != sv[1]) close(fd);
+        zygote_main(sv[1]);
+    }
+
+    close(sv[1]);
+    zygote_fd = sv[0];
+    return 0;
+}
+
+int zygote_enabled(void) {
+    return zygote_fd >= 0;
+}
+
+void zygote_forget(void) {
+    if (zygote_fd >= 0) close(zygote_fd);
+    zygote_fd = -1;
+}
+
+/* ajoute les chaînes de tab à buf → nombre de chaînes, -1 si trop long */
+static int pack(char *buf, size_t *len, char **tab) {
+    int n = 0;
+
+    for (; tab && tab[n]; n++) {
+        size_t l = strlen(tab[n]) + 1;
+        if (*len + l > ZYGOTE_MSG_MAX) return -1;
+        memcpy(buf + *len, tab[n], l);
+        *len += l;
+    }
+    return n;
+}
+
+pid_t zygote_spawn(char **argv, char **envp, char **assign, int fd[3],
+                   pid_t pgid) {
+    static char *buf;
+    char cbuf[CMSG_SPACE(3 * sizeof(int))];
+    size_t len = sizeof(struct zreq);
+    struct zreq req;
+    struct zrep rep;
+
+    if (zygote_fd < 0) return -1;
+    if (!buf && !(buf = malloc(ZYGOTE_MSG_MAX))) return -1;
+
+    req.pgid = pgid;
+    if ((req.argc = pack(buf, &len, argv)) < 0 ||
+        (req.envc = pack(buf, &len, envp)) < 0 ||
+        (req.nassign = pack(buf, &len, assign)) < 0)
+        return -1;
+    req.len = len - sizeof(req);
+    memcpy(buf, &req, sizeof(req));
+
+    struct iovec iov = { buf, len };
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = cbuf;
+    msg.msg_controllen = sizeof(cbuf);
+
+    struct cmsghdr *c = CMSG_FIRSTHDR(&msg);
+    c->cmsg_level = SOL_SOCKET;
+    c->cmsg_type = SCM_RIGHTS;
+    c->cmsg_len = CMSG_LEN(3 * sizeof(int));
+    memcpy(CMSG_DATA(c), fd, 3 * sizeof(int));
+
+    ssize_t n;
+    while ((n = sendmsg(zygote_fd, &msg, MSG_NOSIGNAL)) < 0 && errno == EINTR) ;
+    if (n < 0 && errno == EMSGSIZE) return -1;
+    if (n >= 0)
+        while ((n = recv(zygote_fd, &rep, sizeof(rep), 0)) < 0 && errno == EINTR) ;
+
+    if (n != sizeof(rep)) {
+        /* zygote mort : on n'essaie plus */
+        zygote_forget();
+        return -1;
+    }
+    return rep.pid;
+}
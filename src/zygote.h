@@ -0,0 +1,34 @@
+#ifndef __ZYGOTE_H__
+#define __ZYGOTE_H__
+
+#include <sys/types.h>
+
+/* ── Zygote : un petit processus qui lance les commandes à la place du
+   shell ──
+   Il est créé au démarrage (shell -z), quand le shell est encore petit :
+   ses fork ne recopient ni le tas ni la table des descripteurs du shell.
+   Une demande passe par une socketpair : argv, environnement, NAME=valeur
+   de la commande, groupe de processus, et ses entrée / sortie / erreur
+   (envoyées avec SCM_RIGHTS). Le zygote crée le processus avec
+   CLONE_PARENT : c’est un fils du shell, dont le handler SIGCHLD et
+   jobs[] s’occupent comme d’habitude. */
+
+/* Crée le zygote → 0, -1 si impossible (on garde fork) */
+int   zygote_start(void);
+
+/* Vrai si le zygote peut servir */
+int   zygote_enabled(void);
+
+/* Dans un fils du shell (sous-shell) : les processus du zygote seraient
+   les fils du shell, pas les siens, on ne s’en sert donc plus */
+void  zygote_forget(void);
+
+/* Lance argv (cherché dans le PATH) avec l’environnement envp et en plus
+   assign (NAME=valeur, peut être NULL), fd[0..2] comme entrée, sortie et
+   erreur, dans le groupe pgid (0 : un nouveau groupe).
+   → pid du processus, -1 si le zygote n’a pas pu (il faut alors faire
+   le fork soi-même) */
+pid_t zygote_spawn(char **argv, char **envp, char **assign, int fd[3],
+                   pid_t pgid);
+
+#endif
@@ -0,0 +1,93 @@
+/*
+ * Latence de lancement : fork + exec depuis un gros processus, contre le
+ * zygote (voir zygote.h).
+ *
+ *   make zygote_bench
+ *   ./zygote_bench [N] [Mo]
+ *
+ * Le zygote est créé d'abord, puis le processus grossit de Mo mégaoctets
+ * (512 par défaut) et ouvre quelques centaines de descripteurs, comme un
+ * shell qui a beaucoup servi. On lance ensuite N fois /bin/true de
+ * chaque façon : « lancement » est le temps jusqu'au retour de fork ou
+ * de zygote_spawn, « total » jusqu'à la fin de /bin/true.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "zygote.h"
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static void report(const char *name, double *t, int n) {
+    qsort(t, n, sizeof(double), cmp_double);
+    printf("  %-10s p50 %8.1f us   p99 %8.1f us\n",
+           name, t[n / 2], t[(int)(n * 0.99)]);
+}
+
+int main(int argc, char *argv[]) {
+    int n = argc > 1 ? atoi(argv[1]) : 1000;
+    size_t mo = argc > 2 ? atoi(argv[2]) : 512;
+    char *args[] = { "/bin/true", NULL };
+    char *envp[] = { "PATH=/bin:/usr/bin", NULL };
+    int fd[3] = { 0, 1, 2 };
+    double *start = malloc(n * sizeof(double));
+    double *total = malloc(n * sizeof(double));
+
+    if (zygote_start() < 0) {
+        fprintf(stderr, "zygote_start: échec\n");
+        return 1;
+    }
+
+    char *heap = malloc(mo << 20);
+    memset(heap, 1, mo << 20);
+    for (int i = 0; i < 500; i++) open("/dev/null", O_RDONLY);
+
+    printf("%d lancements de /bin/true, %zu Mo de tas\n", n, mo);
+
+    for (int i = 0; i < n; i++) {
+        double t0 = now();
+        pid_t pid = fork();
+        if (pid == 0) {
+            execve(args[0], args, envp);
+            _exit(127);
+        }
+        start[i] = now() - t0;
+        waitpid(pid, NULL, 0);
+        total[i] = now() - t0;
+    }
+    printf("fork + exec\n");
+    report("lancement", start, n);
+    report("total", total, n);
+
+    for (int i = 0; i < n; i++) {
+        double t0 = now();
+        pid_t pid = zygote_spawn(args, envp, NULL, fd, 0);
+        if (pid < 0) {
+            fprintf(stderr, "zygote_spawn: échec\n");
+            return 1;
+        }
+        start[i] = now() - t0;
+        waitpid(pid, NULL, 0);
+        total[i] = now() - t0;
+    }
+    printf("zygote\n");
+    report("lancement", start, n);
+    report("total", total, n);
+
+    free(heap);
+    return 0;
+}
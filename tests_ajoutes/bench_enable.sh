@@ -0,0 +1,19 @@
+#!/bin/bash
+# bench_enable.sh - cksum chargé par enable -f contre /usr/bin/cksum
+# À lancer depuis la racine après make shell cksum_plugin.so :
+#   bash tests_ajoutes/bench_enable.sh [N]
+
+N=${1:-5000}
+f=/tmp/shell_bench_cksum
+head -c 4096 /dev/urandom > $f
+
+echo "== $N x cksum externe (fork + exec)"
+time ./shell -c "for i in {1..$N}; do $(command -v cksum) $f > /dev/null; done"
+
+echo "== $N x cksum chargé (dans le shell)"
+time ./shell -c "enable -f ./cksum_plugin.so cksum; for i in {1..$N}; do cksum $f > /dev/null; done"
+
+echo "== $N x cksum chargé dans un pipeline (fork, pas d'exec)"
+time ./shell -c "enable -f ./cksum_plugin.so cksum; for i in {1..$N}; do cksum $f | true; done"
+
+rm -f $f